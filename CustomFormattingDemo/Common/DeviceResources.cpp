@@ -608,8 +608,10 @@ void DX::DeviceResources::Trim()
 	dxgiDevice->Trim();
 }
 
-// Present the contents of the swap chain to the screen.
-void DX::DeviceResources::Present() 
+// Present the contents of the swap chain to the screen. Returns false if the device
+// was lost, in which case the caller must call HandleDeviceLost before the next frame,
+// under the same lock as the rest of its rendering.
+bool DX::DeviceResources::Present() 
 {
 	// The first argument instructs DXGI to block until VSync, putting the application
 	// to sleep until the next VSync. This ensures we don't waste any cycles rendering
@@ -628,12 +630,11 @@ void DX::DeviceResources::Present()
 	// must recreate all device resources.
 	if (hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET)
 	{
-		HandleDeviceLost();
-	}
-	else
-	{
-		DX::ThrowIfFailed(hr);
+		return false;
 	}
+
+	DX::ThrowIfFailed(hr);
+	return true;
 }
 
 // This method determines the rotation between the display device's native Orientation and the
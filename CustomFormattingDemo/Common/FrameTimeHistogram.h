@@ -0,0 +1,138 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace DX
+{
+	// Histogram of durations in microseconds with a bounded relative error,
+	// in the style of an HDR histogram: values below 64 have their own bucket,
+	// and each power of two above that is split into 32 buckets, so that any
+	// recorded value is reported within about 3%. Recording is a few integer
+	// operations and never allocates.
+	class FrameTimeHistogram
+	{
+	public:
+		FrameTimeHistogram()
+		{
+			Reset();
+		}
+
+		void Reset()
+		{
+			memset(m_counts, 0, sizeof(m_counts));
+			m_count = 0;
+			m_total = 0;
+			m_max = 0;
+		}
+
+		void Record(uint64_t microseconds)
+		{
+			if (microseconds > MaxValue)
+			{
+				microseconds = MaxValue;
+			}
+
+			m_counts[GetBucket(microseconds)]++;
+			m_count++;
+			m_total += microseconds;
+
+			if (microseconds > m_max)
+			{
+				m_max = microseconds;
+			}
+		}
+
+		uint64_t GetCount() const		{ return m_count; }
+		uint64_t GetMax() const		{ return m_max; }
+		double GetMean() const		{ return m_count == 0 ? 0.0 : static_cast<double>(m_total) / m_count; }
+
+		// Get the value that the given fraction of the recorded values do not
+		// exceed, e.g. 0.99 for the 99th percentile.
+		uint64_t GetPercentile(double fraction) const
+		{
+			if (m_count == 0)
+			{
+				return 0;
+			}
+
+			uint64_t rank = static_cast<uint64_t>(fraction * m_count + 0.5);
+			rank = rank < 1 ? 1 : (rank > m_count ? m_count : rank);
+
+			uint64_t count = 0;
+
+			for (uint32_t bucket = 0; bucket < BucketCount; bucket++)
+			{
+				count += m_counts[bucket];
+
+				if (count >= rank)
+				{
+					uint64_t value = GetBucketUpperBound(bucket);
+					return value < m_max ? value : m_max;
+				}
+			}
+
+			return m_max;
+		}
+
+		uint64_t GetP50() const		{ return GetPercentile(0.50); }
+		uint64_t GetP95() const		{ return GetPercentile(0.95); }
+		uint64_t GetP99() const		{ return GetPercentile(0.99); }
+
+	private:
+		static const uint32_t LinearBits = 6;
+		static const uint32_t LinearCount = 1 << LinearBits;
+		static const uint32_t SubBucketCount = LinearCount / 2;
+		static const uint32_t MaxBits = 32;
+		static const uint64_t MaxValue = (1ull << MaxBits) - 1;
+		static const uint32_t BucketCount = LinearCount + (MaxBits - LinearBits) * SubBucketCount;
+
+		static uint32_t GetHighestBit(uint64_t value)
+		{
+			uint32_t bit = 0;
+
+			for (uint32_t shift = 32; shift != 0; shift /= 2)
+			{
+				if (value >> shift)
+				{
+					value >>= shift;
+					bit += shift;
+				}
+			}
+
+			return bit;
+		}
+
+		static uint32_t GetBucket(uint64_t value)
+		{
+			if (value < LinearCount)
+			{
+				return static_cast<uint32_t>(value);
+			}
+
+			// The top LinearBits bits of the value select the bucket.
+			uint32_t shift = GetHighestBit(value) - (LinearBits - 1);
+			uint32_t subBucket = static_cast<uint32_t>(value >> shift) - SubBucketCount;
+
+			return LinearCount + (shift - 1) * SubBucketCount + subBucket;
+		}
+
+		static uint64_t GetBucketUpperBound(uint32_t bucket)
+		{
+			if (bucket < LinearCount)
+			{
+				return bucket;
+			}
+
+			uint32_t shift = (bucket - LinearCount) / SubBucketCount + 1;
+			uint64_t subBucket = (bucket - LinearCount) % SubBucketCount + SubBucketCount;
+
+			return ((subBucket + 1) << shift) - 1;
+		}
+
+		uint32_t m_counts[BucketCount];
+		uint64_t m_count;
+		uint64_t m_total;
+		uint64_t m_max;
+	};
+}
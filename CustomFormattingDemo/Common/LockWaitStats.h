@@ -0,0 +1,71 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+
+namespace DX
+{
+	// Accumulates the time spent waiting to acquire a lock.
+	class LockWaitStats
+	{
+	public:
+		LockWaitStats() :
+			m_count(0),
+			m_totalMicroseconds(0),
+			m_maxMicroseconds(0)
+		{
+		}
+
+		void Record(uint64 microseconds)
+		{
+			m_count++;
+			m_totalMicroseconds += microseconds;
+
+			uint64 previous = m_maxMicroseconds;
+			while (microseconds > previous && !m_maxMicroseconds.compare_exchange_weak(previous, microseconds))
+			{
+			}
+		}
+
+		uint64 GetCount() const { return m_count; }
+		uint64 GetTotalMicroseconds() const { return m_totalMicroseconds; }
+		uint64 GetMaxMicroseconds() const { return m_maxMicroseconds; }
+
+		double GetAverageMicroseconds() const
+		{
+			uint64 count = m_count;
+			return count == 0 ? 0.0 : static_cast<double>(m_totalMicroseconds) / count;
+		}
+
+	private:
+		std::atomic<uint64> m_count;
+		std::atomic<uint64> m_totalMicroseconds;
+		std::atomic<uint64> m_maxMicroseconds;
+	};
+
+	// Scoped lock on a critical_section that records how long it waited.
+	class TimedScopedLock
+	{
+	public:
+		TimedScopedLock(Concurrency::critical_section& lock, LockWaitStats& stats) :
+			m_lock(lock)
+		{
+			auto waitStart = std::chrono::steady_clock::now();
+			m_lock.lock();
+
+			auto wait = std::chrono::steady_clock::now() - waitStart;
+			stats.Record(std::chrono::duration_cast<std::chrono::microseconds>(wait).count());
+		}
+
+		~TimedScopedLock()
+		{
+			m_lock.unlock();
+		}
+
+	private:
+		TimedScopedLock(const TimedScopedLock&);
+		TimedScopedLock& operator=(const TimedScopedLock&);
+
+		Concurrency::critical_section& m_lock;
+	};
+}
@@ -1,64 +1,86 @@
 ﻿#pragma once
 
-#include <wrl.h>
+#include <cstdint>
+#include <cstdlib>
+#include "StepTimerClock.h"
+#include "FrameTimeHistogram.h"
 
 namespace DX
 {
-	// Helper class for animation and simulation timing.
-	class StepTimer
+	// Phases of a frame measured by the StepTimer telemetry.
+	enum class FramePhase
+	{
+		Frame,				// CPU time of Update and Render
+		PresentInterval,	// Time from one Present to the next
+		Update,
+		Render,
+		FormatterRecord,	// CharacterFormatter walk of the text layout
+		FormatterReplay,	// Replay of the recorded passes
+		Layout,				// Time-sliced layout of a document
+		Present,
+		Count
+	};
+
+	// Helper class for animation and simulation timing. The time source is a
+	// clock policy (see StepTimerClock.h), so the timer can run headless.
+	template<typename TClock>
+	class BasicStepTimer
 	{
 	public:
-		StepTimer() : 
+		BasicStepTimer(const TClock& clock = TClock()) : 
+			m_clock(clock),
 			m_elapsedTicks(0),
 			m_totalTicks(0),
 			m_leftOverTicks(0),
 			m_frameCount(0),
 			m_framesPerSecond(0),
 			m_framesThisSecond(0),
-			m_qpcSecondCounter(0),
+			m_clockSecondCounter(0),
 			m_isFixedTimeStep(false),
-			m_targetElapsedTicks(TicksPerSecond / 60)
+			m_targetElapsedTicks(TicksPerSecond / 60),
+			m_isTelemetryEnabled(true),
+			m_clockLastPresent(0),
+			m_clockTelemetryWindow(0),
+			m_clockTelemetryWindowStart(0)
 		{
-			if (!QueryPerformanceFrequency(&m_qpcFrequency))
-			{
-				throw ref new Platform::FailureException();
-			}
-
-			if (!QueryPerformanceCounter(&m_qpcLastTime))
-			{
-				throw ref new Platform::FailureException();
-			}
+			m_clockFrequency = m_clock.GetFrequency();
+			m_clockLastTime = m_clock.GetTime();
 
 			// Initialize max delta to 1/10 of a second.
-			m_qpcMaxDelta = m_qpcFrequency.QuadPart / 10;
+			m_clockMaxDelta = m_clockFrequency / 10;
+
+			m_clockTelemetryWindowStart = m_clockLastTime;
 		}
 
+		// Get the time source, e.g. to advance a VirtualClock.
+		TClock& GetClock()									{ return m_clock; }
+
 		// Get elapsed time since the previous Update call.
-		uint64 GetElapsedTicks() const						{ return m_elapsedTicks; }
+		uint64_t GetElapsedTicks() const					{ return m_elapsedTicks; }
 		double GetElapsedSeconds() const					{ return TicksToSeconds(m_elapsedTicks); }
 
 		// Get total time since the start of the program.
-		uint64 GetTotalTicks() const						{ return m_totalTicks; }
+		uint64_t GetTotalTicks() const						{ return m_totalTicks; }
 		double GetTotalSeconds() const						{ return TicksToSeconds(m_totalTicks); }
 
 		// Get total number of updates since start of the program.
-		uint32 GetFrameCount() const						{ return m_frameCount; }
+		uint32_t GetFrameCount() const						{ return m_frameCount; }
 
 		// Get the current framerate.
-		uint32 GetFramesPerSecond() const					{ return m_framesPerSecond; }
+		uint32_t GetFramesPerSecond() const					{ return m_framesPerSecond; }
 
 		// Set whether to use fixed or variable timestep mode.
 		void SetFixedTimeStep(bool isFixedTimestep)			{ m_isFixedTimeStep = isFixedTimestep; }
 
 		// Set how often to call Update when in fixed timestep mode.
-		void SetTargetElapsedTicks(uint64 targetElapsed)	{ m_targetElapsedTicks = targetElapsed; }
+		void SetTargetElapsedTicks(uint64_t targetElapsed)	{ m_targetElapsedTicks = targetElapsed; }
 		void SetTargetElapsedSeconds(double targetElapsed)	{ m_targetElapsedTicks = SecondsToTicks(targetElapsed); }
 
 		// Integer format represents time using 10,000,000 ticks per second.
-		static const uint64 TicksPerSecond = 10000000;
+		static const uint64_t TicksPerSecond = 10000000;
 
-		static double TicksToSeconds(uint64 ticks)			{ return static_cast<double>(ticks) / TicksPerSecond; }
-		static uint64 SecondsToTicks(double seconds)		{ return static_cast<uint64>(seconds * TicksPerSecond); }
+		static double TicksToSeconds(uint64_t ticks)		{ return static_cast<double>(ticks) / TicksPerSecond; }
+		static uint64_t SecondsToTicks(double seconds)		{ return static_cast<uint64_t>(seconds * TicksPerSecond); }
 
 		// After an intentional timing discontinuity (for instance a blocking IO operation)
 		// call this to avoid having the fixed timestep logic attempt a set of catch-up 
@@ -66,15 +88,12 @@ namespace DX
 
 		void ResetElapsedTime()
 		{
-			if (!QueryPerformanceCounter(&m_qpcLastTime))
-			{
-				throw ref new Platform::FailureException();
-			}
+			m_clockLastTime = m_clock.GetTime();
 
 			m_leftOverTicks = 0;
 			m_framesPerSecond = 0;
 			m_framesThisSecond = 0;
-			m_qpcSecondCounter = 0;
+			m_clockSecondCounter = 0;
 		}
 
 		// Update timer state, calling the specified Update function the appropriate number of times.
@@ -82,29 +101,24 @@ namespace DX
 		void Tick(const TUpdate& update)
 		{
 			// Query the current time.
-			LARGE_INTEGER currentTime;
+			uint64_t currentTime = m_clock.GetTime();
 
-			if (!QueryPerformanceCounter(&currentTime))
-			{
-				throw ref new Platform::FailureException();
-			}
+			uint64_t timeDelta = currentTime - m_clockLastTime;
 
-			uint64 timeDelta = currentTime.QuadPart - m_qpcLastTime.QuadPart;
-
-			m_qpcLastTime = currentTime;
-			m_qpcSecondCounter += timeDelta;
+			m_clockLastTime = currentTime;
+			m_clockSecondCounter += timeDelta;
 
 			// Clamp excessively large time deltas (e.g. after paused in the debugger).
-			if (timeDelta > m_qpcMaxDelta)
+			if (timeDelta > m_clockMaxDelta)
 			{
-				timeDelta = m_qpcMaxDelta;
+				timeDelta = m_clockMaxDelta;
 			}
 
-			// Convert QPC units into a canonical tick format. This cannot overflow due to the previous clamp.
+			// Convert clock units into a canonical tick format. This cannot overflow due to the previous clamp.
 			timeDelta *= TicksPerSecond;
-			timeDelta /= m_qpcFrequency.QuadPart;
+			timeDelta /= m_clockFrequency;
 
-			uint32 lastFrameCount = m_frameCount;
+			uint32_t lastFrameCount = m_frameCount;
 
 			if (m_isFixedTimeStep)
 			{
@@ -117,7 +131,7 @@ namespace DX
 				// accumulate enough tiny errors that it would drop a frame. It is better to just round 
 				// small deviations down to zero to leave things running smoothly.
 
-				if (abs(static_cast<int64>(timeDelta - m_targetElapsedTicks)) < TicksPerSecond / 4000)
+				if (std::llabs(static_cast<int64_t>(timeDelta - m_targetElapsedTicks)) < static_cast<int64_t>(TicksPerSecond / 4000))
 				{
 					timeDelta = m_targetElapsedTicks;
 				}
@@ -151,33 +165,157 @@ namespace DX
 				m_framesThisSecond++;
 			}
 
-			if (m_qpcSecondCounter >= static_cast<uint64>(m_qpcFrequency.QuadPart))
+			if (m_clockSecondCounter >= m_clockFrequency)
 			{
 				m_framesPerSecond = m_framesThisSecond;
 				m_framesThisSecond = 0;
-				m_qpcSecondCounter %= m_qpcFrequency.QuadPart;
+				m_clockSecondCounter %= m_clockFrequency;
+			}
+		}
+
+		// Frame time telemetry. Phases are measured from a timestamp taken with
+		// GetTimestamp, and recorded in histograms of microseconds.
+		uint64_t GetTimestamp() const
+		{
+			return m_clock.GetTime();
+		}
+
+		uint64_t GetTimestampFrequency() const
+		{
+			return m_clockFrequency;
+		}
+
+		void RecordPhase(FramePhase phase, uint64_t startTimestamp)
+		{
+			if (m_isTelemetryEnabled)
+			{
+				RecordTelemetry(phase, GetTimestamp() - startTimestamp);
+			}
+		}
+
+		// Call after each Present, to measure the present-to-present interval.
+		void RecordPresent()
+		{
+			if (!m_isTelemetryEnabled)
+			{
+				return;
+			}
+
+			uint64_t currentTime = GetTimestamp();
+
+			if (m_clockLastPresent != 0)
+			{
+				RecordTelemetry(FramePhase::PresentInterval, currentTime - m_clockLastPresent);
 			}
+
+			m_clockLastPresent = currentTime;
+
+			// Start a new window, keeping the histograms of the completed one.
+			if (m_clockTelemetryWindow != 0 &&
+				currentTime - m_clockTelemetryWindowStart >= m_clockTelemetryWindow)
+			{
+				for (int phase = 0; phase < static_cast<int>(FramePhase::Count); phase++)
+				{
+					m_windowHistograms[phase] = m_histograms[phase];
+					m_histograms[phase].Reset();
+				}
+
+				m_clockTelemetryWindowStart = currentTime;
+			}
+		}
+
+		// Get the histogram of the current window, or of the last completed one.
+		// Read them on the render thread or while holding the render lock.
+		const FrameTimeHistogram& GetHistogram(FramePhase phase) const				{ return m_histograms[static_cast<int>(phase)]; }
+		const FrameTimeHistogram& GetWindowHistogram(FramePhase phase) const		{ return m_windowHistograms[static_cast<int>(phase)]; }
+
+		// Set the length of the telemetry window; zero accumulates forever.
+		void SetTelemetryWindowSeconds(double seconds)
+		{
+			m_clockTelemetryWindow = static_cast<uint64_t>(seconds * m_clockFrequency);
+		}
+
+		void SetTelemetryEnabled(bool isEnabled)		{ m_isTelemetryEnabled = isEnabled; }
+
+		void ResetTelemetry()
+		{
+			for (int phase = 0; phase < static_cast<int>(FramePhase::Count); phase++)
+			{
+				m_histograms[phase].Reset();
+				m_windowHistograms[phase].Reset();
+			}
+
+			m_clockLastPresent = 0;
+			m_clockTelemetryWindowStart = GetTimestamp();
 		}
 
 	private:
-		// Source timing data uses QPC units.
-		LARGE_INTEGER m_qpcFrequency;
-		LARGE_INTEGER m_qpcLastTime;
-		uint64 m_qpcMaxDelta;
+		void RecordTelemetry(FramePhase phase, uint64_t clockDelta)
+		{
+			m_histograms[static_cast<int>(phase)].Record(clockDelta * 1000000 / m_clockFrequency);
+		}
+
+		// Source timing data uses the units of the clock.
+		TClock m_clock;
+		uint64_t m_clockFrequency;
+		uint64_t m_clockLastTime;
+		uint64_t m_clockMaxDelta;
 
 		// Derived timing data uses a canonical tick format.
-		uint64 m_elapsedTicks;
-		uint64 m_totalTicks;
-		uint64 m_leftOverTicks;
+		uint64_t m_elapsedTicks;
+		uint64_t m_totalTicks;
+		uint64_t m_leftOverTicks;
 
 		// Members for tracking the framerate.
-		uint32 m_frameCount;
-		uint32 m_framesPerSecond;
-		uint32 m_framesThisSecond;
-		uint64 m_qpcSecondCounter;
+		uint32_t m_frameCount;
+		uint32_t m_framesPerSecond;
+		uint32_t m_framesThisSecond;
+		uint64_t m_clockSecondCounter;
 
 		// Members for configuring fixed timestep mode.
 		bool m_isFixedTimeStep;
-		uint64 m_targetElapsedTicks;
+		uint64_t m_targetElapsedTicks;
+
+		// Members for frame time telemetry.
+		bool m_isTelemetryEnabled;
+		uint64_t m_clockLastPresent;
+		uint64_t m_clockTelemetryWindow;
+		uint64_t m_clockTelemetryWindowStart;
+		FrameTimeHistogram m_histograms[static_cast<int>(FramePhase::Count)];
+		FrameTimeHistogram m_windowHistograms[static_cast<int>(FramePhase::Count)];
 	};
+
+#if defined(__cplusplus_winrt)
+	typedef BasicStepTimer<QpcClock> StepTimer;
+#else
+	typedef BasicStepTimer<SteadyClock> StepTimer;
+#endif
+
+	// Records the duration of a scope as a phase of the frame.
+	template<typename TTimer>
+	class BasicScopedFramePhase
+	{
+	public:
+		BasicScopedFramePhase(TTimer& timer, FramePhase phase) :
+			m_timer(timer),
+			m_phase(phase),
+			m_startTimestamp(timer.GetTimestamp())
+		{
+		}
+
+		~BasicScopedFramePhase()
+		{
+			m_timer.RecordPhase(m_phase, m_startTimestamp);
+		}
+
+	private:
+		BasicScopedFramePhase(const BasicScopedFramePhase&);
+		BasicScopedFramePhase& operator=(const BasicScopedFramePhase&);
+
+		TTimer& m_timer;
+		FramePhase m_phase;
+		uint64_t m_startTimestamp;
+	};
+
+	typedef BasicScopedFramePhase<StepTimer> ScopedFramePhase;
 }
@@ -0,0 +1,80 @@
+﻿#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace DX
+{
+	// Time sources for StepTimer. A clock reports a monotonic time in its own
+	// units, and the number of those units per second.
+
+#if defined(__cplusplus_winrt)
+	// QueryPerformanceCounter, the default clock of Windows Runtime builds.
+	class QpcClock
+	{
+	public:
+		QpcClock()
+		{
+			LARGE_INTEGER frequency;
+
+			if (!QueryPerformanceFrequency(&frequency))
+			{
+				throw ref new Platform::FailureException();
+			}
+
+			m_frequency = frequency.QuadPart;
+		}
+
+		uint64_t GetFrequency() const	{ return m_frequency; }
+
+		uint64_t GetTime() const
+		{
+			LARGE_INTEGER currentTime;
+
+			if (!QueryPerformanceCounter(&currentTime))
+			{
+				throw ref new Platform::FailureException();
+			}
+
+			return currentTime.QuadPart;
+		}
+
+	private:
+		uint64_t m_frequency;
+	};
+#endif
+
+	// std::chrono::steady_clock, available on every platform.
+	class SteadyClock
+	{
+	public:
+		uint64_t GetFrequency() const
+		{
+			return std::chrono::steady_clock::period::den / std::chrono::steady_clock::period::num;
+		}
+
+		uint64_t GetTime() const
+		{
+			return std::chrono::steady_clock::now().time_since_epoch().count();
+		}
+	};
+
+	// Time that only moves when advanced, for deterministic tests and benchmarks.
+	class VirtualClock
+	{
+	public:
+		// Uses the canonical StepTimer format of 10,000,000 ticks per second.
+		static const uint64_t TicksPerSecond = 10000000;
+
+		VirtualClock() : m_time(0)						{ }
+
+		uint64_t GetFrequency() const					{ return TicksPerSecond; }
+		uint64_t GetTime() const						{ return m_time; }
+
+		void Advance(uint64_t ticks)					{ m_time += ticks; }
+		void AdvanceSeconds(double seconds)				{ m_time += static_cast<uint64_t>(seconds * TicksPerSecond); }
+
+	private:
+		uint64_t m_time;
+	};
+}
@@ -0,0 +1,58 @@
+#include "pch.h"
+#include "BrushPalette.h"
+
+using namespace Microsoft::WRL;
+
+BrushPalette::BrushPalette()
+{
+    Clear();
+}
+
+BrushIndex BrushPalette::Add(const D2D1_COLOR_F & color)
+{
+    // Palettes are small, so a linear search is fine
+    for (size_t index = 1; index < m_colors.size(); index++)
+    {
+        if (memcmp(&m_colors[index], &color, sizeof(D2D1_COLOR_F)) == 0)
+        {
+            return (BrushIndex) index;
+        }
+    }
+
+    m_colors.push_back(color);
+    return (BrushIndex) (m_colors.size() - 1);
+}
+
+HRESULT BrushPalette::CreateBrushes(ID2D1RenderTarget * renderTarget)
+{
+    ReleaseBrushes();
+
+    for (size_t index = 1; index < m_colors.size(); index++)
+    {
+        ComPtr<ID2D1SolidColorBrush> brush;
+        HRESULT hr;
+
+        if (S_OK != (hr = renderTarget->CreateSolidColorBrush(m_colors[index], &brush)))
+        {
+            ReleaseBrushes();
+            return hr;
+        }
+
+        m_brushes.push_back(brush);
+    }
+
+    return S_OK;
+}
+
+void BrushPalette::ReleaseBrushes()
+{
+    m_brushes.clear();
+    m_brushes.push_back(nullptr);
+}
+
+void BrushPalette::Clear()
+{
+    m_colors.clear();
+    m_colors.push_back(D2D1_COLOR_F());
+    ReleaseBrushes();
+}
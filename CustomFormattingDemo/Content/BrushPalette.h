@@ -0,0 +1,50 @@
+#pragma once
+#include "RenderTypes.h"
+
+// The brushes used by the CharacterFormatSpecifier objects of a layout.
+// Specifiers store small indices into the palette instead of brush
+// pointers, and CharacterFormatter resolves them when drawing.
+//
+// The palette holds device-independent colors, so the formatting survives
+// the loss of the device: only the brushes are released and created again.
+class BrushPalette
+{
+public:
+    BrushPalette();
+
+    // Index 0 is reserved for no brush
+    static const BrushIndex NoBrush = ::NoBrush;
+
+    // Get the index of a color, adding it to the palette if necessary;
+    // its brush is created by the next call to CreateBrushes
+    BrushIndex Add(const D2D1_COLOR_F & color);
+
+    // Device-dependent resources
+    HRESULT CreateBrushes(ID2D1RenderTarget * renderTarget);
+    void ReleaseBrushes();
+
+    // Returns nullptr for NoBrush, an index that is not in the palette,
+    // or when the brushes have not been created
+    ID2D1Brush * GetBrush(BrushIndex index) const
+    {
+        return index < m_brushes.size() ? m_brushes[index].Get() : nullptr;
+    }
+
+    // Number of colors, including NoBrush
+    UINT32 GetCount() const
+    {
+        return (UINT32) m_colors.size();
+    }
+
+    const D2D1_COLOR_F & GetColor(BrushIndex index) const
+    {
+        return m_colors[index];
+    }
+
+    // Remove all colors
+    void Clear();
+
+private:
+    std::vector<D2D1_COLOR_F>                                m_colors;
+    std::vector<Microsoft::WRL::ComPtr<ID2D1SolidColorBrush>> m_brushes;
+};
@@ -1,39 +1,63 @@
 #include "pch.h"
 #include "CharacterFormatSpecifier.h"
 
+using namespace Microsoft::WRL;
+
+InternTable<CharacterFormatSpecifier,
+            CharacterFormatSpecifier::Hasher,
+            CharacterFormatSpecifier::Comparer>
+    CharacterFormatSpecifier::s_internTable;
+
 CharacterFormatSpecifier::CharacterFormatSpecifier() :
     m_refCount(0),
-    m_foregroundBrush(nullptr),
-    m_backgroundMode(BackgroundMode::TextHeight),
-    m_backgroundBrush(nullptr),
-    m_underlineType(UnderlineType::None),
-    m_underlineBrush(nullptr),
-    m_strikethroughCount(0),
-    m_strikethroughBrush(nullptr),
-    m_hasOverline(false),
-    m_overlineBrush(nullptr),
-    m_highlightBrush(nullptr)
+    m_isInterned(false),
+    m_values()
 {
 }
 
 // IUnknown methods
 ULONG STDMETHODCALLTYPE CharacterFormatSpecifier::AddRef()
 {
-    m_refCount++;
-    return m_refCount;
+    return InterlockedIncrement(&m_refCount);
 }
 
 ULONG STDMETHODCALLTYPE CharacterFormatSpecifier::Release()
 {
-    m_refCount--;
-    LONG newCount = m_refCount;
+    LONG newCount = InterlockedDecrement(&m_refCount);
+
+    if (newCount == 0)
+    {
+        if (m_isInterned)
+        {
+            // Intern may have replaced this specifier in the table already
+            s_internTable.Remove(this);
+        }
 
-    if (m_refCount == 0)
         delete this;
+    }
 
     return newCount;
 }
 
+bool CharacterFormatSpecifier::TryAddRef()
+{
+    LONG count = m_refCount;
+
+    while (count != 0)
+    {
+        LONG previous = InterlockedCompareExchange(&m_refCount, count + 1, count);
+
+        if (previous == count)
+        {
+            return true;
+        }
+
+        count = previous;
+    }
+
+    return false;
+}
+
 HRESULT STDMETHODCALLTYPE CharacterFormatSpecifier::QueryInterface(_In_ REFIID riid,
     _Outptr_ void** ppOutput)
 {
@@ -52,20 +76,61 @@ HRESULT STDMETHODCALLTYPE CharacterFormatSpecifier::QueryInterface(_In_ REFIID r
     return hr;
 }
 
-CharacterFormatSpecifier * CharacterFormatSpecifier::Clone()
+void CharacterFormatSpecifier::CopyFormatting(const CharacterFormatSpecifier * other)
+{
+    m_values = other->m_values;
+}
+
+size_t CharacterFormatSpecifier::Hasher::operator()(
+                        const CharacterFormatSpecifier * specifier) const
 {
-    CharacterFormatSpecifier * specifier = new CharacterFormatSpecifier();
+    const FormatValues & values = specifier->m_values;
+    size_t hash = values.foregroundBrush;
+    hash = hash * 31 + (size_t) values.backgroundMode;
+    hash = hash * 31 + values.backgroundBrush;
+    hash = hash * 31 + (size_t) values.underlineType;
+    hash = hash * 31 + values.underlineBrush;
+    hash = hash * 31 + (size_t) values.strikethroughCount;
+    hash = hash * 31 + values.strikethroughBrush;
+    hash = hash * 31 + (size_t) values.hasOverline;
+    hash = hash * 31 + values.overlineBrush;
+    hash = hash * 31 + values.highlightBrush;
+    return hash;
+}
 
-    specifier->m_foregroundBrush = this->m_foregroundBrush;
-    specifier->m_backgroundMode = this->m_backgroundMode;
-    specifier->m_backgroundBrush = this->m_backgroundBrush;
-    specifier->m_underlineType = this->m_underlineType;
-    specifier->m_underlineBrush = this->m_underlineBrush;
-    specifier->m_strikethroughCount = this->m_strikethroughCount;
-    specifier->m_strikethroughBrush = this->m_strikethroughBrush;
-    specifier->m_hasOverline = this->m_hasOverline;
-    specifier->m_overlineBrush = this->m_overlineBrush;
-    specifier->m_highlightBrush = this->m_highlightBrush;
+bool CharacterFormatSpecifier::Comparer::operator()(
+                        const CharacterFormatSpecifier * specifier1,
+                        const CharacterFormatSpecifier * specifier2) const
+{
+    const FormatValues & values1 = specifier1->m_values;
+    const FormatValues & values2 = specifier2->m_values;
+
+    return values1.foregroundBrush == values2.foregroundBrush &&
+           values1.backgroundMode == values2.backgroundMode &&
+           values1.backgroundBrush == values2.backgroundBrush &&
+           values1.underlineType == values2.underlineType &&
+           values1.underlineBrush == values2.underlineBrush &&
+           values1.strikethroughCount == values2.strikethroughCount &&
+           values1.strikethroughBrush == values2.strikethroughBrush &&
+           values1.hasOverline == values2.hasOverline &&
+           values1.overlineBrush == values2.overlineBrush &&
+           values1.highlightBrush == values2.highlightBrush;
+}
+
+ComPtr<CharacterFormatSpecifier> CharacterFormatSpecifier::Intern(
+                        const CharacterFormatSpecifier & prototype)
+{
+    ComPtr<CharacterFormatSpecifier> specifier;
+
+    specifier.Attach(s_internTable.Intern(prototype, [&prototype]()
+    {
+        // First use of this formatting: make a heap copy and share it
+        CharacterFormatSpecifier * copy = new CharacterFormatSpecifier();
+        copy->CopyFormatting(&prototype);
+        copy->m_isInterned = true;
+        copy->AddRef();
+        return copy;
+    }));
 
     return specifier;
 }
@@ -73,51 +138,43 @@ CharacterFormatSpecifier * CharacterFormatSpecifier::Clone()
 // All remaining methods are static!
 HRESULT CharacterFormatSpecifier::SetForegroundBrush(
                                         IDWriteTextLayout * textLayout,
-                                        ID2D1Brush * brush,
+                                        BrushIndex brush,
                                         DWRITE_TEXT_RANGE textRange)
 {
-    return SetFormatting(textLayout, 
-                         textRange, 
-                         [brush](CharacterFormatSpecifier * specifier)
-    {
-        specifier->m_foregroundBrush = brush;
-    });
+    FormatValues values;
+    values.foregroundBrush = brush;
+
+    return SetFormat<ForegroundField>(textLayout, values, textRange);
 }
 
 HRESULT CharacterFormatSpecifier::SetBackgroundBrush(
     IDWriteTextLayout * textLayout,
     BackgroundMode backgroundMode,
-    ID2D1Brush * brush,
+    BrushIndex brush,
     DWRITE_TEXT_RANGE textRange)
 {
-    return SetFormatting(textLayout,
-        textRange,
-        [backgroundMode, brush](CharacterFormatSpecifier * specifier)
-    {
-        specifier->m_backgroundMode = backgroundMode;
-        specifier->m_backgroundBrush = brush;
-    });
+    FormatValues values;
+    values.backgroundMode = backgroundMode;
+    values.backgroundBrush = brush;
+
+    return SetFormat<BackgroundField>(textLayout, values, textRange);
 }
 
 HRESULT CharacterFormatSpecifier::SetUnderline(IDWriteTextLayout * textLayout,
                                                UnderlineType type,
-                                               ID2D1Brush * brush,
+                                               BrushIndex brush,
                                                DWRITE_TEXT_RANGE textRange)
 {
-    textLayout->SetUnderline(true, textRange);
+    FormatValues values;
+    values.underlineType = type;
+    values.underlineBrush = brush;
 
-    return SetFormatting(textLayout, 
-                         textRange, 
-                         [type, brush](CharacterFormatSpecifier * specifier)
-    {
-        specifier->m_underlineType = type;
-        specifier->m_underlineBrush = brush;
-    });
+    return SetFormat<UnderlineField>(textLayout, values, textRange);
 }
 
 HRESULT CharacterFormatSpecifier::SetStrikethrough(IDWriteTextLayout * textLayout,
                                                    int count,
-                                                   ID2D1Brush * brush,
+                                                   BrushIndex brush,
                                                    DWRITE_TEXT_RANGE textRange)
 {
     if (count < 0 || count > 3)
@@ -125,99 +182,65 @@ HRESULT CharacterFormatSpecifier::SetStrikethrough(IDWriteTextLayout * textLayou
         return E_INVALIDARG;
     }
 
-    textLayout->SetStrikethrough(count > 0, textRange);
+    FormatValues values;
+    values.strikethroughCount = (INT8) count;
+    values.strikethroughBrush = brush;
 
-    return SetFormatting(textLayout,
-        textRange,
-        [count, brush](CharacterFormatSpecifier * specifier)
-    {
-        specifier->m_strikethroughCount = count;
-        specifier->m_strikethroughBrush = brush;
-    });
+    return SetFormat<StrikethroughField>(textLayout, values, textRange);
 }
 
 HRESULT CharacterFormatSpecifier::SetOverline(IDWriteTextLayout * textLayout,
                                               bool hasOverline,
-                                              ID2D1Brush * brush,
+                                              BrushIndex brush,
                                               DWRITE_TEXT_RANGE textRange)
 {
-    textLayout->SetUnderline(true, textRange);
+    FormatValues values;
+    values.hasOverline = hasOverline;
+    values.overlineBrush = brush;
 
-    return SetFormatting(textLayout,
-                         textRange,
-                         [hasOverline, brush](CharacterFormatSpecifier * specifier)
-    {
-        specifier->m_hasOverline = hasOverline;
-        specifier->m_overlineBrush = brush;
-    });
+    return SetFormat<OverlineField>(textLayout, values, textRange);
 }
 
 HRESULT CharacterFormatSpecifier::SetHighlight(
     IDWriteTextLayout * textLayout,
-    ID2D1Brush * brush,
+    BrushIndex brush,
     DWRITE_TEXT_RANGE textRange)
 {
-    return SetFormatting(textLayout,
-        textRange,
-        [brush](CharacterFormatSpecifier * specifier)
-    {
-        specifier->m_highlightBrush = brush;
-    });
+    FormatValues values;
+    values.highlightBrush = brush;
+
+    return SetFormat<HighlightField>(textLayout, values, textRange);
 }
 
-HRESULT CharacterFormatSpecifier::SetFormatting(IDWriteTextLayout * textLayout,
-                                                DWRITE_TEXT_RANGE textRange,
-                std::function<void(CharacterFormatSpecifier *)> setField)
+HRESULT CharacterFormatSpecifier::SetDecorations(IDWriteTextLayout * textLayout,
+                                                 UINT32 fields,
+                                                 const FormatValues & values,
+                                                 DWRITE_TEXT_RANGE textRange)
 {
-    // Get information from the text range to set
-    const UINT32 endPosition = textRange.startPosition + textRange.length;
-    UINT32 currentPosition = textRange.startPosition;
+    HRESULT hr;
 
-    // Loop until we're at the end of the range
-    while (currentPosition < endPosition)
+    if (fields & StrikethroughField)
     {
-        // Get the drawing effect at the current position
-        CharacterFormatSpecifier * specifier = nullptr;
-        DWRITE_TEXT_RANGE queryTextRange;
-        HRESULT hr;
-
-        if (S_OK != (hr = textLayout->GetDrawingEffect(currentPosition, 
-                                                       (IUnknown **) &specifier, 
-                                                       &queryTextRange)))
+        if (values.strikethroughCount < 0 || values.strikethroughCount > 3)
         {
-            return hr;
+            return E_INVALIDARG;
         }
 
-        // Create a new CharacterFormatSpecifier or clone the existing one
-        if (specifier == nullptr)
-        {
-            specifier = new CharacterFormatSpecifier();
-        }
-        else
+        if (S_OK != (hr = textLayout->SetStrikethrough(values.strikethroughCount > 0, 
+                                                       textRange)))
         {
-            specifier = specifier->Clone();
+            return hr;
         }
+    }
 
-        // Callback to set fields in the new CharacterFormatSpecifier!!!
-        setField(specifier);
-
-        // Determine the text range for the new CharacterFormatSpecifier
-        UINT32 queryEndPos = queryTextRange.startPosition + queryTextRange.length;
-        UINT32 setLength = min(endPosition, queryEndPos) - currentPosition;
-
-        DWRITE_TEXT_RANGE setTextRange;
-        setTextRange.startPosition = currentPosition;
-        setTextRange.length = setLength;
-
-        // Set it
-        if (S_OK != (hr = textLayout->SetDrawingEffect((IUnknown *) specifier, 
-                                                       setTextRange)))
+    // Overlines are drawn by DrawUnderline
+    if (fields & (UnderlineField | OverlineField))
+    {
+        if (S_OK != (hr = textLayout->SetUnderline(true, textRange)))
         {
             return hr;
         }
-
-        // Bump up the current position
-        currentPosition += setLength;
     }
+
     return S_OK;
-}
\ No newline at end of file
+}
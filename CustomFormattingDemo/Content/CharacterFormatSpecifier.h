@@ -1,21 +1,14 @@
 #pragma once
 
-enum class UnderlineType
-{
-    None = 0,
-    Single = 1,
-    Double = 2,
-    Triple = 3,
-    Squiggly
-};
-
-enum class BackgroundMode
-{
-    TextHeight,
-    TextHeightWithLineGap,
-    LineHeight
-};
+#include "BrushPalette.h"
+#include "FormatValues.h"
+#include "InternTable.h"
+#include "TrackedLayout.h"
 
+// Specifiers are immutable and interned: all ranges with identical
+// formatting share one instance, so two specifiers can be compared
+// by pointer. Formatting can be set on different layouts from several
+// threads at once.
 class CharacterFormatSpecifier : IUnknown
 {
 public:
@@ -28,100 +21,254 @@ public:
     // Public Set and Get methods
     // --------------------------
 
+    // Any combination of fields, e.g. SetFormat<ForegroundField | UnderlineField>
+    template<UINT32 Fields>
+    static HRESULT SetFormat(IDWriteTextLayout * textLayout,
+                             const FormatValues & values,
+                             DWRITE_TEXT_RANGE textRange);
+
     // Foreground brush
     static HRESULT SetForegroundBrush(IDWriteTextLayout * textLayout,
-                                      ID2D1Brush * brush,
+                                      BrushIndex brush,
                                       DWRITE_TEXT_RANGE textRange);
 
-    ID2D1Brush * GetForegroundBrush() 
+    BrushIndex GetForegroundBrush() 
     { 
-        return m_foregroundBrush.Get(); 
+        return m_values.foregroundBrush; 
     }
 
     // Background brush
     static HRESULT SetBackgroundBrush(IDWriteTextLayout * textLayout,
                                       BackgroundMode backgroundMode,
-                                      ID2D1Brush * brush,
+                                      BrushIndex brush,
                                       DWRITE_TEXT_RANGE textRange);
 
-    void GetBackgroundBrush(BackgroundMode * pMode, ID2D1Brush ** pBrush)
+    void GetBackgroundBrush(BackgroundMode * pMode, BrushIndex * pBrush)
     {
-        * pMode = m_backgroundMode;
-        * pBrush = m_backgroundBrush.Get();
+        * pMode = m_values.backgroundMode;
+        * pBrush = m_values.backgroundBrush;
     }
 
     // Underline
     static HRESULT SetUnderline(IDWriteTextLayout * textLayout,
                                 UnderlineType type,
-                                ID2D1Brush * brush,
+                                BrushIndex brush,
                                 DWRITE_TEXT_RANGE textRange);
 
-    void GetUnderline(UnderlineType * pType, ID2D1Brush ** pBrush)
+    void GetUnderline(UnderlineType * pType, BrushIndex * pBrush)
     { 
-        * pType = m_underlineType; 
-        * pBrush = m_underlineBrush.Get(); 
+        * pType = m_values.underlineType; 
+        * pBrush = m_values.underlineBrush; 
     }
 
     // Strikethrough
     static HRESULT SetStrikethrough(IDWriteTextLayout * textLayout,
                                     int count,
-                                    ID2D1Brush * brush,
+                                    BrushIndex brush,
                                     DWRITE_TEXT_RANGE textRange);
 
-    void GetStrikethrough(int * pCount, ID2D1Brush ** pBrush) 
+    void GetStrikethrough(int * pCount, BrushIndex * pBrush) 
     { 
-        * pCount = m_strikethroughCount;
-        * pBrush = m_strikethroughBrush.Get(); 
+        * pCount = m_values.strikethroughCount;
+        * pBrush = m_values.strikethroughBrush; 
     }
 
     // Overline
     static HRESULT SetOverline(IDWriteTextLayout * textLayout,
                                bool hasOverline,
-                               ID2D1Brush * brush,
+                               BrushIndex brush,
                                DWRITE_TEXT_RANGE textRange);
 
-    void GetOverline(bool * pHasOverline, ID2D1Brush ** pBrush)
+    void GetOverline(bool * pHasOverline, BrushIndex * pBrush)
     {
-        *pHasOverline = m_hasOverline;
-        *pBrush = m_overlineBrush.Get();
+        *pHasOverline = m_values.hasOverline;
+        *pBrush = m_values.overlineBrush;
     }
 
     // Hightlight
     static HRESULT SetHighlight(IDWriteTextLayout * textLayout,
-        ID2D1Brush * brush,
+        BrushIndex brush,
         DWRITE_TEXT_RANGE textRange);
 
-    ID2D1Brush * GetHighlight()
+    BrushIndex GetHighlight()
     {
-        return m_highlightBrush.Get();
+        return m_values.highlightBrush;
     }
 
+    // All the fields, as read by LayoutRecorder
+    const FormatValues & GetValues() const
+    {
+        return m_values;
+    }
 
 protected:
     CharacterFormatSpecifier();             // constructor
-    CharacterFormatSpecifier * Clone();
+    void CopyFormatting(const CharacterFormatSpecifier * other);
+
+    // Get the shared instance with the same formatting as the prototype
+    static Microsoft::WRL::ComPtr<CharacterFormatSpecifier> 
+        Intern(const CharacterFormatSpecifier & prototype);
+
+    // Set the fields in the mask; the tests are resolved at compile time
+    template<UINT32 Fields>
+    static void ApplyFields(CharacterFormatSpecifier * specifier,
+                            const FormatValues & values);
+
+    // Set the IDWriteTextLayout underline and strikethrough flags needed
+    // for DirectWrite to call DrawUnderline and DrawStrikethrough
+    static HRESULT SetDecorations(IDWriteTextLayout * textLayout,
+                                  UINT32 fields,
+                                  const FormatValues & values,
+                                  DWRITE_TEXT_RANGE textRange);
 
+    template<UINT32 Fields>
     static HRESULT SetFormatting(IDWriteTextLayout * textLayout,
                                  DWRITE_TEXT_RANGE textRange,
-        std::function<void(CharacterFormatSpecifier *)> setField);
+                                 const FormatValues & values);
 
 private:
-    LONG m_refCount;
+    friend class FormattingBatch;
+    template<typename T, typename Hasher, typename Comparer, int ShardCount>
+    friend class InternTable;
 
-    Microsoft::WRL::ComPtr<ID2D1Brush> m_foregroundBrush;
+    // Intern table hashing and comparing all the formatting fields
+    struct Hasher
+    {
+        size_t operator()(const CharacterFormatSpecifier * specifier) const;
+    };
 
-    BackgroundMode                     m_backgroundMode;
-    Microsoft::WRL::ComPtr<ID2D1Brush> m_backgroundBrush;
+    struct Comparer
+    {
+        bool operator()(const CharacterFormatSpecifier * specifier1,
+                        const CharacterFormatSpecifier * specifier2) const;
+    };
 
-    UnderlineType                      m_underlineType;
-    Microsoft::WRL::ComPtr<ID2D1Brush> m_underlineBrush;
+    static InternTable<CharacterFormatSpecifier, Hasher, Comparer> s_internTable;
 
-    int                                m_strikethroughCount;
-    Microsoft::WRL::ComPtr<ID2D1Brush> m_strikethroughBrush;
+    // AddRef unless the last reference is already being released
+    bool TryAddRef();
 
-    bool                               m_hasOverline;
-    Microsoft::WRL::ComPtr<ID2D1Brush> m_overlineBrush;
+    LONG m_refCount;
+    bool m_isInterned;
 
-    Microsoft::WRL::ComPtr<ID2D1Brush> m_highlightBrush;
+    FormatValues m_values;
 };
 
+template<UINT32 Fields>
+HRESULT CharacterFormatSpecifier::SetFormat(IDWriteTextLayout * textLayout,
+                                            const FormatValues & values,
+                                            DWRITE_TEXT_RANGE textRange)
+{
+    HRESULT hr;
+
+    if (S_OK != (hr = SetDecorations(textLayout, Fields, values, textRange)))
+    {
+        return hr;
+    }
+
+    return SetFormatting<Fields>(textLayout, textRange, values);
+}
+
+template<UINT32 Fields>
+void CharacterFormatSpecifier::ApplyFields(CharacterFormatSpecifier * specifier,
+                                           const FormatValues & values)
+{
+    if (Fields & ForegroundField)
+    {
+        specifier->m_values.foregroundBrush = values.foregroundBrush;
+    }
+
+    if (Fields & BackgroundField)
+    {
+        specifier->m_values.backgroundMode = values.backgroundMode;
+        specifier->m_values.backgroundBrush = values.backgroundBrush;
+    }
+
+    if (Fields & UnderlineField)
+    {
+        specifier->m_values.underlineType = values.underlineType;
+        specifier->m_values.underlineBrush = values.underlineBrush;
+    }
+
+    if (Fields & StrikethroughField)
+    {
+        specifier->m_values.strikethroughCount = values.strikethroughCount;
+        specifier->m_values.strikethroughBrush = values.strikethroughBrush;
+    }
+
+    if (Fields & OverlineField)
+    {
+        specifier->m_values.hasOverline = values.hasOverline;
+        specifier->m_values.overlineBrush = values.overlineBrush;
+    }
+
+    if (Fields & HighlightField)
+    {
+        specifier->m_values.highlightBrush = values.highlightBrush;
+    }
+}
+
+template<UINT32 Fields>
+HRESULT CharacterFormatSpecifier::SetFormatting(IDWriteTextLayout * textLayout,
+                                                DWRITE_TEXT_RANGE textRange,
+                                                const FormatValues & values)
+{
+    TrackedLayout::IncrementGeneration(textLayout);
+
+    // Get information from the text range to set
+    const UINT32 endPosition = textRange.startPosition + textRange.length;
+    UINT32 currentPosition = textRange.startPosition;
+
+    // Loop until we're at the end of the range
+    while (currentPosition < endPosition)
+    {
+        // Get the drawing effect at the current position
+        Microsoft::WRL::ComPtr<IUnknown> effect;
+        DWRITE_TEXT_RANGE queryTextRange;
+        HRESULT hr;
+
+        if (S_OK != (hr = textLayout->GetDrawingEffect(currentPosition, 
+                                                       &effect, 
+                                                       &queryTextRange)))
+        {
+            return hr;
+        }
+
+        // Start from default formatting or a copy of the existing one
+        CharacterFormatSpecifier * current = 
+            (CharacterFormatSpecifier *) effect.Get();
+
+        CharacterFormatSpecifier prototype;
+
+        if (current != nullptr)
+        {
+            prototype.CopyFormatting(current);
+        }
+
+        // Set the fields in the prototype
+        ApplyFields<Fields>(&prototype, values);
+
+        // Get the shared CharacterFormatSpecifier with that formatting
+        Microsoft::WRL::ComPtr<CharacterFormatSpecifier> specifier = Intern(prototype);
+
+        // Determine the text range for the new CharacterFormatSpecifier
+        UINT32 queryEndPos = queryTextRange.startPosition + queryTextRange.length;
+        UINT32 setLength = min(endPosition, queryEndPos) - currentPosition;
+
+        DWRITE_TEXT_RANGE setTextRange;
+        setTextRange.startPosition = currentPosition;
+        setTextRange.length = setLength;
+
+        // Set it, unless the range already has that formatting
+        if (specifier.Get() != current &&
+            S_OK != (hr = textLayout->SetDrawingEffect((IUnknown *) specifier.Get(), 
+                                                       setTextRange)))
+        {
+            return hr;
+        }
+
+        // Bump up the current position
+        currentPosition += setLength;
+    }
+    return S_OK;
+}
@@ -1,16 +1,51 @@
 #pragma once
+#include <atomic>
 #include "CharacterFormatSpecifier.h"
-
+#include "FontMetricsCache.h"
+#include "LayoutRecorder.h"
+#include "ObjectPool.h"
+#include "RetainedDisplayList.h"
+#include "SquigglyGeometryCache.h"
+
+// Draws an IDWriteTextLayout with CharacterFormatSpecifier drawing effects.
+// It is the IDWriteTextRenderer that walks the layout and hands the line
+// metrics, glyph runs and decorations to a LayoutRecorder, then replays the
+// display list on a Direct2D render target. Draw and Record can be called
+// from several threads at once, each with its own render target and
+// display list.
 class CharacterFormatter : public IDWriteTextRenderer
 {
 public:
     CharacterFormatter();
 
-    // Draw method
+    // Draw method; records into a pooled display list and replays it.
+    // With a clip rectangle, in the same coordinates as the origin, only
+    // the lines, glyph runs and decorations that intersect it are drawn.
     HRESULT Draw(ID2D1RenderTarget * renderTarget,
                  IDWriteTextLayout * textLayout,
                  D2D1_POINT_2F origin,
-                 ID2D1Brush * defaultBrush);
+                 ID2D1Brush * defaultBrush,
+                 const BrushPalette * brushPalette,
+                 const D2D1_RECT_F * clipRect = nullptr);
+
+    // Record method for a display list that is retained by the caller;
+    // the list is valid for this layout, origin and clip afterwards
+    HRESULT Record(ID2D1RenderTarget * renderTarget,
+                   IDWriteTextLayout * textLayout,
+                   D2D1_POINT_2F origin,
+                   RetainedDisplayList * displayList,
+                   const D2D1_RECT_F * clipRect = nullptr);
+
+    // Draw a recorded list, resolving its brushes with the palette
+    HRESULT Replay(ID2D1RenderTarget * renderTarget,
+                   const DisplayList * displayList,
+                   ID2D1Brush * defaultBrush,
+                   const BrushPalette * brushPalette);
+
+    // Decoration rectangles produced by the text layouts, and fills actually
+    // recorded after merging the pieces of adjacent glyph runs
+    UINT64 GetDecorationRectangleCount() const { return m_decorationRectangleCount; }
+    UINT64 GetDecorationFillCount() const { return m_decorationFillCount; }
 
     // IUnknown methods
     virtual ULONG STDMETHODCALLTYPE AddRef() override;
@@ -60,36 +95,31 @@ public:
 private:
     LONG m_refCount;
 
-    Microsoft::WRL::ComPtr<ID2D1RenderTarget> m_renderTarget;
-    Microsoft::WRL::ComPtr<ID2D1Brush>        m_defaultBrush;
-
-    enum class RenderPass
+    // Everything that changes during a walk of a layout lives here, and is
+    // passed through IDWriteTextLayout::Draw as the clientDrawingContext,
+    // so that one formatter can record several layouts at once. Contexts
+    // are pooled so that their buffers are reused.
+    struct DrawContext
     {
-        Initial,
-        Main,
-        Final
+        LayoutRecorder                   recorder;
+        std::vector<DWRITE_LINE_METRICS> lineMetrics;
     };
 
-    RenderPass m_renderPass;
-
-    std::vector<DWRITE_LINE_METRICS> m_lineMetrics;
-    int                              m_lineIndex;
-    int                              m_charIndex;
-   
-    D2D1::Matrix3x2F m_dpiTransform;
-    D2D1::Matrix3x2F m_renderTransform;
-    D2D1::Matrix3x2F m_worldToPixel;
-    D2D1::Matrix3x2F m_pixelToWorld;
-
-    D2D1_RECT_F GetRectangle(const DWRITE_GLYPH_RUN * glyphRun,
-                             const DWRITE_LINE_METRICS * lineMetrics,
-                             FLOAT baselineOriginX,
-                             FLOAT baselineOriginY,
-                             BackgroundMode backgroundMode);
-
-    void FillRectangle(ID2D1RenderTarget * renderTarget,
-                       ID2D1Brush * brush,
-                       float x, float y, 
-                       float width, float thickness,
-                       int offset);
+    // Shared by all draws; GetGeometry and GetMetrics are thread-safe
+    SquigglyGeometryCache m_squigglyCache;
+    FontMetricsCache      m_fontMetricsCache;
+
+    // Scratch storage reused by Record and Draw
+    ObjectPool<DrawContext> m_contextPool;
+    ObjectPool<DisplayList> m_displayListPool;
+
+    std::atomic<UINT64> m_decorationRectangleCount;
+    std::atomic<UINT64> m_decorationFillCount;
+
+    // Record without validating the list, which Draw does not retain
+    HRESULT RecordCommands(ID2D1RenderTarget * renderTarget,
+                           IDWriteTextLayout * textLayout,
+                           D2D1_POINT_2F origin,
+                           DisplayList * displayList,
+                           const D2D1_RECT_F * clipRect);
 };
@@ -1,5 +1,6 @@
 ﻿#include "pch.h"
 #include "CustomFormattingDemoRenderer.h"
+#include <algorithm>
 
 #include "Common/DirectXHelper.h"
 
@@ -9,7 +10,10 @@ using namespace D2D1;
 using namespace Microsoft::WRL;
 
 CustomFormattingDemoRenderer::CustomFormattingDemoRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources) : 
-    m_deviceResources(deviceResources)
+    m_deviceResources(deviceResources),
+    m_useBitmapCache(false),
+    m_layoutBudgetSeconds(0.004),   // A quarter of a 60 Hz frame
+    m_layoutResult(S_OK)
 {
     // Create device independent resources
     DX::ThrowIfFailed(
@@ -88,28 +92,24 @@ CustomFormattingDemoRenderer::CustomFormattingDemoRenderer(const std::shared_ptr
     // Instantiate CharacterFormatter
     m_characterFormatter = new CharacterFormatter();
 
+    m_documentLoader.reset(new DocumentLoader(m_deviceResources->GetDWriteFactory(),
+                                              textFormat.Get(),
+                                              440.0f));
+
+    SetCharacterFormatting();
     CreateDeviceDependentResources();
 }
 
-void CustomFormattingDemoRenderer::CreateDeviceDependentResources()
+// The formatting only refers to palette colors, so it is set once and
+// survives the loss of the device
+void CustomFormattingDemoRenderer::SetCharacterFormatting()
 {
-    // Create brushes and set them
-    ID2D1DeviceContext1* context = m_deviceResources->GetD2DDeviceContext();
+    FormattingBatch batch(m_textLayout.Get());
+    m_brushPalette.Clear();
 
-    ComPtr<ID2D1SolidColorBrush> redBrush;
-    DX::ThrowIfFailed(
-        context->CreateSolidColorBrush(ColorF(ColorF::Red), &redBrush)
-        );
-
-    ComPtr<ID2D1SolidColorBrush> greenBrush;
-    DX::ThrowIfFailed(
-        context->CreateSolidColorBrush(ColorF(ColorF::Green), &greenBrush)
-        );
-
-    ComPtr<ID2D1SolidColorBrush> blueBrush;
-    DX::ThrowIfFailed(
-        context->CreateSolidColorBrush(ColorF(ColorF::Blue), &blueBrush)
-        );
+    BrushIndex red = m_brushPalette.Add(ColorF(ColorF::Red));
+    BrushIndex green = m_brushPalette.Add(ColorF(ColorF::Green));
+    BrushIndex blue = m_brushPalette.Add(ColorF(ColorF::Blue));
 
     DWRITE_TEXT_RANGE textRange;
     std::wstring strFind = L"RBG";
@@ -117,32 +117,28 @@ void CustomFormattingDemoRenderer::CreateDeviceDependentResources()
     textRange.length = strFind.length();
 
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetStrikethrough(m_textLayout.Get(),
-                                                   1,
-                                                   nullptr,
-                                                   textRange)
+        batch.SetStrikethrough(1,
+                               BrushPalette::NoBrush,
+                               textRange)
         );
 
     // Individual letters after strikethrough
     textRange.length = 1;
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetForegroundBrush(m_textLayout.Get(),
-                                                     redBrush.Get(),
-                                                     textRange)
+        batch.SetForegroundBrush(red,
+                                 textRange)
         );
 
     textRange.startPosition += 1;
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetForegroundBrush(m_textLayout.Get(),
-                                                     blueBrush.Get(),
-                                                     textRange)
+        batch.SetForegroundBrush(blue,
+                                 textRange)
         );
 
     textRange.startPosition += 1;
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetForegroundBrush(m_textLayout.Get(),
-                                                     greenBrush.Get(),
-                                                     textRange)
+        batch.SetForegroundBrush(green,
+                                 textRange)
         );
 
     strFind = L"RGB";
@@ -152,59 +148,52 @@ void CustomFormattingDemoRenderer::CreateDeviceDependentResources()
     // Individual letters before underline
     textRange.length = 1;
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetForegroundBrush(m_textLayout.Get(),
-                                                     redBrush.Get(),
-                                                     textRange)
+        batch.SetForegroundBrush(red,
+                                 textRange)
         );
 
     textRange.startPosition += 1;
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetForegroundBrush(m_textLayout.Get(),
-                                                     greenBrush.Get(),
-                                                     textRange)
+        batch.SetForegroundBrush(green,
+                                 textRange)
         );
 
     textRange.startPosition += 1;
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetForegroundBrush(m_textLayout.Get(),
-                                                     blueBrush.Get(),
-                                                     textRange)
+        batch.SetForegroundBrush(blue,
+                                 textRange)
         );
 
     textRange.startPosition -= 2;
     textRange.length = 3;
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetUnderline(m_textLayout.Get(),
-                                               UnderlineType::Single,
-                                               redBrush.Get(),
-                                               textRange)
+        batch.SetUnderline(UnderlineType::Single,
+                           red,
+                           textRange)
         );
 
     strFind = L" red";      // avoid "rendered"
     textRange.startPosition = m_text.find(strFind.data()) + 1;
     textRange.length = strFind.length() - 1;
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetForegroundBrush(m_textLayout.Get(),
-                                                     redBrush.Get(),
-                                                     textRange)
+        batch.SetForegroundBrush(red,
+                                 textRange)
         );
 
     strFind = L"green";
     textRange.startPosition = m_text.find(strFind.data());
     textRange.length = strFind.length();
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetForegroundBrush(m_textLayout.Get(),
-                                                     greenBrush.Get(),
-                                                     textRange)
+        batch.SetForegroundBrush(green,
+                                 textRange)
         );
 
     strFind = L"blue";
     textRange.startPosition = m_text.find(strFind.data());
     textRange.length = strFind.length();
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetForegroundBrush(m_textLayout.Get(),
-                                                     blueBrush.Get(),
-                                                     textRange)
+        batch.SetForegroundBrush(blue,
+                                 textRange)
         );
 
     // Set custom underlining and strikethrough
@@ -213,10 +202,9 @@ void CustomFormattingDemoRenderer::CreateDeviceDependentResources()
     textRange.length = strFind.length();
 
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetUnderline(m_textLayout.Get(),
-                                               UnderlineType::Double,
-                                               redBrush.Get(),
-                                               textRange)
+        batch.SetUnderline(UnderlineType::Double,
+                           red,
+                           textRange)
         );
 
     strFind = L"triple underline";
@@ -224,10 +212,9 @@ void CustomFormattingDemoRenderer::CreateDeviceDependentResources()
     textRange.length = strFind.length();
 
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetUnderline(m_textLayout.Get(),
-                                               UnderlineType::Triple,
-                                               nullptr,
-                                               textRange)
+        batch.SetUnderline(UnderlineType::Triple,
+                           BrushPalette::NoBrush,
+                           textRange)
         );
 
     strFind = L"double strikethrough";
@@ -235,10 +222,9 @@ void CustomFormattingDemoRenderer::CreateDeviceDependentResources()
     textRange.length = strFind.length();
 
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetStrikethrough(m_textLayout.Get(),
-                                                   2,
-                                                   nullptr,
-                                                   textRange)
+        batch.SetStrikethrough(2,
+                               BrushPalette::NoBrush,
+                               textRange)
         );
 
     strFind = L"triple strikethrough";
@@ -246,10 +232,9 @@ void CustomFormattingDemoRenderer::CreateDeviceDependentResources()
     textRange.length = strFind.length();
 
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetStrikethrough(m_textLayout.Get(),
-                                                   3,
-                                                   nullptr,
-                                                   textRange)
+        batch.SetStrikethrough(3,
+                               BrushPalette::NoBrush,
+                               textRange)
         );
 
     strFind = L"combinations";
@@ -257,17 +242,15 @@ void CustomFormattingDemoRenderer::CreateDeviceDependentResources()
     textRange.length = strFind.length();
 
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetUnderline(m_textLayout.Get(),
-                                               UnderlineType::Triple,
-                                               nullptr,
-                                               textRange)
+        batch.SetUnderline(UnderlineType::Triple,
+                           BrushPalette::NoBrush,
+                           textRange)
         );
 
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetStrikethrough(m_textLayout.Get(),
-                                                   2,
-                                                   redBrush.Get(),
-                                                   textRange)
+        batch.SetStrikethrough(2,
+                               red,
+                               textRange)
         );
 
     strFind = L"thereof";
@@ -275,17 +258,15 @@ void CustomFormattingDemoRenderer::CreateDeviceDependentResources()
     textRange.length = strFind.length();
 
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetUnderline(m_textLayout.Get(),
-                                               UnderlineType::Double,
-                                               blueBrush.Get(),
-                                               textRange)
+        batch.SetUnderline(UnderlineType::Double,
+                           blue,
+                           textRange)
         );
 
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetStrikethrough(m_textLayout.Get(),
-                                                   3,
-                                                   nullptr,
-                                                   textRange)
+        batch.SetStrikethrough(3,
+                               BrushPalette::NoBrush,
+                               textRange)
         );
 
     strFind = L"overline";
@@ -293,10 +274,9 @@ void CustomFormattingDemoRenderer::CreateDeviceDependentResources()
     textRange.length = strFind.length();
 
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetOverline(m_textLayout.Get(),
-                                              true,
-                                              blueBrush.Get(),
-                                              textRange)
+        batch.SetOverline(true,
+                          blue,
+                          textRange)
         );
 
     strFind = L"squiggly (squiggly?) underline";
@@ -304,10 +284,9 @@ void CustomFormattingDemoRenderer::CreateDeviceDependentResources()
     textRange.length = strFind.length();
 
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetUnderline(m_textLayout.Get(),
-                                               UnderlineType::Squiggly,
-                                               blueBrush.Get(),
-                                               textRange)
+        batch.SetUnderline(UnderlineType::Squiggly,
+                           blue,
+                           textRange)
         );
 
     strFind = L"(squiggly?)";
@@ -319,57 +298,94 @@ void CustomFormattingDemoRenderer::CreateDeviceDependentResources()
         );
 
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetUnderline(m_textLayout.Get(),
-                                               UnderlineType::Squiggly,
-                                               redBrush.Get(),
-                                               textRange)
+        batch.SetUnderline(UnderlineType::Squiggly,
+                           red,
+                           textRange)
         );
 
     // Set background brush
-    ComPtr<ID2D1SolidColorBrush> magentaBrush;
-
-    DX::ThrowIfFailed(
-        context->CreateSolidColorBrush(ColorF(ColorF::Magenta), 
-                                              &magentaBrush)
-        );
+    BrushIndex magenta = m_brushPalette.Add(ColorF(ColorF::Magenta));
 
     strFind = L"IDWriteTextFormat and IDWriteTextLayout objects";
     textRange.startPosition = m_text.find(strFind.data());
     textRange.length = strFind.length();
 
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetBackgroundBrush(m_textLayout.Get(),
-                                                     BackgroundMode::LineHeight,
-                                                     magentaBrush.Get(), 
-                                                     textRange)
+        batch.SetBackgroundBrush(BackgroundMode::LineHeight,
+                                 magenta, 
+                                 textRange)
         );
 
     // Set highlight brush
-    ComPtr<ID2D1SolidColorBrush> highlightBrush;
-
-    DX::ThrowIfFailed(
-        context->CreateSolidColorBrush(ColorF(1.0f, 1.0f, 0, 0.5f),
-                                       &highlightBrush)
-        );
+    BrushIndex highlight = m_brushPalette.Add(ColorF(1.0f, 1.0f, 0, 0.5f));
 
     strFind = L"the SetDrawingEffect method";
     textRange.startPosition = m_text.find(strFind.data());
     textRange.length = strFind.length();
 
     DX::ThrowIfFailed(
-        CharacterFormatSpecifier::SetHighlight(m_textLayout.Get(),
-                                               highlightBrush.Get(),
-                                               textRange)
+        batch.SetHighlight(highlight,
+                           textRange)
+        );
+
+    // Apply all the character formatting at once
+    DX::ThrowIfFailed(
+        batch.Commit()
+        );
+}
+
+void CustomFormattingDemoRenderer::CreateDeviceDependentResources()
+{
+    ID2D1DeviceContext1* context = m_deviceResources->GetD2DDeviceContext();
+
+    // Create the brushes of the palette colors
+    DX::ThrowIfFailed(
+        m_brushPalette.CreateBrushes(context)
         );
 
     // Create brush for default text 
     DX::ThrowIfFailed(
         context->CreateSolidColorBrush(ColorF(ColorF::Black), &m_blackBrush)
         );
+
+    // Create brush for paragraphs that are not laid out yet
+    DX::ThrowIfFailed(
+        context->CreateSolidColorBrush(ColorF(ColorF::LightGray), &m_placeholderBrush)
+        );
 }
 void CustomFormattingDemoRenderer::ReleaseDeviceDependentResources()
 {
+    m_bitmapCache.Clear();
+    m_brushPalette.ReleaseBrushes();
+    m_documentPalette.ReleaseBrushes();
+    m_paletteDocument.reset();
+    m_logPalette.ReleaseBrushes();
+    m_paletteLog.reset();
     m_blackBrush.Reset();
+    m_placeholderBrush.Reset();
+}
+
+void CustomFormattingDemoRenderer::LoadDocument(std::vector<ParagraphSource> paragraphs, const BrushPalette& brushPalette)
+{
+    m_documentLoader->Begin(std::move(paragraphs), brushPalette);
+    m_layoutResult = S_OK;
+    SetDocument(m_documentLoader->GetDocument());
+}
+
+HRESULT CustomFormattingDemoRenderer::LoadDocumentInParallel(const std::vector<ParagraphSource>& paragraphs,
+                                                             const BrushPalette& brushPalette,
+                                                             unsigned int maxConcurrency)
+{
+    HRESULT hr;
+
+    if (S_OK != (hr = m_documentLoader->Load(paragraphs, brushPalette, maxConcurrency)))
+    {
+        return hr;
+    }
+
+    m_layoutResult = S_OK;
+    SetDocument(m_documentLoader->GetDocument());
+    return S_OK;
 }
 
 // Updates the text to be displayed.
@@ -378,15 +394,70 @@ void CustomFormattingDemoRenderer::Update(DX::StepTimer const& timer)
 }
 
 // Renders a frame to the screen.
-void CustomFormattingDemoRenderer::Render()
+void CustomFormattingDemoRenderer::Render(DX::StepTimer& timer)
 {
     ID2D1DeviceContext* context = m_deviceResources->GetD2DDeviceContext();
-    Windows::Foundation::Size logicalSize = m_deviceResources->GetLogicalSize();
+
+    // Lay out more of the document being loaded, within the budget. The
+    // loader fills in the document that LoadDocument set, so there is
+    // nothing to publish; a document set since then ends the load.
+    if (m_documentLoader->IsLoading())
+    {
+        if (m_documentLoader->GetDocument() != std::atomic_load(&m_document))
+        {
+            m_documentLoader->Cancel();
+        }
+        else
+        {
+            DX::ScopedFramePhase layoutPhase(timer, DX::FramePhase::Layout);
+
+            uint64_t deadline = timer.GetTimestamp() +
+                static_cast<uint64_t>(m_layoutBudgetSeconds * timer.GetTimestampFrequency());
+
+            // Paragraphs that fail are skipped and reported, not thrown
+            m_documentLoader->Continue([&timer, deadline]() { return timer.GetTimestamp() < deadline; });
+            m_layoutResult = m_documentLoader->GetLoadResult();
+        }
+    }
 
     context->SaveDrawingState(m_stateBlock.Get());
     context->BeginDraw();
     context->Clear(ColorF(ColorF::AliceBlue));
 
+    // A log or a loaded document replaces the demo paragraph
+    std::shared_ptr<LogDocument> log = std::atomic_load(&m_log);
+    std::shared_ptr<const Document> document = std::atomic_load(&m_document);
+
+    if (log != nullptr)
+    {
+        RenderLog(timer, log);
+    }
+    else if (document != nullptr)
+    {
+        RenderDocument(timer, document);
+    }
+    else
+    {
+        RenderParagraph(timer);
+    }
+
+    // Ignore D2DERR_RECREATE_TARGET here. This error indicates that the device
+    // is lost. It will be handled during the next call to Present.
+    HRESULT hr = context->EndDraw();
+    if (hr != D2DERR_RECREATE_TARGET)
+    {
+        DX::ThrowIfFailed(hr);
+    }
+
+    context->RestoreDrawingState(m_stateBlock.Get());
+}
+
+// Draws the demo paragraph in the center of the screen.
+void CustomFormattingDemoRenderer::RenderParagraph(DX::StepTimer& timer)
+{
+    ID2D1DeviceContext* context = m_deviceResources->GetD2DDeviceContext();
+    Windows::Foundation::Size logicalSize = m_deviceResources->GetLogicalSize();
+
     // Center text on the screen
     Matrix3x2F screenTranslation = Matrix3x2F::Translation(
         (logicalSize.Width - m_textLayout->GetMaxWidth()) / 2,
@@ -395,24 +466,190 @@ void CustomFormattingDemoRenderer::Render()
     context->SetTransform(screenTranslation *
         m_deviceResources->GetOrientationTransform2D());
 
-    // Display paragraph of text with custom text renderer
+    // Display paragraph of text with custom text renderer, recording it
+    // again only when the layout, formatting, transform, DPI or visible
+    // part of the layout has changed
     D2D1_POINT_2F origin = Point2F();
 
-    DX::ThrowIfFailed(
-        m_characterFormatter->Draw(context, 
-                                   m_textLayout.Get(), 
-                                   origin, 
-                                   m_blackBrush.Get())
-        );
+    // Visible area in layout coordinates, to cull what is off screen
+    D2D1_RECT_F clipRect = RectF(-screenTranslation._31,
+                                 -screenTranslation._32,
+                                 logicalSize.Width - screenTranslation._31,
+                                 logicalSize.Height - screenTranslation._32);
 
-    // Ignore D2DERR_RECREATE_TARGET here. This error indicates that the device
-    // is lost. It will be handled during the next call to Present.
-    HRESULT hr = context->EndDraw();
-    if (hr != D2DERR_RECREATE_TARGET)
+    // In bitmap caching mode, only a new layout, formatting, scale or DPI
+    // rasterizes the paragraph again
+    bool isDrawn = false;
+
+    if (m_useBitmapCache)
     {
-        DX::ThrowIfFailed(hr);
+        DX::ScopedFramePhase replayPhase(timer, DX::FramePhase::FormatterReplay);
+
+        HRESULT cacheHr = m_bitmapCache.Draw(context,
+                                             m_characterFormatter.Get(),
+                                             m_textLayout.Get(),
+                                             origin,
+                                             m_blackBrush.Get(),
+                                             &m_brushPalette);
+        DX::ThrowIfFailed(cacheHr);
+        isDrawn = cacheHr == S_OK;
     }
 
-    context->RestoreDrawingState(m_stateBlock.Get());
+    if (!isDrawn &&
+        !m_displayList.IsValid(context,
+                               m_textLayout.Get(),
+                               origin,
+                               &clipRect))
+    {
+        DX::ScopedFramePhase recordPhase(timer, DX::FramePhase::FormatterRecord);
+
+        DX::ThrowIfFailed(
+            m_characterFormatter->Record(context,
+                                         m_textLayout.Get(),
+                                         origin,
+                                         &m_displayList,
+                                         &clipRect)
+            );
+    }
+
+    if (!isDrawn)
+    {
+        DX::ScopedFramePhase replayPhase(timer, DX::FramePhase::FormatterReplay);
+        DX::ThrowIfFailed(
+            m_characterFormatter->Replay(context,
+                                         &m_displayList,
+                                         m_blackBrush.Get(),
+                                         &m_brushPalette)
+            );
+    }
 }
 
+// Draws the paragraphs of a document from the top of the screen, skipping
+// those that are not visible.
+void CustomFormattingDemoRenderer::RenderDocument(DX::StepTimer& timer, const std::shared_ptr<const Document>& document)
+{
+    ID2D1DeviceContext* context = m_deviceResources->GetD2DDeviceContext();
+    Windows::Foundation::Size logicalSize = m_deviceResources->GetLogicalSize();
+
+    // Brushes of the document colors, created once per document
+    if (m_paletteDocument != document)
+    {
+        m_documentPalette = document->GetBrushPalette();
+
+        DX::ThrowIfFailed(
+            m_documentPalette.CreateBrushes(context)
+            );
+
+        m_paletteDocument = document;
+    }
+
+    size_t paragraphCount = document->GetParagraphCount();
+
+    if (paragraphCount == 0)
+    {
+        return;
+    }
+
+    // Center the column of paragraphs horizontally
+    Matrix3x2F screenTranslation = Matrix3x2F::Translation(
+        (logicalSize.Width - document->GetMaxWidth()) / 2,
+        0);
+
+    context->SetTransform(screenTranslation *
+        m_deviceResources->GetOrientationTransform2D());
+
+    D2D1_RECT_F clipRect = RectF(-screenTranslation._31,
+                                 0,
+                                 logicalSize.Width - screenTranslation._31,
+                                 logicalSize.Height);
+
+    // First paragraph that starts at or above the top of the screen
+    size_t first = document->FindParagraph(clipRect.top);
+
+    DX::ScopedFramePhase recordPhase(timer, DX::FramePhase::FormatterRecord);
+
+    FLOAT top = document->GetParagraphTop(first);
+
+    for (size_t index = first; index < paragraphCount && top < clipRect.bottom; index++)
+    {
+        FLOAT bottom = document->GetParagraphTop(index + 1);
+        IDWriteTextLayout* layout = document->GetParagraph(index);
+
+        // Reserve the space of a paragraph that is not laid out yet
+        if (layout == nullptr)
+        {
+            context->FillRectangle(RectF(0, top, document->GetMaxWidth(), bottom),
+                                   m_placeholderBrush.Get());
+        }
+        else
+        {
+            DX::ThrowIfFailed(
+                m_characterFormatter->Draw(context,
+                                           layout,
+                                           Point2F(0, top),
+                                           m_blackBrush.Get(),
+                                           &m_documentPalette,
+                                           &clipRect)
+                );
+        }
+
+        top = bottom;
+    }
+}
+
+// Draws the lines at the tail of a log from the bottom of the screen up.
+// Only the visible lines are read, so the cost of a frame does not depend
+// on the length of the log or on how fast lines are appended.
+void CustomFormattingDemoRenderer::RenderLog(DX::StepTimer& timer, const std::shared_ptr<LogDocument>& log)
+{
+    ID2D1DeviceContext* context = m_deviceResources->GetD2DDeviceContext();
+    Windows::Foundation::Size logicalSize = m_deviceResources->GetLogicalSize();
+
+    // Brushes of the log colors, created once per log
+    if (m_paletteLog != log)
+    {
+        m_logPalette = log->GetBrushPalette();
+
+        DX::ThrowIfFailed(
+            m_logPalette.CreateBrushes(context)
+            );
+
+        m_paletteLog = log;
+    }
+
+    // Center the column of lines horizontally
+    Matrix3x2F screenTranslation = Matrix3x2F::Translation(
+        (logicalSize.Width - log->GetMaxWidth()) / 2,
+        0);
+
+    context->SetTransform(screenTranslation *
+        m_deviceResources->GetOrientationTransform2D());
+
+    D2D1_RECT_F clipRect = RectF(-screenTranslation._31,
+                                 0,
+                                 logicalSize.Width - screenTranslation._31,
+                                 logicalSize.Height);
+
+    log->GetTail(logicalSize.Height, &m_logLines);
+
+    DX::ScopedFramePhase recordPhase(timer, DX::FramePhase::FormatterRecord);
+
+    FLOAT bottom = logicalSize.Height;
+
+    for (const LogLine& line : m_logLines)
+    {
+        bottom -= line.height;
+
+        DX::ThrowIfFailed(
+            m_characterFormatter->Draw(context,
+                                       line.layout.Get(),
+                                       Point2F(0, bottom),
+                                       m_blackBrush.Get(),
+                                       &m_logPalette,
+                                       &clipRect)
+            );
+    }
+
+    // Keep the capacity but not the layouts, which the log may evict
+    m_logLines.clear();
+}
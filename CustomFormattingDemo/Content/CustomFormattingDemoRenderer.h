@@ -1,9 +1,14 @@
 ﻿#pragma once
 
+#include <atomic>
 #include <string>
 #include "..\Common\DeviceResources.h"
 #include "..\Common\StepTimer.h"
 #include "CharacterFormatter.h"
+#include "DocumentLoader.h"
+#include "FormattingBatch.h"
+#include "LogDocument.h"
+#include "ParagraphBitmapCache.h"
 
 namespace CustomFormattingDemo
 {
@@ -14,19 +19,84 @@ namespace CustomFormattingDemo
         void CreateDeviceDependentResources();
         void ReleaseDeviceDependentResources();
         void Update(DX::StepTimer const& timer);
-        void Render();
+        void Render(DX::StepTimer& timer);
+
+        // Composite the paragraph from a cached bitmap instead of drawing it
+        // every frame; it is drawn directly when it does not fit the budget.
+        void SetBitmapCaching(bool useBitmapCache) { m_useBitmapCache = useBitmapCache; }
+
+        // Draw a document instead of the demo paragraph; can be called from
+        // any thread, e.g. when a DocumentLoader has finished.
+        void SetDocument(const std::shared_ptr<const Document>& document) { std::atomic_store(&m_document, document); }
+
+        // Lay out a document a slice at a time at the start of each frame,
+        // drawing placeholders for the paragraphs that are not laid out yet.
+        void LoadDocument(std::vector<ParagraphSource> paragraphs, const BrushPalette& brushPalette);
+
+        // Lay out a whole document at once on up to maxConcurrency threads,
+        // zero for all cores, and show it; the current document is kept if
+        // a paragraph fails.
+        HRESULT LoadDocumentInParallel(const std::vector<ParagraphSource>& paragraphs,
+                                       const BrushPalette& brushPalette,
+                                       unsigned int maxConcurrency = 0);
+        bool IsLayoutPending() const { return m_documentLoader->IsLoading(); }
+
+        // First paragraph failure of the last LoadDocument, or S_OK; failed
+        // paragraphs are skipped instead of failing the frame.
+        HRESULT GetLayoutResult() const { return m_layoutResult; }
+
+        // Time each frame may spend on layout; see FramePhase::Layout.
+        void SetLayoutBudgetSeconds(double seconds) { m_layoutBudgetSeconds = seconds; }
+        double GetLayoutBudgetSeconds() const { return m_layoutBudgetSeconds; }
+
+        // Show the tail of a live log instead of a document, newest line at
+        // the bottom; lines can be appended to it from any thread.
+        void SetLog(const std::shared_ptr<LogDocument>& log) { std::atomic_store(&m_log, log); }
 
     private:
+        void SetCharacterFormatting();
+        void RenderParagraph(DX::StepTimer& timer);
+        void RenderDocument(DX::StepTimer& timer, const std::shared_ptr<const Document>& document);
+        void RenderLog(DX::StepTimer& timer, const std::shared_ptr<LogDocument>& log);
+
         // Cached pointer to device resources.
         std::shared_ptr<DX::DeviceResources> m_deviceResources;
 
         // Resources related to text rendering.
         std::wstring                                    m_text;
         Microsoft::WRL::ComPtr<ID2D1SolidColorBrush>    m_blackBrush;
+        Microsoft::WRL::ComPtr<ID2D1SolidColorBrush>    m_placeholderBrush;
         Microsoft::WRL::ComPtr<ID2D1DrawingStateBlock>  m_stateBlock;
         Microsoft::WRL::ComPtr<IDWriteTextLayout>       m_textLayout;
         DWRITE_TEXT_METRICS                             m_textMetrics;
 
         Microsoft::WRL::ComPtr<CharacterFormatter>      m_characterFormatter;
+
+        // Colors referred to by the character formatting, and their brushes.
+        BrushPalette                                    m_brushPalette;
+
+        // Rendering of the text layout retained across frames.
+        RetainedDisplayList                             m_displayList;
+
+        // Rasterized paragraphs, used when bitmap caching is on.
+        ParagraphBitmapCache                            m_bitmapCache;
+        std::atomic<bool>                               m_useBitmapCache;
+
+        // Document published by a loader, and the brushes of its colors.
+        std::shared_ptr<const Document>                 m_document;
+        std::shared_ptr<const Document>                 m_paletteDocument;
+        BrushPalette                                    m_documentPalette;
+
+        // Incremental layout of a document.
+        std::unique_ptr<DocumentLoader>                 m_documentLoader;
+        std::atomic<double>                             m_layoutBudgetSeconds;
+        std::atomic<HRESULT>                            m_layoutResult;
+
+        // Log shown instead of a document, the brushes of its colors, and
+        // the visible lines of the frame being drawn.
+        std::shared_ptr<LogDocument>                    m_log;
+        std::shared_ptr<LogDocument>                    m_paletteLog;
+        BrushPalette                                    m_logPalette;
+        std::vector<LogLine>                            m_logLines;
     };
 }
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "pch.h"
+#include "D2DRenderSink.h"
+
+using namespace D2D1;
+using namespace Microsoft::WRL;
+
+D2DRenderSink::D2DRenderSink(ID2D1RenderTarget * renderTarget,
+                             ID2D1Brush * defaultBrush,
+                             const BrushPalette * brushPalette,
+                             SquigglyGeometryCache * squigglyCache) :
+    m_renderTarget(renderTarget),
+    m_defaultBrush(defaultBrush),
+    m_brushPalette(brushPalette),
+    m_squigglyCache(squigglyCache),
+    m_hr(S_OK)
+{
+    m_renderTarget->GetFactory(&m_factory);
+}
+
+void D2DRenderSink::BeginPass(RenderPass pass)
+{
+}
+
+void D2DRenderSink::FillRectangle(const RenderRect & rect,
+                                  BrushIndex brush)
+{
+    ID2D1Brush * d2dBrush = GetBrush(brush);
+
+    if (d2dBrush != nullptr)
+    {
+        m_renderTarget->FillRectangle(RectF(rect.left, rect.top, rect.right, rect.bottom),
+                                      d2dBrush);
+    }
+}
+
+void D2DRenderSink::DrawGlyphRun(RenderPoint baselineOrigin,
+                                 const DWRITE_GLYPH_RUN * glyphRun,
+                                 BrushIndex brush,
+                                 DWRITE_MEASURING_MODE measuringMode)
+{
+    ID2D1Brush * d2dBrush = GetBrush(brush);
+
+    if (d2dBrush != nullptr)
+    {
+        m_renderTarget->DrawGlyphRun(Point2F(baselineOrigin.x, baselineOrigin.y),
+                                     glyphRun,
+                                     d2dBrush,
+                                     measuringMode);
+    }
+}
+
+void D2DRenderSink::DrawSquiggly(RenderPoint offset,
+                                 const SquigglyLine & squiggly,
+                                 BrushIndex brush)
+{
+    ID2D1Brush * d2dBrush = GetBrush(brush);
+
+    if (d2dBrush == nullptr)
+    {
+        return;
+    }
+
+    // Identical squiggles anywhere on the page share one geometry
+    ComPtr<ID2D1Geometry> geometry;
+    HRESULT hr;
+
+    if (S_OK != (hr = m_squigglyCache->GetGeometry(m_factory.Get(),
+                                                   squiggly.thickness,
+                                                   squiggly.width,
+                                                   squiggly.phase,
+                                                   squiggly.pixelsPerDip,
+                                                   &geometry)))
+    {
+        if (m_hr == S_OK)
+        {
+            m_hr = hr;
+        }
+
+        return;
+    }
+
+    D2D1_MATRIX_3X2_F transform;
+    m_renderTarget->GetTransform(&transform);
+    m_renderTarget->SetTransform(
+        Matrix3x2F::Translation(offset.x, offset.y) *
+        *Matrix3x2F::ReinterpretBaseType(&transform));
+
+    m_renderTarget->DrawGeometry(geometry.Get(), d2dBrush, squiggly.thickness);
+
+    m_renderTarget->SetTransform(transform);
+}
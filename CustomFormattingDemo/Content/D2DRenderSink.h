@@ -0,0 +1,47 @@
+#pragma once
+#include "BrushPalette.h"
+#include "RenderSink.h"
+#include "SquigglyGeometryCache.h"
+
+// Draws the commands on a Direct2D render target. Brush indices are
+// resolved with the palette, NoBrush being the default brush; commands
+// whose brush is not in the palette, or not created yet, are skipped.
+// Squiggles are drawn with shared geometries from the cache.
+class D2DRenderSink : public RenderSink
+{
+public:
+    D2DRenderSink(ID2D1RenderTarget * renderTarget,
+                  ID2D1Brush * defaultBrush,
+                  const BrushPalette * brushPalette,
+                  SquigglyGeometryCache * squigglyCache);
+
+    // First failure to create a squiggly geometry, or S_OK
+    HRESULT GetResult() const { return m_hr; }
+
+    virtual void BeginPass(RenderPass pass) override;
+
+    virtual void FillRectangle(const RenderRect & rect,
+                               BrushIndex brush) override;
+
+    virtual void DrawGlyphRun(RenderPoint baselineOrigin,
+                              const DWRITE_GLYPH_RUN * glyphRun,
+                              BrushIndex brush,
+                              DWRITE_MEASURING_MODE measuringMode) override;
+
+    virtual void DrawSquiggly(RenderPoint offset,
+                              const SquigglyLine & squiggly,
+                              BrushIndex brush) override;
+
+private:
+    ID2D1Brush * GetBrush(BrushIndex index) const
+    {
+        return index == NoBrush ? m_defaultBrush : m_brushPalette->GetBrush(index);
+    }
+
+    ID2D1RenderTarget *                  m_renderTarget;
+    ID2D1Brush *                         m_defaultBrush;
+    const BrushPalette *                 m_brushPalette;
+    SquigglyGeometryCache *              m_squigglyCache;
+    Microsoft::WRL::ComPtr<ID2D1Factory> m_factory;
+    HRESULT                              m_hr;
+};
@@ -0,0 +1,69 @@
+#include "pch.h"
+#include "DecorationCoalescer.h"
+
+// Runs that abut can differ by rounding in their accumulated advances
+static const float AdjacencyTolerance = 0.01f;
+
+DecorationCoalescer::DecorationCoalescer() :
+    m_spanCount(0),
+    m_rectangleCount(0),
+    m_fillCount(0)
+{
+}
+
+void DecorationCoalescer::Add(const RenderRect & rect,
+                              BrushIndex brush,
+                              DisplayList * displayList)
+{
+    m_rectangleCount++;
+
+    // Pixel snapping gives pieces on the same line identical y coordinates
+    for (int index = 0; index < m_spanCount; index++)
+    {
+        Span & span = m_spans[index];
+
+        if (span.brush == brush &&
+            span.rect.top == rect.top &&
+            span.rect.bottom == rect.bottom &&
+            rect.left <= span.rect.right + AdjacencyTolerance &&
+            rect.right >= span.rect.left - AdjacencyTolerance)
+        {
+            span.rect.left = min(span.rect.left, rect.left);
+            span.rect.right = max(span.rect.right, rect.right);
+            return;
+        }
+    }
+
+    // Make room by recording the oldest span
+    if (m_spanCount == MaxPendingSpans)
+    {
+        Record(0, displayList);
+    }
+
+    m_spans[m_spanCount].rect = rect;
+    m_spans[m_spanCount].brush = brush;
+    m_spanCount++;
+}
+
+void DecorationCoalescer::Flush(DisplayList * displayList)
+{
+    while (m_spanCount > 0)
+    {
+        Record(0, displayList);
+    }
+}
+
+void DecorationCoalescer::Record(int index, DisplayList * displayList)
+{
+    displayList->AddFillRectangle(RenderPass::Main, 
+                                  m_spans[index].rect, 
+                                  m_spans[index].brush);
+    m_fillCount++;
+
+    for (int next = index + 1; next < m_spanCount; next++)
+    {
+        m_spans[next - 1] = m_spans[next];
+    }
+
+    m_spanCount--;
+}
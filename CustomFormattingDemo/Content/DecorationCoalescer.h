@@ -0,0 +1,45 @@
+#pragma once
+#include "DisplayList.h"
+
+// Merges the decoration rectangles of adjacent glyph runs before they are
+// recorded. Formatting that does not change a decoration, such as a new
+// foreground color, splits the text into runs, and each run draws its own
+// piece of the underline; collinear pieces with the same brush that touch
+// are recorded as a single rectangle instead.
+class DecorationCoalescer
+{
+public:
+    DecorationCoalescer();
+
+    // Add a rectangle of the main pass, merging it with a pending one
+    void Add(const RenderRect & rect,
+             BrushIndex brush,
+             DisplayList * displayList);
+
+    // Record all pending rectangles. Must be called before anything else
+    // is recorded in the main pass, so that the rectangles keep their
+    // place in painter's order.
+    void Flush(DisplayList * displayList);
+
+    // Rectangles added, and rectangles actually recorded
+    UINT32 GetRectangleCount() const { return m_rectangleCount; }
+    UINT32 GetFillCount() const { return m_fillCount; }
+
+    // Triple underlines, an overline and triple strikethroughs can all be
+    // open at once
+    static const int MaxPendingSpans = 8;
+
+private:
+    struct Span
+    {
+        RenderRect rect;
+        BrushIndex brush;
+    };
+
+    void Record(int index, DisplayList * displayList);
+
+    Span   m_spans[MaxPendingSpans];
+    int    m_spanCount;
+    UINT32 m_rectangleCount;
+    UINT32 m_fillCount;
+};
@@ -0,0 +1,145 @@
+#include "pch.h"
+#include "DisplayList.h"
+
+DisplayList::DisplayList()
+{
+}
+
+void DisplayList::Clear()
+{
+    for (auto & commands : m_commands)
+    {
+        commands.clear();
+    }
+
+    m_glyphRuns.clear();
+    m_glyphIndices.clear();
+    m_glyphAdvances.clear();
+    m_glyphOffsets.clear();
+    m_squigglies.clear();
+}
+
+void DisplayList::AddFillRectangle(RenderPass pass,
+                                   const RenderRect & rect,
+                                   BrushIndex brush)
+{
+    Command command = {};
+    command.type = CommandType::FillRectangle;
+    command.brush = brush;
+    command.rect = rect;
+
+    m_commands[(int) pass].push_back(command);
+}
+
+void DisplayList::AddGlyphRun(RenderPass pass,
+                              RenderPoint baselineOrigin,
+                              const DWRITE_GLYPH_RUN * glyphRun,
+                              DWRITE_MEASURING_MODE measuringMode,
+                              BrushIndex brush)
+{
+    GlyphRunRecord record;
+    record.fontFace = glyphRun->fontFace;
+    record.fontEmSize = glyphRun->fontEmSize;
+    record.glyphCount = glyphRun->glyphCount;
+    record.firstGlyph = (UINT32) m_glyphIndices.size();
+    record.hasOffsets = glyphRun->glyphOffsets != nullptr;
+    record.isSideways = glyphRun->isSideways;
+    record.bidiLevel = glyphRun->bidiLevel;
+    record.measuringMode = measuringMode;
+
+    // Copy the glyph arrays, keeping the three buffers the same length
+    UINT32 count = glyphRun->glyphCount;
+
+    m_glyphIndices.insert(m_glyphIndices.end(),
+                          glyphRun->glyphIndices,
+                          glyphRun->glyphIndices + count);
+
+    m_glyphAdvances.insert(m_glyphAdvances.end(),
+                           glyphRun->glyphAdvances,
+                           glyphRun->glyphAdvances + count);
+
+    if (record.hasOffsets)
+    {
+        m_glyphOffsets.insert(m_glyphOffsets.end(),
+                              glyphRun->glyphOffsets,
+                              glyphRun->glyphOffsets + count);
+    }
+    else
+    {
+        m_glyphOffsets.resize(m_glyphOffsets.size() + count);
+    }
+
+    Command command = {};
+    command.type = CommandType::GlyphRun;
+    command.brush = brush;
+    command.origin = baselineOrigin;
+    command.index = (UINT32) m_glyphRuns.size();
+
+    m_glyphRuns.push_back(record);
+    m_commands[(int) pass].push_back(command);
+}
+
+void DisplayList::AddSquiggly(RenderPass pass,
+                              RenderPoint offset,
+                              const SquigglyLine & squiggly,
+                              BrushIndex brush)
+{
+    Command command = {};
+    command.type = CommandType::Squiggly;
+    command.brush = brush;
+    command.origin = offset;
+    command.index = (UINT32) m_squigglies.size();
+
+    m_squigglies.push_back(squiggly);
+    m_commands[(int) pass].push_back(command);
+}
+
+void DisplayList::Replay(RenderSink * sink) const
+{
+    for (int pass = 0; pass < 3; pass++)
+    {
+        sink->BeginPass((RenderPass) pass);
+
+        for (const Command & command : m_commands[pass])
+        {
+            switch (command.type)
+            {
+                case CommandType::FillRectangle:
+                {
+                    sink->FillRectangle(command.rect, command.brush);
+                    break;
+                }
+
+                case CommandType::GlyphRun:
+                {
+                    const GlyphRunRecord & record = m_glyphRuns[command.index];
+
+                    DWRITE_GLYPH_RUN glyphRun;
+                    glyphRun.fontFace = record.fontFace.Get();
+                    glyphRun.fontEmSize = record.fontEmSize;
+                    glyphRun.glyphCount = record.glyphCount;
+                    glyphRun.glyphIndices = m_glyphIndices.data() + record.firstGlyph;
+                    glyphRun.glyphAdvances = m_glyphAdvances.data() + record.firstGlyph;
+                    glyphRun.glyphOffsets = record.hasOffsets ?
+                        m_glyphOffsets.data() + record.firstGlyph : nullptr;
+                    glyphRun.isSideways = record.isSideways;
+                    glyphRun.bidiLevel = record.bidiLevel;
+
+                    sink->DrawGlyphRun(command.origin,
+                                       &glyphRun,
+                                       command.brush,
+                                       record.measuringMode);
+                    break;
+                }
+
+                case CommandType::Squiggly:
+                {
+                    sink->DrawSquiggly(command.origin,
+                                       m_squigglies[command.index],
+                                       command.brush);
+                    break;
+                }
+            }
+        }
+    }
+}
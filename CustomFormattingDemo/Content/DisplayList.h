@@ -0,0 +1,74 @@
+#pragma once
+#include <vector>
+#include "RenderSink.h"
+
+// A compact list of drawing commands recorded during a single walk of an
+// IDWriteTextLayout, replayed pass by pass to preserve the painter's order.
+// Brushes are BrushPalette indices and squiggles are parameters, so the
+// list does not depend on the device and survives the loss of it.
+// RetainedDisplayList adds the validity of a list kept across frames.
+class DisplayList
+{
+public:
+    DisplayList();
+
+    // Remove all commands but keep the allocated storage
+    void Clear();
+
+    // Record methods
+    void AddFillRectangle(RenderPass pass,
+                          const RenderRect & rect,
+                          BrushIndex brush);
+
+    void AddGlyphRun(RenderPass pass,
+                     RenderPoint baselineOrigin,
+                     const DWRITE_GLYPH_RUN * glyphRun,
+                     DWRITE_MEASURING_MODE measuringMode,
+                     BrushIndex brush);
+
+    void AddSquiggly(RenderPass pass,
+                     RenderPoint offset,
+                     const SquigglyLine & squiggly,
+                     BrushIndex brush);
+
+    // Send all the commands to a sink, pass by pass
+    void Replay(RenderSink * sink) const;
+
+private:
+    enum class CommandType
+    {
+        FillRectangle,
+        GlyphRun,
+        Squiggly
+    };
+
+    struct Command
+    {
+        CommandType  type;
+        BrushIndex   brush;
+        RenderRect   rect;          // FillRectangle
+        RenderPoint  origin;        // GlyphRun, Squiggly
+        UINT32       index;         // GlyphRun, Squiggly
+    };
+
+    // Glyph runs only live for the duration of the IDWriteTextRenderer
+    // callback, so their arrays are copied into flat shared buffers
+    struct GlyphRunRecord
+    {
+        Microsoft::WRL::ComPtr<IDWriteFontFace> fontFace;
+        FLOAT                 fontEmSize;
+        UINT32                glyphCount;
+        UINT32                firstGlyph;
+        BOOL                  hasOffsets;
+        BOOL                  isSideways;
+        UINT32                bidiLevel;
+        DWRITE_MEASURING_MODE measuringMode;
+    };
+
+    std::vector<Command>            m_commands[3];
+    std::vector<GlyphRunRecord>     m_glyphRuns;
+    std::vector<UINT16>             m_glyphIndices;
+    std::vector<FLOAT>              m_glyphAdvances;
+    std::vector<DWRITE_GLYPH_OFFSET> m_glyphOffsets;
+    std::vector<SquigglyLine>       m_squigglies;
+};
@@ -0,0 +1,311 @@
+#include "pch.h"
+#include "DocumentLoader.h"
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <ppl.h>
+
+using namespace Microsoft::WRL;
+
+namespace
+{
+    // Makes a scheduler of at most maxConcurrency threads the current one
+    // of this thread for its lifetime, so that it is detached however the
+    // scope is left; zero keeps the default scheduler
+    class ScopedScheduler
+    {
+    public:
+        explicit ScopedScheduler(unsigned int maxConcurrency) :
+            m_isAttached(false)
+        {
+            if (maxConcurrency != 0)
+            {
+                Concurrency::SchedulerPolicy policy(2,
+                                                    Concurrency::MinConcurrency, maxConcurrency,
+                                                    Concurrency::MaxConcurrency, maxConcurrency);
+                Concurrency::CurrentScheduler::Create(policy);
+                m_isAttached = true;
+            }
+        }
+
+        ~ScopedScheduler()
+        {
+            if (m_isAttached)
+            {
+                Concurrency::CurrentScheduler::Detach();
+            }
+        }
+
+    private:
+        ScopedScheduler(const ScopedScheduler &);
+        ScopedScheduler & operator=(const ScopedScheduler &);
+
+        bool m_isAttached;
+    };
+}
+
+Document::Document(FLOAT maxWidth, const BrushPalette & brushPalette) :
+    m_tops(1, 0.0f),
+    m_estimatedTops(1, 0.0f),
+    m_laidOutCount(0),
+    m_maxWidth(maxWidth),
+    m_brushPalette(brushPalette)
+{
+    m_brushPalette.ReleaseBrushes();
+}
+
+FLOAT Document::GetParagraphTop(size_t index) const
+{
+    size_t laidOutCount = GetLaidOutCount();
+
+    if (index <= laidOutCount)
+    {
+        return m_tops[index];
+    }
+
+    return m_tops[laidOutCount] + m_estimatedTops[index] - m_estimatedTops[laidOutCount];
+}
+
+size_t Document::FindParagraph(FLOAT y) const
+{
+    // Binary search on the tops, which increase with the index
+    size_t low = 0;
+    size_t high = GetParagraphCount();
+
+    while (high - low > 1)
+    {
+        size_t middle = low + (high - low) / 2;
+
+        if (GetParagraphTop(middle) <= y)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+void Document::SetEstimatedHeights(const std::vector<FLOAT> & heights)
+{
+    // Sized once, so that the loader never reallocates what readers see
+    m_layouts.resize(heights.size());
+    m_tops.resize(heights.size() + 1);
+    m_estimatedTops.resize(heights.size() + 1);
+
+    for (size_t index = 0; index < heights.size(); index++)
+    {
+        m_estimatedTops[index + 1] = m_estimatedTops[index] + heights[index];
+    }
+}
+
+void Document::SetParagraph(size_t index,
+                            const ComPtr<IDWriteTextLayout> & textLayout,
+                            FLOAT height)
+{
+    m_layouts[index] = textLayout;
+    m_tops[index + 1] = m_tops[index] + height;
+}
+
+void Document::Publish(size_t laidOutCount)
+{
+    m_laidOutCount.store(laidOutCount, std::memory_order_release);
+}
+
+DocumentLoader::DocumentLoader(IDWriteFactory * dwriteFactory,
+                               IDWriteTextFormat * textFormat,
+                               FLOAT maxWidth) :
+    m_dwriteFactory(dwriteFactory),
+    m_textFormat(textFormat),
+    m_maxWidth(maxWidth),
+    m_loadSeconds(0),
+    m_nextParagraph(0),
+    m_loadResult(S_OK)
+{
+}
+
+HRESULT DocumentLoader::Load(const std::vector<ParagraphSource> & paragraphs,
+                             const BrushPalette & brushPalette,
+                             unsigned int maxConcurrency)
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    Cancel();
+
+    std::vector<ComPtr<IDWriteTextLayout>> layouts(paragraphs.size());
+    std::vector<FLOAT> heights(paragraphs.size());
+
+    // Paragraphs are independent: idle threads steal the remaining ones
+    std::atomic<HRESULT> result(S_OK);
+
+    {
+        // A scheduler of our own limits the number of threads; it is
+        // detached even if parallel_for throws
+        ScopedScheduler scheduler(maxConcurrency);
+
+        Concurrency::parallel_for(size_t(0), paragraphs.size(), [&](size_t index)
+        {
+            if (result != S_OK)
+            {
+                return;
+            }
+
+            HRESULT hr = CreateParagraph(paragraphs[index],
+                                         &layouts[index],
+                                         &heights[index]);
+
+            if (hr != S_OK)
+            {
+                HRESULT expected = S_OK;
+                result.compare_exchange_strong(expected, hr);
+            }
+        });
+    }
+
+    if (result != S_OK)
+    {
+        return result;
+    }
+
+    // Stack the paragraphs, all laid out
+    std::shared_ptr<Document> document = std::make_shared<Document>(m_maxWidth, brushPalette);
+    document->SetEstimatedHeights(heights);
+
+    for (size_t index = 0; index < layouts.size(); index++)
+    {
+        document->SetParagraph(index, layouts[index], heights[index]);
+    }
+
+    document->Publish(layouts.size());
+    std::atomic_store(&m_document, std::shared_ptr<const Document>(document));
+
+    m_loadSeconds = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - startTime).count();
+    return S_OK;
+}
+
+void DocumentLoader::Begin(std::vector<ParagraphSource> paragraphs,
+                           const BrushPalette & brushPalette)
+{
+    m_sources = std::move(paragraphs);
+    m_nextParagraph = 0;
+    m_loadResult = S_OK;
+
+    // Reserve about half an em per character and 1.2 em per line until
+    // the paragraphs are laid out
+    FLOAT fontSize = m_textFormat->GetFontSize();
+    std::vector<FLOAT> heights(m_sources.size());
+
+    for (size_t index = 0; index < m_sources.size(); index++)
+    {
+        FLOAT lineCount = std::ceil(m_sources[index].text.length() * 0.5f * fontSize / m_maxWidth);
+        heights[index] = max(1.0f, lineCount) * 1.2f * fontSize;
+    }
+
+    m_loadingDocument = std::make_shared<Document>(m_maxWidth, brushPalette);
+    m_loadingDocument->SetEstimatedHeights(heights);
+
+    std::atomic_store(&m_document, std::shared_ptr<const Document>(m_loadingDocument));
+}
+
+void DocumentLoader::Cancel()
+{
+    // The paragraphs published so far stay in the document
+    m_sources.clear();
+    m_loadingDocument.reset();
+    m_nextParagraph = 0;
+}
+
+HRESULT CreateParagraphLayout(IDWriteFactory * dwriteFactory,
+                              IDWriteTextFormat * textFormat,
+                              FLOAT maxWidth,
+                              const ParagraphSource & source,
+                              ComPtr<IDWriteTextLayout> * textLayout,
+                              FLOAT * height)
+{
+    HRESULT hr;
+    ComPtr<IDWriteTextLayout> layout;
+
+    if (S_OK != (hr = dwriteFactory->CreateTextLayout(
+                            source.text.c_str(),
+                            (UINT32) source.text.length(),
+                            textFormat,
+                            maxWidth,
+                            std::numeric_limits<float>::infinity(),
+                            &layout)))
+    {
+        return hr;
+    }
+
+    FormattingBatch batch(layout.Get());
+
+    for (const FormatRange & range : source.formatting)
+    {
+        const FormatValues & values = range.values;
+        hr = S_OK;
+
+        if ((range.fields & ForegroundField) && hr == S_OK)
+        {
+            hr = batch.SetForegroundBrush(values.foregroundBrush, range.textRange);
+        }
+
+        if ((range.fields & BackgroundField) && hr == S_OK)
+        {
+            hr = batch.SetBackgroundBrush(values.backgroundMode,
+                                          values.backgroundBrush,
+                                          range.textRange);
+        }
+
+        if ((range.fields & UnderlineField) && hr == S_OK)
+        {
+            hr = batch.SetUnderline(values.underlineType,
+                                    values.underlineBrush,
+                                    range.textRange);
+        }
+
+        if ((range.fields & StrikethroughField) && hr == S_OK)
+        {
+            hr = batch.SetStrikethrough(values.strikethroughCount,
+                                        values.strikethroughBrush,
+                                        range.textRange);
+        }
+
+        if ((range.fields & OverlineField) && hr == S_OK)
+        {
+            hr = batch.SetOverline(values.hasOverline,
+                                   values.overlineBrush,
+                                   range.textRange);
+        }
+
+        if ((range.fields & HighlightField) && hr == S_OK)
+        {
+            hr = batch.SetHighlight(values.highlightBrush, range.textRange);
+        }
+
+        if (hr != S_OK)
+        {
+            return hr;
+        }
+    }
+
+    if (S_OK != (hr = batch.Commit()))
+    {
+        return hr;
+    }
+
+    // Line breaking is done here, on this thread, rather than on the
+    // render thread when the paragraph is first drawn
+    DWRITE_TEXT_METRICS textMetrics;
+
+    if (S_OK != (hr = layout->GetMetrics(&textMetrics)))
+    {
+        return hr;
+    }
+
+    *height = textMetrics.height;
+    *textLayout = layout;
+    return S_OK;
+}
@@ -0,0 +1,202 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include "FormattingBatch.h"
+
+// A range of character formatting of a paragraph: the fields of the mask
+// are set from the values, whose brushes index the palette of the document
+struct FormatRange
+{
+    DWRITE_TEXT_RANGE textRange;
+    UINT32            fields;
+    FormatValues      values;
+};
+
+struct ParagraphSource
+{
+    std::wstring             text;
+    std::vector<FormatRange> formatting;
+};
+
+// Creates the layout of a paragraph, applies its formatting and breaks it
+// into lines; can be called from any thread
+HRESULT CreateParagraphLayout(IDWriteFactory * dwriteFactory,
+                              IDWriteTextFormat * textFormat,
+                              FLOAT maxWidth,
+                              const ParagraphSource & source,
+                              Microsoft::WRL::ComPtr<IDWriteTextLayout> * textLayout,
+                              FLOAT * height);
+
+// Paragraph layouts, stacked from top to bottom, shared by threads.
+// Paragraphs are laid out in order: the first GetLaidOutCount() ones have
+// their layouts and final heights, and the others are placeholders whose
+// heights are estimated. A document being loaded only grows: the loader
+// fills in the next paragraphs, past the laid-out count that readers see,
+// and then publishes a larger count, so publishing costs nothing more
+// than laying out the paragraphs did.
+class Document
+{
+public:
+    Document(FLOAT maxWidth, const BrushPalette & brushPalette);
+
+    size_t GetParagraphCount() const { return m_layouts.size(); }
+
+    size_t GetLaidOutCount() const
+    {
+        return m_laidOutCount.load(std::memory_order_acquire);
+    }
+
+    // Null for a placeholder, or a paragraph that failed to lay out
+    IDWriteTextLayout * GetParagraph(size_t index) const
+    {
+        return index < GetLaidOutCount() ? m_layouts[index].Get() : nullptr;
+    }
+
+    // Top of a paragraph; the top of GetParagraphCount() is the height of
+    // the document
+    FLOAT GetParagraphTop(size_t index) const;
+
+    // Last paragraph that starts at or above y, or the first one
+    size_t FindParagraph(FLOAT y) const;
+
+    // Width of the layouts
+    FLOAT GetMaxWidth() const { return m_maxWidth; }
+
+    // Colors of the formatting; brushes are created by the renderer
+    const BrushPalette & GetBrushPalette() const { return m_brushPalette; }
+
+private:
+    friend class DocumentLoader;
+
+    // Only called by the loader, before the document is shared or on the
+    // paragraphs past the laid-out count
+    void SetEstimatedHeights(const std::vector<FLOAT> & heights);
+    void SetParagraph(size_t index,
+                      const Microsoft::WRL::ComPtr<IDWriteTextLayout> & textLayout,
+                      FLOAT height);
+    void Publish(size_t laidOutCount);
+
+    std::vector<Microsoft::WRL::ComPtr<IDWriteTextLayout>> m_layouts;
+
+    // Tops of the laid-out paragraphs and of the one after them, and
+    // running sums of the estimated heights of all of them; placeholders
+    // are stacked from the last laid-out paragraph with the estimates
+    std::vector<FLOAT> m_tops;
+    std::vector<FLOAT> m_estimatedTops;
+
+    std::atomic<size_t> m_laidOutCount;
+
+    FLOAT        m_maxWidth;
+    BrushPalette m_brushPalette;
+};
+
+// Creates the layouts of the paragraphs of a document and applies their
+// formatting in parallel, on the work-stealing scheduler of the
+// Concurrency Runtime, then publishes the finished document at once.
+class DocumentLoader
+{
+public:
+    DocumentLoader(IDWriteFactory * dwriteFactory,
+                   IDWriteTextFormat * textFormat,
+                   FLOAT maxWidth);
+
+    // Load runs on at most maxConcurrency threads; zero uses all cores.
+    // The published document is unchanged if any paragraph fails. Load
+    // cancels an incremental load, so it must not run at the same time as
+    // Begin or Continue: the renderer calls all three under the render
+    // lock of CustomFormattingDemoMain.
+    HRESULT Load(const std::vector<ParagraphSource> & paragraphs,
+                 const BrushPalette & brushPalette,
+                 unsigned int maxConcurrency = 0);
+
+    // Incremental loading on one thread. Begin publishes a document of
+    // placeholders; each call to Continue lays out paragraphs in order,
+    // at least one and then as long as hasTimeLeft() returns true, and
+    // publishes them in the same document. A paragraph that fails to lay
+    // out is skipped: it keeps no layout and no height, and the load goes
+    // on. Load and Cancel end an incremental load.
+    void Begin(std::vector<ParagraphSource> paragraphs,
+               const BrushPalette & brushPalette);
+
+    template<typename THasTimeLeft>
+    void Continue(const THasTimeLeft & hasTimeLeft);
+
+    void Cancel();
+
+    bool IsLoading() const { return m_nextParagraph < m_sources.size(); }
+
+    // First failure of the last incremental load, or S_OK if every
+    // paragraph so far was laid out
+    HRESULT GetLoadResult() const { return m_loadResult; }
+
+    // The last document loaded, or null; can be called from any thread
+    std::shared_ptr<const Document> GetDocument() const
+    {
+        return std::atomic_load(&m_document);
+    }
+
+    // Wall time of the last successful Load, to compare concurrency levels
+    double GetLoadSeconds() const { return m_loadSeconds; }
+
+private:
+    HRESULT CreateParagraph(const ParagraphSource & source,
+                            Microsoft::WRL::ComPtr<IDWriteTextLayout> * textLayout,
+                            FLOAT * height)
+    {
+        return CreateParagraphLayout(m_dwriteFactory.Get(), m_textFormat.Get(), m_maxWidth,
+                                     source, textLayout, height);
+    }
+
+    Microsoft::WRL::ComPtr<IDWriteFactory>    m_dwriteFactory;
+    Microsoft::WRL::ComPtr<IDWriteTextFormat> m_textFormat;
+    FLOAT                                     m_maxWidth;
+
+    std::shared_ptr<const Document> m_document;
+    double                          m_loadSeconds;
+
+    // State of an incremental load, which fills in the published document
+    std::vector<ParagraphSource> m_sources;
+    std::shared_ptr<Document>    m_loadingDocument;
+    size_t                       m_nextParagraph;
+    HRESULT                      m_loadResult;
+};
+
+template<typename THasTimeLeft>
+void DocumentLoader::Continue(const THasTimeLeft & hasTimeLeft)
+{
+    if (!IsLoading())
+    {
+        return;
+    }
+
+    do
+    {
+        Microsoft::WRL::ComPtr<IDWriteTextLayout> layout;
+        FLOAT height;
+
+        HRESULT hr = CreateParagraph(m_sources[m_nextParagraph], &layout, &height);
+
+        if (hr != S_OK)
+        {
+            if (m_loadResult == S_OK)
+            {
+                m_loadResult = hr;
+            }
+
+            layout.Reset();
+            height = 0;
+        }
+
+        m_loadingDocument->SetParagraph(m_nextParagraph, layout, height);
+        m_nextParagraph++;
+    }
+    while (IsLoading() && hasTimeLeft());
+
+    m_loadingDocument->Publish(m_nextParagraph);
+
+    // Release the sources once everything is laid out
+    if (!IsLoading())
+    {
+        Cancel();
+    }
+}
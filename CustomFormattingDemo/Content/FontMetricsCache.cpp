@@ -0,0 +1,41 @@
+#include "pch.h"
+#include "FontMetricsCache.h"
+
+FontMetricsCache::FontMetricsCache()
+{
+}
+
+FontMetricsPerEm FontMetricsCache::GetMetrics(IDWriteFontFace * fontFace)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    auto iterator = m_entries.find(fontFace);
+
+    if (iterator != m_entries.end())
+    {
+        return iterator->second.metrics;
+    }
+
+    if (m_entries.size() >= MaxFontFaces)
+    {
+        m_entries.clear();
+    }
+
+    DWRITE_FONT_METRICS fontMetrics;
+    fontFace->GetMetrics(&fontMetrics);
+
+    Entry entry;
+    entry.fontFace = fontFace;
+    entry.metrics.ascent = (float) fontMetrics.ascent / fontMetrics.designUnitsPerEm;
+    entry.metrics.descent = (float) fontMetrics.descent / fontMetrics.designUnitsPerEm;
+    entry.metrics.lineGap = (float) fontMetrics.lineGap / fontMetrics.designUnitsPerEm;
+
+    m_entries[fontFace] = entry;
+    return entry.metrics;
+}
+
+void FontMetricsCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_entries.clear();
+}
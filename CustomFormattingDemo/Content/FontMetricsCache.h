@@ -0,0 +1,31 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include "FontMetricsSource.h"
+
+// Caches the metrics of font faces, keyed by face identity. The cache can
+// be used from several threads at once.
+class FontMetricsCache : public FontMetricsSource
+{
+public:
+    FontMetricsCache();
+
+    virtual FontMetricsPerEm GetMetrics(IDWriteFontFace * fontFace) override;
+
+    void Clear();
+
+    // The whole cache is discarded when it grows beyond this
+    static const size_t MaxFontFaces = 64;
+
+private:
+    // The faces are held so that their addresses cannot be reused
+    struct Entry
+    {
+        Microsoft::WRL::ComPtr<IDWriteFontFace> fontFace;
+        FontMetricsPerEm                        metrics;
+    };
+
+    std::mutex m_lock;
+    std::unordered_map<IDWriteFontFace *, Entry> m_entries;
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+// Font metrics scaled to one em, so that a glyph run only needs to
+// multiply them by its em size
+struct FontMetricsPerEm
+{
+    float ascent;
+    float descent;
+    float lineGap;
+};
+
+// Supplies the metrics of the font faces of glyph runs to LayoutRecorder.
+// FontMetricsCache reads them from DirectWrite; tests can return fixed
+// metrics for fake faces.
+class FontMetricsSource
+{
+public:
+    virtual FontMetricsPerEm GetMetrics(IDWriteFontFace * fontFace) = 0;
+
+protected:
+    ~FontMetricsSource() {}
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include "RenderTypes.h"
+
+enum class UnderlineType : UINT8
+{
+    None = 0,
+    Single = 1,
+    Double = 2,
+    Triple = 3,
+    Squiggly
+};
+
+enum class BackgroundMode : UINT8
+{
+    TextHeight,
+    TextHeightWithLineGap,
+    LineHeight
+};
+
+// Fields of a CharacterFormatSpecifier, combined into a compile-time
+// mask to set several of them in one pass
+enum FormatField : UINT32
+{
+    ForegroundField    = 0x01,
+    BackgroundField    = 0x02,
+    UnderlineField     = 0x04,
+    StrikethroughField = 0x08,
+    OverlineField      = 0x10,
+    HighlightField     = 0x20
+};
+
+// Values for the fields in a mask; the other values are ignored. Brushes
+// are indices into the BrushPalette used to draw the layout, so the
+// structure is 16 bytes of plain data.
+struct FormatValues
+{
+    FormatValues() :
+        foregroundBrush(NoBrush),
+        backgroundBrush(NoBrush),
+        underlineBrush(NoBrush),
+        strikethroughBrush(NoBrush),
+        overlineBrush(NoBrush),
+        highlightBrush(NoBrush),
+        backgroundMode(BackgroundMode::TextHeight),
+        underlineType(UnderlineType::None),
+        strikethroughCount(0),
+        hasOverline(false)
+    {
+    }
+
+    BrushIndex     foregroundBrush;
+    BrushIndex     backgroundBrush;
+    BrushIndex     underlineBrush;
+    BrushIndex     strikethroughBrush;
+    BrushIndex     overlineBrush;
+    BrushIndex     highlightBrush;
+    BackgroundMode backgroundMode;
+    UnderlineType  underlineType;
+    INT8           strikethroughCount;
+    bool           hasOverline;
+};
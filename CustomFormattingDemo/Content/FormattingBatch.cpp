@@ -0,0 +1,284 @@
+#include "pch.h"
+#include "FormattingBatch.h"
+
+using namespace Microsoft::WRL;
+
+FormattingBatch::FormattingBatch(IDWriteTextLayout * textLayout) :
+    m_textLayout(textLayout)
+{
+}
+
+HRESULT FormattingBatch::SetForegroundBrush(BrushIndex brush,
+                                            DWRITE_TEXT_RANGE textRange)
+{
+    FormatValues values;
+    values.foregroundBrush = brush;
+
+    return SetFormat<ForegroundField>(values, textRange);
+}
+
+HRESULT FormattingBatch::SetBackgroundBrush(BackgroundMode backgroundMode,
+                                            BrushIndex brush,
+                                            DWRITE_TEXT_RANGE textRange)
+{
+    FormatValues values;
+    values.backgroundMode = backgroundMode;
+    values.backgroundBrush = brush;
+
+    return SetFormat<BackgroundField>(values, textRange);
+}
+
+HRESULT FormattingBatch::SetUnderline(UnderlineType type,
+                                      BrushIndex brush,
+                                      DWRITE_TEXT_RANGE textRange)
+{
+    FormatValues values;
+    values.underlineType = type;
+    values.underlineBrush = brush;
+
+    return SetFormat<UnderlineField>(values, textRange);
+}
+
+HRESULT FormattingBatch::SetStrikethrough(int count,
+                                          BrushIndex brush,
+                                          DWRITE_TEXT_RANGE textRange)
+{
+    if (count < 0 || count > 3)
+    {
+        return E_INVALIDARG;
+    }
+
+    FormatValues values;
+    values.strikethroughCount = (INT8) count;
+    values.strikethroughBrush = brush;
+
+    return SetFormat<StrikethroughField>(values, textRange);
+}
+
+HRESULT FormattingBatch::SetOverline(bool hasOverline,
+                                     BrushIndex brush,
+                                     DWRITE_TEXT_RANGE textRange)
+{
+    FormatValues values;
+    values.hasOverline = hasOverline;
+    values.overlineBrush = brush;
+
+    return SetFormat<OverlineField>(values, textRange);
+}
+
+HRESULT FormattingBatch::SetHighlight(BrushIndex brush,
+                                      DWRITE_TEXT_RANGE textRange)
+{
+    FormatValues values;
+    values.highlightBrush = brush;
+
+    return SetFormat<HighlightField>(values, textRange);
+}
+
+HRESULT FormattingBatch::AddOperation(UINT32 fields,
+                                      const FormatValues & values,
+                                      DWRITE_TEXT_RANGE textRange,
+                                      ApplyFieldsFunction applyFields)
+{
+    if ((fields & StrikethroughField) &&
+        (values.strikethroughCount < 0 || values.strikethroughCount > 3))
+    {
+        return E_INVALIDARG;
+    }
+
+    if (textRange.length == 0)
+    {
+        return S_OK;
+    }
+
+    // Decoration flags are set in the same order as the operations
+    if (fields & StrikethroughField)
+    {
+        Decoration decoration = { textRange, true, values.strikethroughCount > 0 };
+        m_decorations.push_back(decoration);
+    }
+
+    // Overlines are drawn by DrawUnderline
+    if (fields & (UnderlineField | OverlineField))
+    {
+        Decoration decoration = { textRange, false, true };
+        m_decorations.push_back(decoration);
+    }
+
+    Operation operation = { textRange, values, applyFields };
+    m_operations.push_back(operation);
+    return S_OK;
+}
+
+HRESULT FormattingBatch::Commit()
+{
+    HRESULT hr = Apply();
+
+    // Emptied on failure too, so that committing again does not apply the
+    // same operations twice
+    m_operations.clear();
+    m_decorations.clear();
+    m_runs.Clear();
+    m_originalRuns.Clear();
+    return hr;
+}
+
+HRESULT FormattingBatch::Apply()
+{
+    HRESULT hr;
+
+    if (m_operations.empty())
+    {
+        return S_OK;
+    }
+
+    // Get the existing formatting of the whole range touched by the batch
+    // before changing anything, so that if reading it fails the layout is
+    // left as it was
+    UINT32 startPosition = UINT32_MAX;
+    UINT32 endPosition = 0;
+
+    for (const Operation & operation : m_operations)
+    {
+        UINT32 operationEnd = operation.textRange.startPosition + 
+                              operation.textRange.length;
+
+        startPosition = min(startPosition, operation.textRange.startPosition);
+        endPosition = max(endPosition, operationEnd);
+    }
+
+    if (S_OK != (hr = ReadRuns(startPosition, endPosition)))
+    {
+        return hr;
+    }
+
+    // Apply the operations in order to the formatting in memory
+    for (const Operation & operation : m_operations)
+    {
+        m_runs.Update(operation.textRange.startPosition,
+                      operation.textRange.length,
+                      [&operation](ComPtr<CharacterFormatSpecifier> & specifier)
+        {
+            CharacterFormatSpecifier prototype;
+
+            if (specifier != nullptr)
+            {
+                prototype.CopyFormatting(specifier.Get());
+            }
+
+            operation.applyFields(&prototype, operation.values);
+            specifier = CharacterFormatSpecifier::Intern(prototype);
+        });
+    }
+
+    // Set the drawing effects before the flags, so that if one fails the
+    // ones set before it can be restored from the original runs
+    UINT32 appliedEnd = endPosition;
+
+    hr = SetChangedRuns(m_runs, m_originalRuns, startPosition, &appliedEnd);
+
+    // Then the underline and strikethrough flags of the layout
+    for (size_t index = 0; hr == S_OK && index < m_decorations.size(); index++)
+    {
+        const Decoration & decoration = m_decorations[index];
+
+        if (decoration.isStrikethrough)
+        {
+            hr = m_textLayout->SetStrikethrough(decoration.isEnabled,
+                                                decoration.textRange);
+        }
+        else
+        {
+            hr = m_textLayout->SetUnderline(decoration.isEnabled,
+                                            decoration.textRange);
+        }
+    }
+
+    if (hr != S_OK)
+    {
+        SetChangedRuns(m_originalRuns, m_runs, startPosition, &appliedEnd);
+    }
+
+    TrackedLayout::IncrementGeneration(m_textLayout.Get());
+    return hr;
+}
+
+HRESULT FormattingBatch::SetChangedRuns(const FormatRuns & runs,
+                                        const FormatRuns & baseRuns,
+                                        UINT32 startPosition,
+                                        UINT32 * endPosition)
+{
+    // Identical formatting has an identical interned specifier, so the
+    // runs are already as long as possible: set each one that changed
+    HRESULT hr = S_OK;
+
+    runs.ForEachRun(startPosition,
+                    *endPosition - startPosition,
+                    [this, &hr, &baseRuns, endPosition](UINT32 position,
+                                                        UINT32 length,
+                                                        const ComPtr<CharacterFormatSpecifier> & specifier)
+    {
+        bool isChanged = false;
+
+        baseRuns.ForEachRun(position,
+                            length,
+                            [&isChanged, &specifier](UINT32, 
+                                                     UINT32, 
+                            const ComPtr<CharacterFormatSpecifier> & original)
+        {
+            isChanged |= original != specifier;
+        });
+
+        if (hr == S_OK && isChanged)
+        {
+            DWRITE_TEXT_RANGE setTextRange;
+            setTextRange.startPosition = position;
+            setTextRange.length = length;
+
+            hr = m_textLayout->SetDrawingEffect((IUnknown *) specifier.Get(),
+                                                setTextRange);
+
+            if (hr != S_OK)
+            {
+                *endPosition = position;
+            }
+        }
+    });
+
+    return hr;
+}
+
+HRESULT FormattingBatch::ReadRuns(UINT32 startPosition, UINT32 endPosition)
+{
+    m_runs.Clear();
+    m_originalRuns.Clear();
+
+    UINT32 currentPosition = startPosition;
+
+    while (currentPosition < endPosition)
+    {
+        // Get the drawing effect at the current position
+        ComPtr<IUnknown> effect;
+        DWRITE_TEXT_RANGE queryTextRange;
+        HRESULT hr;
+
+        if (S_OK != (hr = m_textLayout->GetDrawingEffect(currentPosition,
+                                                         &effect,
+                                                         &queryTextRange)))
+        {
+            return hr;
+        }
+
+        UINT32 queryEndPos = queryTextRange.startPosition + queryTextRange.length;
+        UINT32 length = min(endPosition, queryEndPos) - currentPosition;
+
+        ComPtr<CharacterFormatSpecifier> specifier = 
+            (CharacterFormatSpecifier *) effect.Get();
+
+        m_runs.Set(currentPosition, length, specifier);
+        m_originalRuns.Set(currentPosition, length, specifier);
+
+        currentPosition += length;
+    }
+    return S_OK;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include "CharacterFormatSpecifier.h"
+#include "RunLengthStore.h"
+
+// Collects many formatting operations for one IDWriteTextLayout and
+// applies them together: the existing drawing effects are read once into
+// a RunLengthStore, overlapping operations are resolved there, and Commit
+// makes one SetDrawingEffect call per run of identical formatting that
+// changed.
+class FormattingBatch
+{
+public:
+    FormattingBatch(IDWriteTextLayout * textLayout);
+
+    // Same operations as the static methods of CharacterFormatSpecifier,
+    // applied in the order they are added
+    template<UINT32 Fields>
+    HRESULT SetFormat(const FormatValues & values,
+                      DWRITE_TEXT_RANGE textRange);
+
+    HRESULT SetForegroundBrush(BrushIndex brush,
+                               DWRITE_TEXT_RANGE textRange);
+
+    HRESULT SetBackgroundBrush(BackgroundMode backgroundMode,
+                               BrushIndex brush,
+                               DWRITE_TEXT_RANGE textRange);
+
+    HRESULT SetUnderline(UnderlineType type,
+                         BrushIndex brush,
+                         DWRITE_TEXT_RANGE textRange);
+
+    HRESULT SetStrikethrough(int count,
+                             BrushIndex brush,
+                             DWRITE_TEXT_RANGE textRange);
+
+    HRESULT SetOverline(bool hasOverline,
+                        BrushIndex brush,
+                        DWRITE_TEXT_RANGE textRange);
+
+    HRESULT SetHighlight(BrushIndex brush,
+                         DWRITE_TEXT_RANGE textRange);
+
+    // Apply all the operations to the layout and empty the batch, also
+    // when it fails. On failure the drawing effects of the layout are
+    // restored, but underline and strikethrough flags set before the
+    // failing one are kept.
+    HRESULT Commit();
+
+private:
+    // An instantiation of CharacterFormatSpecifier::ApplyFields
+    typedef void (*ApplyFieldsFunction)(CharacterFormatSpecifier * specifier,
+                                        const FormatValues & values);
+
+    struct Operation
+    {
+        DWRITE_TEXT_RANGE   textRange;
+        FormatValues        values;
+        ApplyFieldsFunction applyFields;
+    };
+
+    // IDWriteTextLayout underline and strikethrough flags, which make
+    // DirectWrite call DrawUnderline and DrawStrikethrough
+    struct Decoration
+    {
+        DWRITE_TEXT_RANGE textRange;
+        bool isStrikethrough;
+        bool isEnabled;
+    };
+
+    // Interned specifiers by character position; null is no formatting
+    typedef RunLengthStore<Microsoft::WRL::ComPtr<CharacterFormatSpecifier>> 
+        FormatRuns;
+
+    HRESULT AddOperation(UINT32 fields,
+                         const FormatValues & values,
+                         DWRITE_TEXT_RANGE textRange,
+                         ApplyFieldsFunction applyFields);
+
+    // Commit without emptying the batch
+    HRESULT Apply();
+
+    HRESULT ReadRuns(UINT32 startPosition, UINT32 endPosition);
+
+    // Set the drawing effect of each run that differs from baseRuns, from
+    // startPosition to *endPosition; on failure *endPosition is the start
+    // of the run that failed
+    HRESULT SetChangedRuns(const FormatRuns & runs,
+                           const FormatRuns & baseRuns,
+                           UINT32 startPosition,
+                           UINT32 * endPosition);
+
+    Microsoft::WRL::ComPtr<IDWriteTextLayout> m_textLayout;
+    std::vector<Operation>  m_operations;
+    std::vector<Decoration> m_decorations;
+
+    // Formatting being built, and formatting the layout had before
+    FormatRuns m_runs;
+    FormatRuns m_originalRuns;
+};
+
+template<UINT32 Fields>
+HRESULT FormattingBatch::SetFormat(const FormatValues & values,
+                                   DWRITE_TEXT_RANGE textRange)
+{
+    return AddOperation(Fields,
+                        values,
+                        textRange,
+                        &CharacterFormatSpecifier::ApplyFields<Fields>);
+}
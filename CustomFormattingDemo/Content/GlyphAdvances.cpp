@@ -0,0 +1,87 @@
+#include "pch.h"
+#include "GlyphAdvances.h"
+
+#ifdef DIRECTX_MATH_VERSION
+
+using namespace DirectX;
+
+float SumGlyphAdvances(const FLOAT * advances, UINT32 count)
+{
+    // Four partial sums, combined at the end
+    XMVECTOR vSum = XMVectorZero();
+    UINT32 index = 0;
+
+    for (; index + 4 <= count; index += 4)
+    {
+        vSum = XMVectorAdd(vSum, XMLoadFloat4((const XMFLOAT4 *) (advances + index)));
+    }
+
+    XMFLOAT4 sums;
+    XMStoreFloat4(&sums, vSum);
+    float sum = (sums.x + sums.y) + (sums.z + sums.w);
+
+    // Remaining advances
+    for (; index < count; index++)
+    {
+        sum += advances[index];
+    }
+
+    return sum;
+}
+
+#elif defined(__SSE__)
+
+#include <xmmintrin.h>
+
+float SumGlyphAdvances(const FLOAT * advances, UINT32 count)
+{
+    // The same four partial sums as with DirectXMath, in the same order
+    __m128 vSum = _mm_setzero_ps();
+    UINT32 index = 0;
+
+    for (; index + 4 <= count; index += 4)
+    {
+        vSum = _mm_add_ps(vSum, _mm_loadu_ps(advances + index));
+    }
+
+    float sums[4];
+    _mm_storeu_ps(sums, vSum);
+    float sum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+
+    // Remaining advances
+    for (; index < count; index++)
+    {
+        sum += advances[index];
+    }
+
+    return sum;
+}
+
+#else
+
+float SumGlyphAdvances(const FLOAT * advances, UINT32 count)
+{
+    // The same four partial sums, in four scalar registers
+    float sums[4] = { 0, 0, 0, 0 };
+    UINT32 index = 0;
+
+    for (; index + 4 <= count; index += 4)
+    {
+        sums[0] += advances[index];
+        sums[1] += advances[index + 1];
+        sums[2] += advances[index + 2];
+        sums[3] += advances[index + 3];
+    }
+
+    float sum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+
+    // Remaining advances
+    for (; index < count; index++)
+    {
+        sum += advances[index];
+    }
+
+    return sum;
+}
+
+#endif
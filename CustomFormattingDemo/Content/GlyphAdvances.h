@@ -0,0 +1,7 @@
+#pragma once
+
+// Total advance of a glyph run. Four advances are added at once, with
+// DirectXMath when it is available, with SSE otherwise and with four
+// partial sums as a last resort. All three add in the same order, which
+// may differ from a sequential sum in the last bits.
+float SumGlyphAdvances(const FLOAT * advances, UINT32 count);
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_set>
+
+// A table of interned, reference-counted objects, split into shards by
+// hash, each with its own lock, so that threads interning different values
+// rarely wait for each other. T is immutable once interned and has a
+// bool TryAddRef(), which adds a reference unless the last one is already
+// being released; an object that is released for the last time calls
+// Remove before it deletes itself.
+template<typename T, typename Hasher, typename Comparer, int ShardCount = 16>
+class InternTable
+{
+public:
+    // The object equal to the prototype, with a reference added. If there
+    // is none, create() makes a new one, with a reference already added,
+    // which is added to the table.
+    template<typename Create>
+    T * Intern(const T & prototype, const Create & create)
+    {
+        Shard & shard = GetShard(&prototype);
+        std::lock_guard<std::mutex> lock(shard.lock);
+
+        auto iterator = shard.table.find(const_cast<T *>(&prototype));
+
+        if (iterator != shard.table.end())
+        {
+            if ((*iterator)->TryAddRef())
+            {
+                return *iterator;
+            }
+
+            // Its last reference is being released on another thread, which
+            // will not find it in the table any more
+            shard.table.erase(iterator);
+        }
+
+        T * object = create();
+        shard.table.insert(object);
+        return object;
+    }
+
+    // Removes the object, unless Intern has replaced it already
+    void Remove(T * object)
+    {
+        Shard & shard = GetShard(object);
+        std::lock_guard<std::mutex> lock(shard.lock);
+        auto iterator = shard.table.find(object);
+
+        if (iterator != shard.table.end() && *iterator == object)
+        {
+            shard.table.erase(iterator);
+        }
+    }
+
+    // Objects in the table; takes every lock
+    size_t GetSize()
+    {
+        size_t size = 0;
+
+        for (Shard & shard : m_shards)
+        {
+            std::lock_guard<std::mutex> lock(shard.lock);
+            size += shard.table.size();
+        }
+
+        return size;
+    }
+
+private:
+    // A cache line each, so that the locks of neighbours do not share one
+    struct alignas(64) Shard
+    {
+        std::mutex                                 lock;
+        std::unordered_set<T *, Hasher, Comparer> table;
+    };
+
+    // The table of a shard buckets by the low bits of the hash, so the
+    // shard is picked by the middle bits of a multiplicative mix of it
+    Shard & GetShard(const T * object)
+    {
+        uint32_t mixed = (uint32_t) Hasher()(object) * 2654435761u;
+        return m_shards[(mixed >> 16) % ShardCount];
+    }
+
+    Shard m_shards[ShardCount];
+};
@@ -0,0 +1,444 @@
+#include "pch.h"
+#include "LayoutRecorder.h"
+#include "GlyphAdvances.h"
+#include <algorithm>
+#include <cmath>
+
+LayoutRecorder::LayoutRecorder() :
+    m_displayList(nullptr),
+    m_fontMetricsSource(nullptr),
+    m_lineMetrics(nullptr),
+    m_lineCount(0),
+    m_lineIndex(0),
+    m_charIndex(0),
+    m_hasClip(false),
+    m_clipRect(),
+    m_firstVisibleLine(0),
+    m_lastVisibleLine(-1),
+    m_fontFace(nullptr),
+    m_fontMetrics(),
+    m_pixelsPerDip(1),
+    m_renderTransform(RenderMatrix::Identity()),
+    m_worldToPixel(RenderMatrix::Identity()),
+    m_pixelToWorld(RenderMatrix::Identity())
+{
+}
+
+void LayoutRecorder::Begin(DisplayList * displayList,
+                           FontMetricsSource * fontMetrics,
+                           const DWRITE_LINE_METRICS * lineMetrics,
+                           UINT32 lineCount,
+                           RenderPoint origin,
+                           const RenderRect * clipRect)
+{
+    m_displayList = displayList;
+    m_decorations = DecorationCoalescer();
+    m_fontMetricsSource = fontMetrics;
+    m_lineMetrics = lineMetrics;
+    m_lineCount = lineCount;
+    m_lineIndex = 0;
+    m_charIndex = 0;
+    m_hasClip = clipRect != nullptr;
+    m_clipRect = m_hasClip ? *clipRect : RenderRect();
+    m_firstVisibleLine = 0;
+    m_lastVisibleLine = -1;
+    m_fontFace = nullptr;
+    m_fontMetrics = FontMetricsPerEm();
+
+    SetTransform(RenderMatrix::Identity(), 96, 96);
+
+    if (m_hasClip)
+    {
+        SetVisibleLines(origin);
+    }
+
+    m_displayList->Clear();
+}
+
+void LayoutRecorder::SetTransform(const RenderMatrix & transform, float dpiX, float dpiY)
+{
+    m_pixelsPerDip = dpiX / 96;
+    m_renderTransform = transform;
+
+    // Pixel snapping maps to pixels and back
+    m_worldToPixel = m_renderTransform * RenderMatrix::Scale(dpiX / 96, dpiY / 96);
+    m_pixelToWorld = m_worldToPixel;
+    m_pixelToWorld.Invert();
+}
+
+void LayoutRecorder::End()
+{
+    m_decorations.Flush(m_displayList);
+}
+
+void LayoutRecorder::SetVisibleLines(RenderPoint origin)
+{
+    m_lineTops.resize(m_lineCount + 1);
+
+    float top = origin.y;
+
+    for (UINT32 line = 0; line < m_lineCount; line++)
+    {
+        m_lineTops[line] = top;
+        top += m_lineMetrics[line].height;
+    }
+
+    m_lineTops[m_lineCount] = top;
+
+    // First line that starts at or above the top of the clip, and last
+    // line that starts above its bottom
+    auto begin = m_lineTops.begin();
+    auto end = begin + m_lineCount;
+
+    m_firstVisibleLine =
+        max(0, (int) (std::upper_bound(begin, end, m_clipRect.top) - begin) - 1);
+
+    m_lastVisibleLine =
+        (int) (std::lower_bound(begin, end, m_clipRect.bottom) - begin) - 1;
+}
+
+bool LayoutRecorder::IsCulled(const RenderRect & bounds) const
+{
+    return m_hasClip &&
+           (bounds.right < m_clipRect.left || bounds.left > m_clipRect.right ||
+            bounds.bottom < m_clipRect.top || bounds.top > m_clipRect.bottom);
+}
+
+bool LayoutRecorder::IsGlyphRunCulled(float baselineOriginX,
+                                      const DWRITE_GLYPH_RUN * glyphRun) const
+{
+    if (!m_hasClip)
+    {
+        return false;
+    }
+
+    // Whole lines first, then the horizontal extent of the run
+    if ((int) m_lineIndex < m_firstVisibleLine ||
+        (int) m_lineIndex > m_lastVisibleLine)
+    {
+        return true;
+    }
+
+    float width = SumGlyphAdvances(glyphRun->glyphAdvances, glyphRun->glyphCount);
+
+    // Right-to-left runs extend to the left of their origin
+    float left = (glyphRun->bidiLevel & 1) ? baselineOriginX - width : baselineOriginX;
+
+    return left + width < m_clipRect.left || left > m_clipRect.right;
+}
+
+void LayoutRecorder::AdvanceCharIndex(UINT32 stringLength)
+{
+    m_charIndex += stringLength;
+
+    if (m_charIndex == m_lineMetrics[m_lineIndex].length)
+    {
+        // Decorations never merge across lines
+        m_decorations.Flush(m_displayList);
+        m_lineIndex++;
+        m_charIndex = 0;
+    }
+}
+
+void LayoutRecorder::BeginInlineObject()
+{
+    m_decorations.Flush(m_displayList);
+}
+
+HRESULT LayoutRecorder::DrawGlyphRun(RenderPoint baselineOrigin,
+                                     DWRITE_MEASURING_MODE measuringMode,
+                                     const DWRITE_GLYPH_RUN * glyphRun,
+                                     UINT32 stringLength,
+                                     const FormatValues * format)
+{
+    // The runs must add up to the lengths of the lines
+    if (m_lineIndex >= m_lineCount)
+    {
+        return E_INVALIDARG;
+    }
+
+    // Runs outside the clip are rejected before anything is recorded
+    if (IsGlyphRunCulled(baselineOrigin.x, glyphRun))
+    {
+        AdvanceCharIndex(stringLength);
+        return S_OK;
+    }
+
+    // Get foreground, background, highlight brushes
+    FormatValues values;
+
+    if (format != nullptr)
+    {
+        values = *format;
+    }
+
+    // Set variable indicating trailing white space
+    const DWRITE_LINE_METRICS & lineMetrics = m_lineMetrics[m_lineIndex];
+    bool isTrailingWhiteSpace =
+        lineMetrics.length - m_charIndex == lineMetrics.trailingWhitespaceLength;
+
+    bool hasBackground = values.backgroundBrush != NoBrush && !isTrailingWhiteSpace;
+    bool hasHighlight = values.highlightBrush != NoBrush && !isTrailingWhiteSpace;
+
+    // Width of the text, for the background and highlight
+    float width = 0;
+
+    if (hasBackground || hasHighlight)
+    {
+        width = SumGlyphAdvances(glyphRun->glyphAdvances, glyphRun->glyphCount);
+    }
+
+    // Background is drawn in the initial pass
+    if (hasBackground)
+    {
+        RenderRect rect = GetRectangle(glyphRun,
+                                       &lineMetrics,
+                                       baselineOrigin.x,
+                                       baselineOrigin.y,
+                                       width,
+                                       values.backgroundMode);
+
+        m_displayList->AddFillRectangle(RenderPass::Initial, rect, values.backgroundBrush);
+    }
+
+    // Glyphs are drawn in the main pass, above the decorations recorded
+    // before them
+    m_decorations.Flush(m_displayList);
+    m_displayList->AddGlyphRun(RenderPass::Main,
+                               baselineOrigin,
+                               glyphRun,
+                               measuringMode,
+                               values.foregroundBrush);
+
+    // Highlight is drawn in the final pass
+    if (hasHighlight)
+    {
+        RenderRect rect = GetRectangle(glyphRun,
+                                       &lineMetrics,
+                                       baselineOrigin.x,
+                                       baselineOrigin.y,
+                                       width,
+                                       BackgroundMode::TextHeight);
+
+        m_displayList->AddFillRectangle(RenderPass::Final, rect, values.highlightBrush);
+    }
+
+    // Increment the indices for this glyph run
+    AdvanceCharIndex(stringLength);
+
+    return S_OK;
+}
+
+RenderRect LayoutRecorder::GetRectangle(const DWRITE_GLYPH_RUN * glyphRun,
+                                        const DWRITE_LINE_METRICS * lineMetrics,
+                                        float baselineOriginX,
+                                        float baselineOriginY,
+                                        float width,
+                                        BackgroundMode backgroundMode)
+{
+    // Get height of text
+    float ascent;
+    float descent;
+
+    if (backgroundMode == BackgroundMode::LineHeight)
+    {
+        ascent = lineMetrics->baseline;
+        descent = lineMetrics->height - ascent;
+    }
+    else
+    {
+        if (glyphRun->fontFace != m_fontFace)
+        {
+            m_fontMetrics = m_fontMetricsSource->GetMetrics(glyphRun->fontFace);
+            m_fontFace = glyphRun->fontFace;
+        }
+
+        float emSize = glyphRun->fontEmSize;
+        ascent = emSize * m_fontMetrics.ascent;
+        descent = emSize * m_fontMetrics.descent;
+
+        if (backgroundMode == BackgroundMode::TextHeightWithLineGap)
+        {
+            descent += emSize * m_fontMetrics.lineGap;
+        }
+    }
+
+    // Create rectangle
+    return MakeRect(baselineOriginX,
+                    baselineOriginY - ascent,
+                    baselineOriginX + width,
+                    baselineOriginY + descent);
+}
+
+void LayoutRecorder::DrawUnderline(RenderPoint baselineOrigin,
+                                   const DWRITE_UNDERLINE * underline,
+                                   const FormatValues * format)
+{
+    // Bounds of all underline styles and of the overline
+    if (IsCulled(MakeRect(baselineOrigin.x,
+                          baselineOrigin.y - underline->runHeight - 3 * underline->thickness,
+                          baselineOrigin.x + underline->width,
+                          baselineOrigin.y + underline->offset + 3 * underline->thickness)))
+    {
+        return;
+    }
+
+    if (format == nullptr)
+    {
+        return;
+    }
+
+    // Decorations without a brush of their own take the foreground brush,
+    // which is the default brush when it is NoBrush too
+    BrushIndex underlineBrush = format->underlineBrush != NoBrush ?
+        format->underlineBrush : format->foregroundBrush;
+
+    BrushIndex overlineBrush = format->overlineBrush != NoBrush ?
+        format->overlineBrush : format->foregroundBrush;
+
+    int underlineCount = 0;
+
+    // Do squiggly underline
+    if (format->underlineType == UnderlineType::Squiggly)
+    {
+        // The wave is anchored to x = 0, so its phase depends on the start
+        SquigglyLine squiggly;
+        squiggly.thickness = underline->thickness;
+        squiggly.width = underline->width;
+        squiggly.pixelsPerDip = m_pixelsPerDip;
+
+        float period = 5 * underline->thickness;
+        squiggly.phase = std::fmod(baselineOrigin.x, period);
+
+        if (squiggly.phase < 0)
+        {
+            squiggly.phase += period;
+        }
+
+        // The wave cannot be merged, so the pending rectangles go first
+        m_decorations.Flush(m_displayList);
+
+        m_displayList->AddSquiggly(RenderPass::Main,
+                                   MakePoint(baselineOrigin.x,
+                                             baselineOrigin.y + underline->offset),
+                                   squiggly,
+                                   underlineBrush);
+    }
+    else
+    {
+        underlineCount = (int) format->underlineType;
+    }
+
+    // Do single, double, triple underlines
+    if (underlineCount == 1 || underlineCount == 3)
+    {
+        FillRectangle(underlineBrush,
+                      baselineOrigin.x,
+                      baselineOrigin.y + underline->offset,
+                      underline->width,
+                      underline->thickness,
+                      0);
+    }
+
+    if (underlineCount == 2 || underlineCount == 3)
+    {
+        FillRectangle(underlineBrush,
+                      baselineOrigin.x,
+                      baselineOrigin.y + underline->offset,
+                      underline->width,
+                      underline->thickness,
+                      underlineCount - 1);
+
+        FillRectangle(underlineBrush,
+                      baselineOrigin.x,
+                      baselineOrigin.y + underline->offset,
+                      underline->width,
+                      underline->thickness,
+                      1 - underlineCount);
+    }
+
+    // Do overline
+    if (format->hasOverline)
+    {
+        FillRectangle(overlineBrush,
+                      baselineOrigin.x,
+                      baselineOrigin.y - underline->runHeight,
+                      underline->width,
+                      underline->thickness,
+                      -2);
+    }
+}
+
+HRESULT LayoutRecorder::DrawStrikethrough(RenderPoint baselineOrigin,
+                                          const DWRITE_STRIKETHROUGH * strikethrough,
+                                          const FormatValues * format)
+{
+    if (IsCulled(MakeRect(baselineOrigin.x,
+                          baselineOrigin.y + strikethrough->offset - 3 * strikethrough->thickness,
+                          baselineOrigin.x + strikethrough->width,
+                          baselineOrigin.y + strikethrough->offset + 3 * strikethrough->thickness)))
+    {
+        return S_OK;
+    }
+
+    if (format == nullptr)
+    {
+        return S_OK;
+    }
+
+    BrushIndex brush = format->strikethroughBrush != NoBrush ?
+        format->strikethroughBrush : format->foregroundBrush;
+
+    int strikethroughCount = format->strikethroughCount;
+
+    if (strikethroughCount < 0 || strikethroughCount > 3)
+        return E_INVALIDARG;
+
+    if (strikethroughCount == 1 || strikethroughCount == 3)
+    {
+        FillRectangle(brush,
+                      baselineOrigin.x,
+                      baselineOrigin.y + strikethrough->offset,
+                      strikethrough->width,
+                      strikethrough->thickness,
+                      0);
+    }
+    if (strikethroughCount == 2 || strikethroughCount == 3)
+    {
+        FillRectangle(brush,
+                      baselineOrigin.x,
+                      baselineOrigin.y + strikethrough->offset,
+                      strikethrough->width,
+                      strikethrough->thickness,
+                      strikethroughCount - 1);
+
+        FillRectangle(brush,
+                      baselineOrigin.x,
+                      baselineOrigin.y + strikethrough->offset,
+                      strikethrough->width,
+                      strikethrough->thickness,
+                      1 - strikethroughCount);
+    }
+    return S_OK;
+}
+
+void LayoutRecorder::FillRectangle(BrushIndex brush,
+                                   float x, float y,
+                                   float width, float thickness,
+                                   int offset)
+{
+    // Snap the y coordinate to the nearest pixel
+    RenderPoint pt = MakePoint(0, y);
+    pt = m_worldToPixel.TransformPoint(pt);
+    pt.y = (float) (int) (pt.y + 0.5f);
+    pt = m_pixelToWorld.TransformPoint(pt);
+    y = pt.y;
+
+    // Adjust for spacing
+    y += offset * thickness;
+
+    // Decorations are drawn in the main pass, merged with the pieces
+    // of the same line from adjacent glyph runs
+    RenderRect rect = MakeRect(x, y, x + width, y + thickness);
+    m_decorations.Add(rect, brush, m_displayList);
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <vector>
+#include "DecorationCoalescer.h"
+#include "DisplayList.h"
+#include "FontMetricsSource.h"
+#include "FormatValues.h"
+
+// Records the drawing of one text layout into a DisplayList, with the
+// formatting of FormatValues: backgrounds in the initial pass, glyphs and
+// decorations in the main pass, highlights in the final pass. This is the
+// logic of CharacterFormatter without any Direct2D or DirectWrite object:
+// the caller gives it the line metrics, then the glyph runs, underlines and
+// strikethroughs in the order IDWriteTextLayout::Draw reports them, so it
+// can also be driven by synthetic input. Buffers are reused from one
+// recording to the next.
+class LayoutRecorder
+{
+public:
+    LayoutRecorder();
+
+    // Start recording into the list, which is cleared. The line metrics
+    // must stay valid until End. With a clip rectangle, in the same
+    // coordinates as the origin, only the lines, glyph runs and decorations
+    // that intersect it are recorded.
+    void Begin(DisplayList * displayList,
+               FontMetricsSource * fontMetrics,
+               const DWRITE_LINE_METRICS * lineMetrics,
+               UINT32 lineCount,
+               RenderPoint origin,
+               const RenderRect * clipRect = nullptr);
+
+    // Transform and DPI of the target, for pixel snapping and squiggles;
+    // the identity at 96 DPI until it is set
+    void SetTransform(const RenderMatrix & transform, float dpiX, float dpiY);
+
+    float GetPixelsPerDip() const { return m_pixelsPerDip; }
+    const RenderMatrix & GetTransform() const { return m_renderTransform; }
+
+    // A null format draws with the default brush and no decorations.
+    // stringLength is the number of characters of the run, which advance
+    // the position in the line metrics.
+    HRESULT DrawGlyphRun(RenderPoint baselineOrigin,
+                         DWRITE_MEASURING_MODE measuringMode,
+                         const DWRITE_GLYPH_RUN * glyphRun,
+                         UINT32 stringLength,
+                         const FormatValues * format);
+
+    void DrawUnderline(RenderPoint baselineOrigin,
+                       const DWRITE_UNDERLINE * underline,
+                       const FormatValues * format);
+
+    HRESULT DrawStrikethrough(RenderPoint baselineOrigin,
+                              const DWRITE_STRIKETHROUGH * strikethrough,
+                              const FormatValues * format);
+
+    // Inline objects draw themselves through the same methods; an object
+    // outside the clip can be skipped, and the pending decorations must be
+    // recorded before one is drawn
+    bool HasClip() const { return m_hasClip; }
+    bool IsCulled(const RenderRect & bounds) const;
+    void BeginInlineObject();
+
+    // Record the pending decorations
+    void End();
+
+    // Decoration rectangles produced by the layout, and fills actually
+    // recorded after merging the pieces of adjacent glyph runs
+    UINT32 GetDecorationRectangleCount() const { return m_decorations.GetRectangleCount(); }
+    UINT32 GetDecorationFillCount() const { return m_decorations.GetFillCount(); }
+
+private:
+    void SetVisibleLines(RenderPoint origin);
+
+    bool IsGlyphRunCulled(float baselineOriginX,
+                          const DWRITE_GLYPH_RUN * glyphRun) const;
+
+    void AdvanceCharIndex(UINT32 stringLength);
+
+    RenderRect GetRectangle(const DWRITE_GLYPH_RUN * glyphRun,
+                            const DWRITE_LINE_METRICS * lineMetrics,
+                            float baselineOriginX,
+                            float baselineOriginY,
+                            float width,
+                            BackgroundMode backgroundMode);
+
+    void FillRectangle(BrushIndex brush,
+                       float x, float y,
+                       float width, float thickness,
+                       int offset);
+
+    // Display list being recorded
+    DisplayList *         m_displayList;
+    DecorationCoalescer   m_decorations;
+    FontMetricsSource *   m_fontMetricsSource;
+
+    const DWRITE_LINE_METRICS * m_lineMetrics;
+    UINT32                      m_lineCount;
+    UINT32                      m_lineIndex;
+    UINT32                      m_charIndex;
+
+    // Culling: the tops of the lines are prefix sums of their heights,
+    // searched for the range of lines that intersect the clip
+    bool               m_hasClip;
+    RenderRect         m_clipRect;
+    std::vector<float> m_lineTops;
+    int                m_firstVisibleLine;
+    int                m_lastVisibleLine;
+
+    // Metrics of the last font face, as consecutive runs usually share it
+    IDWriteFontFace *  m_fontFace;
+    FontMetricsPerEm   m_fontMetrics;
+
+    float        m_pixelsPerDip;
+    RenderMatrix m_renderTransform;
+    RenderMatrix m_worldToPixel;
+    RenderMatrix m_pixelToWorld;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+// The ring buffer of LogDocument: a fixed number of lines, allocated up
+// front, where each new line replaces the oldest one once the ring is
+// full. Pushing a line and evicting one are O(1) and never touch the
+// other lines. T has a FLOAT height. The ring is not thread-safe; the
+// log locks around it.
+template<typename T>
+class LineRing
+{
+public:
+    explicit LineRing(size_t capacity) :
+        m_lines(capacity != 0 ? capacity : 1),
+        m_first(0),
+        m_count(0),
+        m_pushedCount(0)
+    {
+    }
+
+    // Moves the lines into the ring and the evicted ones out of it, into
+    // the same vector, so that the caller can release them later; the
+    // first skippedCount lines of the batch were evicted before they were
+    // pushed, and only count as pushed
+    void Push(std::vector<T> * lines, size_t skippedCount)
+    {
+        size_t capacity = m_lines.size();
+
+        for (T & line : *lines)
+        {
+            size_t slot = (m_first + m_count) % capacity;
+
+            // Swapping hands the evicted line back to the caller
+            std::swap(m_lines[slot], line);
+
+            if (m_count < capacity)
+            {
+                m_count++;
+            }
+            else
+            {
+                m_first = (m_first + 1) % capacity;
+            }
+        }
+
+        m_pushedCount += lines->size() + skippedCount;
+    }
+
+    // The newest lines first, until their heights add up to at least
+    // height; lines is cleared first and keeps its capacity
+    void GetTail(FLOAT height, std::vector<T> * lines) const
+    {
+        lines->clear();
+
+        size_t capacity = m_lines.size();
+        FLOAT total = 0;
+
+        for (size_t index = 0; index < m_count && total < height; index++)
+        {
+            const T & line = m_lines[(m_first + m_count - 1 - index) % capacity];
+
+            lines->push_back(line);
+            total += line.height;
+        }
+    }
+
+    size_t GetCapacity() const { return m_lines.size(); }
+    size_t GetCount() const { return m_count; }
+
+    // Lines pushed since the ring was created, including evicted ones
+    UINT64 GetPushedCount() const { return m_pushedCount; }
+
+private:
+    std::vector<T> m_lines;
+    size_t         m_first;          // Oldest line
+    size_t         m_count;
+    UINT64         m_pushedCount;
+};
@@ -0,0 +1,88 @@
+#include "pch.h"
+#include "LogDocument.h"
+
+using namespace Microsoft::WRL;
+
+LogDocument::LogDocument(IDWriteFactory * dwriteFactory,
+                         IDWriteTextFormat * textFormat,
+                         FLOAT maxWidth,
+                         size_t maxLineCount,
+                         const BrushPalette & brushPalette) :
+    m_dwriteFactory(dwriteFactory),
+    m_textFormat(textFormat),
+    m_maxWidth(maxWidth),
+    m_brushPalette(brushPalette),
+    m_lines(maxLineCount)
+{
+    m_brushPalette.ReleaseBrushes();
+}
+
+HRESULT LogDocument::Append(const ParagraphSource & line)
+{
+    HRESULT hr;
+    std::vector<LogLine> lines(1);
+
+    if (S_OK != (hr = CreateParagraphLayout(m_dwriteFactory.Get(),
+                                            m_textFormat.Get(),
+                                            m_maxWidth,
+                                            line,
+                                            &lines[0].layout,
+                                            &lines[0].height)))
+    {
+        return hr;
+    }
+
+    Push(&lines, 0);
+    return S_OK;
+}
+
+HRESULT LogDocument::Append(const std::vector<ParagraphSource> & sources)
+{
+    HRESULT hr;
+
+    // Lines older than the capacity would be evicted by this batch at once
+    size_t capacity = m_lines.GetCapacity();
+    size_t skipped = sources.size() > capacity ? sources.size() - capacity : 0;
+
+    std::vector<LogLine> lines(sources.size() - skipped);
+
+    for (size_t index = 0; index < lines.size(); index++)
+    {
+        if (S_OK != (hr = CreateParagraphLayout(m_dwriteFactory.Get(),
+                                                m_textFormat.Get(),
+                                                m_maxWidth,
+                                                sources[skipped + index],
+                                                &lines[index].layout,
+                                                &lines[index].height)))
+        {
+            return hr;
+        }
+    }
+
+    Push(&lines, skipped);
+    return S_OK;
+}
+
+void LogDocument::Push(std::vector<LogLine> * lines, size_t skippedCount)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_lines.Push(lines, skippedCount);
+}
+
+void LogDocument::GetTail(FLOAT height, std::vector<LogLine> * lines) const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_lines.GetTail(height, lines);
+}
+
+size_t LogDocument::GetLineCount() const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_lines.GetCount();
+}
+
+UINT64 LogDocument::GetAppendedCount() const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_lines.GetPushedCount();
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <mutex>
+#include "DocumentLoader.h"
+#include "LineRing.h"
+
+// A line of a log, laid out once when it is appended
+struct LogLine
+{
+    Microsoft::WRL::ComPtr<IDWriteTextLayout> layout;
+    FLOAT                                     height;
+};
+
+// Append-only log of formatted lines, for viewing live logs. Each line is
+// a small layout of its own, created, formatted and measured by the thread
+// that appends it, outside the lock. The lines are kept in a ring buffer
+// of a fixed number of lines: once it is full, each new line replaces the
+// oldest one, so appending never touches the lines already in the log and
+// drawing only reads the lines at its tail.
+class LogDocument
+{
+public:
+    LogDocument(IDWriteFactory * dwriteFactory,
+                IDWriteTextFormat * textFormat,
+                FLOAT maxWidth,
+                size_t maxLineCount,
+                const BrushPalette & brushPalette);
+
+    // Can be called from any thread; appending in batches takes the lock
+    // once per batch. Nothing is appended if a line fails.
+    HRESULT Append(const ParagraphSource & line);
+    HRESULT Append(const std::vector<ParagraphSource> & lines);
+
+    // The newest lines first, until their heights add up to at least
+    // height. lines is reused so drawing a frame does not allocate.
+    void GetTail(FLOAT height, std::vector<LogLine> * lines) const;
+
+    size_t GetLineCount() const;
+
+    // Lines appended since the log was created, including evicted ones
+    UINT64 GetAppendedCount() const;
+
+    FLOAT GetMaxWidth() const { return m_maxWidth; }
+
+    // Colors of the formatting; brushes are created by the renderer
+    const BrushPalette & GetBrushPalette() const { return m_brushPalette; }
+
+private:
+    // Moves the new lines into the ring and the evicted ones out of it,
+    // so that they are released after the lock is; skippedCount lines of
+    // the batch were evicted before they were laid out
+    void Push(std::vector<LogLine> * lines, size_t skippedCount);
+
+    Microsoft::WRL::ComPtr<IDWriteFactory>    m_dwriteFactory;
+    Microsoft::WRL::ComPtr<IDWriteTextFormat> m_textFormat;
+    FLOAT                                     m_maxWidth;
+    BrushPalette                              m_brushPalette;
+
+    mutable std::mutex m_lock;
+    LineRing<LogLine>  m_lines;
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// A pool of reusable objects, so that per-frame scratch storage keeps its
+// allocated buffers from one frame to the next. Objects are created on
+// demand and never destroyed until the pool is, so once every thread has
+// acquired an object the pool stops allocating. The pool can be used from
+// several threads at once; each acquired object belongs to one caller.
+template<typename T>
+class ObjectPool
+{
+public:
+    // Returns the object to the pool when it goes out of scope
+    class Handle
+    {
+    public:
+        Handle(ObjectPool * pool, std::unique_ptr<T> object) :
+            m_pool(pool),
+            m_object(std::move(object))
+        {
+        }
+
+        Handle(Handle && other) :
+            m_pool(other.m_pool),
+            m_object(std::move(other.m_object))
+        {
+        }
+
+        ~Handle()
+        {
+            if (m_object != nullptr)
+            {
+                m_pool->Release(std::move(m_object));
+            }
+        }
+
+        T * Get() const         { return m_object.get(); }
+        T * operator->() const  { return m_object.get(); }
+        T & operator*() const   { return *m_object; }
+
+    private:
+        Handle(const Handle &);
+        Handle & operator=(const Handle &);
+
+        ObjectPool *       m_pool;
+        std::unique_ptr<T> m_object;
+    };
+
+    // Get a free object, or a new default-constructed one
+    Handle Acquire()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            if (!m_free.empty())
+            {
+                std::unique_ptr<T> object = std::move(m_free.back());
+                m_free.pop_back();
+                return Handle(this, std::move(object));
+            }
+        }
+
+        return Handle(this, std::unique_ptr<T>(new T()));
+    }
+
+private:
+    void Release(std::unique_ptr<T> object)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_free.push_back(std::move(object));
+    }
+
+    std::mutex                      m_lock;
+    std::vector<std::unique_ptr<T>> m_free;
+};
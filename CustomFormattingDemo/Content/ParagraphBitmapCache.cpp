@@ -0,0 +1,314 @@
+#include "pch.h"
+#include "ParagraphBitmapCache.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace D2D1;
+using namespace Microsoft::WRL;
+
+ParagraphBitmapCache::ParagraphBitmapCache() :
+    m_budgetBytes(DefaultMemoryBudget),
+    m_usageBytes(0),
+    m_useCounter(0),
+    m_rasterizeCount(0),
+    m_evictionCount(0)
+{
+}
+
+void ParagraphBitmapCache::SetMemoryBudget(size_t budgetBytes)
+{
+    m_budgetBytes = budgetBytes;
+
+    m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(),
+                                   [](const Entry & entry)
+                                   {
+                                       return entry.isOverBudget;
+                                   }),
+                    m_entries.end());
+
+    Evict(0);
+}
+
+void ParagraphBitmapCache::Clear()
+{
+    m_entries.clear();
+    m_usageBytes = 0;
+}
+
+bool ParagraphBitmapCache::IsSameKey(const Key & key1, const Key & key2)
+{
+    return key1.textLayout == key2.textLayout &&
+           key1.defaultBrush == key2.defaultBrush &&
+           key1.brushPalette == key2.brushPalette &&
+           key1.origin.x == key2.origin.x &&
+           key1.origin.y == key2.origin.y &&
+           memcmp(&key1.scale, &key2.scale, sizeof(D2D1_MATRIX_3X2_F)) == 0 &&
+           key1.dpiX == key2.dpiX &&
+           key1.dpiY == key2.dpiY;
+}
+
+void ParagraphBitmapCache::RemoveStaleEntries(IDWriteTextLayout * textLayout)
+{
+    for (size_t index = m_entries.size(); index-- > 0; )
+    {
+        const Entry & entry = m_entries[index];
+
+        if (entry.key.textLayout == textLayout &&
+            entry.textLayout.GetGeneration() != entry.generation)
+        {
+            m_usageBytes -= entry.bytes;
+            m_entries.erase(m_entries.begin() + index);
+        }
+    }
+}
+
+HRESULT ParagraphBitmapCache::Draw(ID2D1DeviceContext * context,
+                                   CharacterFormatter * characterFormatter,
+                                   IDWriteTextLayout * textLayout,
+                                   D2D1_POINT_2F origin,
+                                   ID2D1Brush * defaultBrush,
+                                   const BrushPalette * brushPalette)
+{
+    D2D1_MATRIX_3X2_F transform;
+    context->GetTransform(&transform);
+
+    Key key;
+    key.textLayout = textLayout;
+    key.defaultBrush = defaultBrush;
+    key.brushPalette = brushPalette;
+    key.origin = origin;
+    key.scale = transform;
+    key.scale._31 = 0;
+    key.scale._32 = 0;
+    context->GetDpi(&key.dpiX, &key.dpiY);
+
+    auto entry = std::find_if(m_entries.begin(), m_entries.end(),
+                              [&key](const Entry & candidate)
+                              {
+                                  return IsSameKey(candidate.key, key);
+                              });
+
+    if (entry == m_entries.end() ||
+        entry->textLayout.GetGeneration() != entry->generation)
+    {
+        // Generations only increase, so the bitmaps of earlier formatting
+        // of this layout can never be used again
+        RemoveStaleEntries(textLayout);
+
+        Entry newEntry;
+        newEntry.key = key;
+        newEntry.textLayout = TrackedLayout(textLayout);
+        newEntry.generation = newEntry.textLayout.GetGeneration();
+        newEntry.isOverBudget = false;
+
+        HRESULT hr = Rasterize(context,
+                               characterFormatter,
+                               textLayout,
+                               defaultBrush,
+                               brushPalette,
+                               &newEntry);
+
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        if (hr == S_FALSE)
+        {
+            newEntry.isOverBudget = true;
+            newEntry.bytes = 0;
+        }
+
+        m_usageBytes += newEntry.bytes;
+        m_entries.push_back(std::move(newEntry));
+        entry = m_entries.end() - 1;
+    }
+
+    entry->lastUsed = ++m_useCounter;
+
+    if (entry->isOverBudget)
+    {
+        return S_FALSE;
+    }
+
+    if (entry->bitmap == nullptr)
+    {
+        return S_OK;
+    }
+
+    // Composite at a whole-pixel position so that pixels map one to one
+    float x = std::floor(transform._31 * key.dpiX / 96 + 0.5f) * 96 / key.dpiX;
+    float y = std::floor(transform._32 * key.dpiY / 96 + 0.5f) * 96 / key.dpiY;
+
+    D2D1_RECT_F destination = RectF(0, 0,
+                                    entry->bounds.right - entry->bounds.left,
+                                    entry->bounds.bottom - entry->bounds.top);
+
+    context->SetTransform(Matrix3x2F::Translation(x + entry->bounds.left,
+                                                  y + entry->bounds.top));
+
+    context->DrawBitmap(entry->bitmap.Get(),
+                        &destination,
+                        1.0f,
+                        D2D1_INTERPOLATION_MODE_NEAREST_NEIGHBOR);
+
+    context->SetTransform(transform);
+    return S_OK;
+}
+
+HRESULT ParagraphBitmapCache::Rasterize(ID2D1DeviceContext * context,
+                                        CharacterFormatter * characterFormatter,
+                                        IDWriteTextLayout * textLayout,
+                                        ID2D1Brush * defaultBrush,
+                                        const BrushPalette * brushPalette,
+                                        Entry * entry)
+{
+    const Key & key = entry->key;
+    HRESULT hr;
+
+    // Bounds of the ink: the layout box can be infinite, so the text
+    // metrics are extended by the overhangs of the finite sides only
+    DWRITE_TEXT_METRICS textMetrics;
+    DWRITE_OVERHANG_METRICS overhangMetrics;
+
+    if (S_OK != (hr = textLayout->GetMetrics(&textMetrics)))
+    {
+        return hr;
+    }
+
+    if (S_OK != (hr = textLayout->GetOverhangMetrics(&overhangMetrics)))
+    {
+        return hr;
+    }
+
+    float left = min(textMetrics.left, -overhangMetrics.left);
+    float top = min(textMetrics.top, -overhangMetrics.top);
+    float right = textMetrics.left + textMetrics.widthIncludingTrailingWhitespace;
+    float bottom = textMetrics.top + textMetrics.height;
+
+    if (std::isfinite(textMetrics.layoutWidth))
+    {
+        right = max(right, textMetrics.layoutWidth + overhangMetrics.right);
+    }
+
+    if (std::isfinite(textMetrics.layoutHeight))
+    {
+        bottom = max(bottom, textMetrics.layoutHeight + overhangMetrics.bottom);
+    }
+
+    left += key.origin.x - Padding;
+    top += key.origin.y - Padding;
+    right += key.origin.x + Padding;
+    bottom += key.origin.y + Padding;
+
+    // Scale the corners, and snap the result outward to whole pixels
+    Matrix3x2F scale = *Matrix3x2F::ReinterpretBaseType(&key.scale);
+
+    D2D1_POINT_2F corners[4] =
+    {
+        scale.TransformPoint(Point2F(left, top)),
+        scale.TransformPoint(Point2F(right, top)),
+        scale.TransformPoint(Point2F(left, bottom)),
+        scale.TransformPoint(Point2F(right, bottom))
+    };
+
+    D2D1_RECT_F bounds = RectF(corners[0].x, corners[0].y, corners[0].x, corners[0].y);
+
+    for (int index = 1; index < 4; index++)
+    {
+        bounds.left = min(bounds.left, corners[index].x);
+        bounds.top = min(bounds.top, corners[index].y);
+        bounds.right = max(bounds.right, corners[index].x);
+        bounds.bottom = max(bounds.bottom, corners[index].y);
+    }
+
+    float pixelLeft = std::floor(bounds.left * key.dpiX / 96);
+    float pixelTop = std::floor(bounds.top * key.dpiY / 96);
+    float pixelRight = std::ceil(bounds.right * key.dpiX / 96);
+    float pixelBottom = std::ceil(bounds.bottom * key.dpiY / 96);
+
+    entry->bounds = RectF(pixelLeft * 96 / key.dpiX,
+                          pixelTop * 96 / key.dpiY,
+                          pixelRight * 96 / key.dpiX,
+                          pixelBottom * 96 / key.dpiY);
+
+    UINT32 pixelWidth = (UINT32) (pixelRight - pixelLeft);
+    UINT32 pixelHeight = (UINT32) (pixelBottom - pixelTop);
+
+    entry->bytes = (size_t) pixelWidth * pixelHeight * 4;
+
+    // Empty layout: nothing to draw
+    if (pixelWidth == 0 || pixelHeight == 0)
+    {
+        entry->bytes = 0;
+        return S_OK;
+    }
+
+    if (entry->bytes > m_budgetBytes)
+    {
+        return S_FALSE;
+    }
+
+    Evict(entry->bytes);
+
+    // A compatible target shares the brushes of the device context
+    ComPtr<ID2D1BitmapRenderTarget> bitmapTarget;
+
+    if (S_OK != (hr = context->CreateCompatibleRenderTarget(
+                            SizeF(entry->bounds.right - entry->bounds.left,
+                                  entry->bounds.bottom - entry->bounds.top),
+                            SizeU(pixelWidth, pixelHeight),
+                            &bitmapTarget)))
+    {
+        return hr;
+    }
+
+    bitmapTarget->SetTextAntialiasMode(D2D1_TEXT_ANTIALIAS_MODE_GRAYSCALE);
+    bitmapTarget->BeginDraw();
+    bitmapTarget->Clear(ColorF(0, 0, 0, 0));
+    bitmapTarget->SetTransform(scale *
+                               Matrix3x2F::Translation(-entry->bounds.left,
+                                                       -entry->bounds.top));
+
+    hr = characterFormatter->Draw(bitmapTarget.Get(),
+                                  textLayout,
+                                  key.origin,
+                                  defaultBrush,
+                                  brushPalette);
+
+    HRESULT endHr = bitmapTarget->EndDraw();
+
+    if (S_OK != hr)
+    {
+        return hr;
+    }
+
+    if (S_OK != (hr = endHr))
+    {
+        return hr;
+    }
+
+    if (S_OK != (hr = bitmapTarget->GetBitmap(&entry->bitmap)))
+    {
+        return hr;
+    }
+
+    m_rasterizeCount++;
+    return S_OK;
+}
+
+void ParagraphBitmapCache::Evict(size_t bytesNeeded)
+{
+    while (!m_entries.empty() && m_usageBytes + bytesNeeded > m_budgetBytes)
+    {
+        auto leastRecent = std::min_element(m_entries.begin(), m_entries.end(),
+                                            [](const Entry & entry1, const Entry & entry2)
+                                            {
+                                                return entry1.lastUsed < entry2.lastUsed;
+                                            });
+
+        m_usageBytes -= leastRecent->bytes;
+        m_entries.erase(leastRecent);
+        m_evictionCount++;
+    }
+}
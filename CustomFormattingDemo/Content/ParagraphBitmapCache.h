@@ -0,0 +1,97 @@
+#pragma once
+#include "CharacterFormatter.h"
+
+// Caches fully formatted paragraphs as bitmaps at the pixel density they
+// are presented at. A paragraph is rasterized once with CharacterFormatter
+// and later frames only composite its bitmap, so moving the paragraph, for
+// instance when it is centered again after a resize, does not draw any
+// text. It is rasterized again when the layout, its formatting, the DPI
+// or the non-translation part of the transform changes.
+//
+// Bitmaps are composited at whole-pixel positions, so a paragraph can be
+// up to half a pixel away from where Draw would put it. Text in the
+// bitmaps is antialiased in grayscale, as they are transparent.
+//
+// The bitmaps belong to the device: call Clear when it is lost.
+class ParagraphBitmapCache
+{
+public:
+    ParagraphBitmapCache();
+
+    // Draw a layout from the cache, rasterizing it first if needed. Returns
+    // S_FALSE without drawing anything when the bitmap of the paragraph
+    // would not fit in the memory budget, so that the caller can draw it
+    // directly instead; that is remembered like a bitmap, so the layout is
+    // not measured again on the next frame.
+    HRESULT Draw(ID2D1DeviceContext * context,
+                 CharacterFormatter * characterFormatter,
+                 IDWriteTextLayout * textLayout,
+                 D2D1_POINT_2F origin,
+                 ID2D1Brush * defaultBrush,
+                 const BrushPalette * brushPalette);
+
+    // Least recently drawn bitmaps are released to stay within the budget.
+    // Paragraphs that were over the previous budget are tried again.
+    void SetMemoryBudget(size_t budgetBytes);
+    size_t GetMemoryBudget() const { return m_budgetBytes; }
+    size_t GetMemoryUsage() const { return m_usageBytes; }
+
+    // Number of paragraphs rasterized, and bitmaps released to free memory
+    UINT64 GetRasterizeCount() const { return m_rasterizeCount; }
+    UINT64 GetEvictionCount() const { return m_evictionCount; }
+
+    // Release all bitmaps
+    void Clear();
+
+    static const size_t DefaultMemoryBudget = 32 * 1024 * 1024;
+
+    // Space around the ink of the layout for decorations, in DIPs
+    static const int Padding = 4;
+
+private:
+    // Everything the pixels of a bitmap depend on
+    struct Key
+    {
+        IDWriteTextLayout *  textLayout;
+        ID2D1Brush *         defaultBrush;
+        const BrushPalette * brushPalette;
+        D2D1_POINT_2F        origin;
+        D2D1_MATRIX_3X2_F    scale;     // Transform without its translation
+        float                dpiX;
+        float                dpiY;
+    };
+
+    struct Entry
+    {
+        Key           key;
+        TrackedLayout textLayout;
+        UINT32        generation;   // Of the formatting that was rasterized
+        bool          isOverBudget; // No bitmap, and no bytes
+        Microsoft::WRL::ComPtr<ID2D1Bitmap> bitmap;
+        D2D1_RECT_F bounds;     // Of the bitmap, in scaled DIPs
+        size_t bytes;
+        UINT64 lastUsed;
+    };
+
+    static bool IsSameKey(const Key & key1, const Key & key2);
+
+    // Release the bitmaps of earlier formatting of a layout
+    void RemoveStaleEntries(IDWriteTextLayout * textLayout);
+
+    HRESULT Rasterize(ID2D1DeviceContext * context,
+                      CharacterFormatter * characterFormatter,
+                      IDWriteTextLayout * textLayout,
+                      ID2D1Brush * defaultBrush,
+                      const BrushPalette * brushPalette,
+                      Entry * entry);
+
+    // Release least recently used bitmaps until the given size fits
+    void Evict(size_t bytesNeeded);
+
+    std::vector<Entry> m_entries;
+    size_t m_budgetBytes;
+    size_t m_usageBytes;
+    UINT64 m_useCounter;
+    UINT64 m_rasterizeCount;
+    UINT64 m_evictionCount;
+};
@@ -0,0 +1,62 @@
+#include "pch.h"
+#include "RenderSink.h"
+#include "GlyphAdvances.h"
+
+RecordingRenderSink::RecordingRenderSink() :
+    m_pass(RenderPass::Initial),
+    m_glyphCount(0)
+{
+}
+
+void RecordingRenderSink::Clear()
+{
+    m_commands.clear();
+    m_glyphCount = 0;
+}
+
+void RecordingRenderSink::BeginPass(RenderPass pass)
+{
+    m_pass = pass;
+}
+
+RecordingRenderSink::Command & RecordingRenderSink::AddCommand(CommandType type,
+                                                               BrushIndex brush)
+{
+    Command command = {};
+    command.pass = m_pass;
+    command.type = type;
+    command.brush = brush;
+
+    m_commands.push_back(command);
+    return m_commands.back();
+}
+
+void RecordingRenderSink::FillRectangle(const RenderRect & rect,
+                                        BrushIndex brush)
+{
+    Command & command = AddCommand(CommandType::FillRectangle, brush);
+    command.rect = rect;
+}
+
+void RecordingRenderSink::DrawGlyphRun(RenderPoint baselineOrigin,
+                                       const DWRITE_GLYPH_RUN * glyphRun,
+                                       BrushIndex brush,
+                                       DWRITE_MEASURING_MODE /*measuringMode*/)
+{
+    Command & command = AddCommand(CommandType::GlyphRun, brush);
+    command.origin = baselineOrigin;
+    command.fontFace = glyphRun->fontFace;
+    command.glyphCount = glyphRun->glyphCount;
+    command.width = SumGlyphAdvances(glyphRun->glyphAdvances, glyphRun->glyphCount);
+
+    m_glyphCount += glyphRun->glyphCount;
+}
+
+void RecordingRenderSink::DrawSquiggly(RenderPoint offset,
+                                       const SquigglyLine & squiggly,
+                                       BrushIndex brush)
+{
+    Command & command = AddCommand(CommandType::Squiggly, brush);
+    command.origin = offset;
+    command.width = squiggly.width;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <vector>
+#include "RenderTypes.h"
+
+// Receives the drawing commands of a DisplayList as it is replayed, pass by
+// pass. Brushes are BrushPalette indices and squiggles are parameters, so
+// the interface does not depend on Direct2D: D2DRenderSink resolves them
+// and draws on a render target, SoftwareRenderSink rasterizes them on the
+// CPU, and RecordingRenderSink only captures them, so that the output of
+// LayoutRecorder can be inspected and measured without drawing anything.
+class RenderSink
+{
+public:
+    virtual ~RenderSink() {}
+
+    // Called before the commands of each pass, even an empty one
+    virtual void BeginPass(RenderPass pass) = 0;
+
+    virtual void FillRectangle(const RenderRect & rect,
+                               BrushIndex brush) = 0;
+
+    virtual void DrawGlyphRun(RenderPoint baselineOrigin,
+                              const DWRITE_GLYPH_RUN * glyphRun,
+                              BrushIndex brush,
+                              DWRITE_MEASURING_MODE measuringMode) = 0;
+
+    // The wave starts at the offset and is drawn with a stroke as wide as
+    // its thickness
+    virtual void DrawSquiggly(RenderPoint offset,
+                              const SquigglyLine & squiggly,
+                              BrushIndex brush) = 0;
+};
+
+// Captures the commands into one flat buffer. Font faces are neither called
+// nor AddRef'ed, so any pointer, including nullptr, can stand in for them.
+class RecordingRenderSink : public RenderSink
+{
+public:
+    enum class CommandType
+    {
+        FillRectangle,
+        GlyphRun,
+        Squiggly
+    };
+
+    struct Command
+    {
+        RenderPass   pass;
+        CommandType  type;
+        BrushIndex   brush;
+        RenderRect   rect;          // FillRectangle
+        RenderPoint  origin;        // GlyphRun, Squiggly
+        const void * fontFace;      // GlyphRun
+        UINT32       glyphCount;    // GlyphRun
+        float        width;         // Sum of the advances, or squiggly width
+    };
+
+    RecordingRenderSink();
+
+    // Remove all commands but keep the allocated storage
+    void Clear();
+
+    const std::vector<Command> & GetCommands() const { return m_commands; }
+    UINT32 GetGlyphCount() const { return m_glyphCount; }
+
+    virtual void BeginPass(RenderPass pass) override;
+
+    virtual void FillRectangle(const RenderRect & rect,
+                               BrushIndex brush) override;
+
+    virtual void DrawGlyphRun(RenderPoint baselineOrigin,
+                              const DWRITE_GLYPH_RUN * glyphRun,
+                              BrushIndex brush,
+                              DWRITE_MEASURING_MODE measuringMode) override;
+
+    virtual void DrawSquiggly(RenderPoint offset,
+                              const SquigglyLine & squiggly,
+                              BrushIndex brush) override;
+
+private:
+    Command & AddCommand(CommandType type, BrushIndex brush);
+
+    RenderPass           m_pass;
+    std::vector<Command> m_commands;
+    UINT32               m_glyphCount;
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+// Plain types shared by the recording and replaying of text drawing. They
+// do not depend on Direct2D, so that LayoutRecorder, DisplayList and the
+// render sinks can be built and measured on any platform; the structures
+// have the same layout as their Direct2D counterparts.
+
+// The three passes of the painter's algorithm used by CharacterFormatter:
+// backgrounds first, then glyphs and decorations, then highlights
+enum class RenderPass
+{
+    Initial,
+    Main,
+    Final
+};
+
+// Index of a brush in a BrushPalette
+typedef UINT16 BrushIndex;
+
+// Index 0 means no brush in formatting; in drawing commands it stands for
+// the default brush of the draw
+const BrushIndex NoBrush = 0;
+
+struct RenderPoint
+{
+    float x;
+    float y;
+};
+
+inline RenderPoint MakePoint(float x, float y)
+{
+    RenderPoint point = { x, y };
+    return point;
+}
+
+struct RenderRect
+{
+    float left;
+    float top;
+    float right;
+    float bottom;
+};
+
+inline RenderRect MakeRect(float left, float top, float right, float bottom)
+{
+    RenderRect rect = { left, top, right, bottom };
+    return rect;
+}
+
+// Color with components from 0 to 1, laid out like D2D1_COLOR_F
+struct RenderColor
+{
+    float r;
+    float g;
+    float b;
+    float a;
+};
+
+inline RenderColor MakeColor(float r, float g, float b, float a = 1)
+{
+    RenderColor color = { r, g, b, a };
+    return color;
+}
+
+// 3x2 affine transform, laid out like D2D1_MATRIX_3X2_F and DWRITE_MATRIX;
+// points are row vectors, so a * b applies a first
+struct RenderMatrix
+{
+    float m11, m12;
+    float m21, m22;
+    float dx, dy;
+
+    static RenderMatrix Identity()
+    {
+        return Scale(1, 1);
+    }
+
+    static RenderMatrix Scale(float x, float y)
+    {
+        RenderMatrix matrix = { x, 0, 0, y, 0, 0 };
+        return matrix;
+    }
+
+    static RenderMatrix Translation(float x, float y)
+    {
+        RenderMatrix matrix = { 1, 0, 0, 1, x, y };
+        return matrix;
+    }
+
+    RenderMatrix operator*(const RenderMatrix & other) const
+    {
+        RenderMatrix matrix;
+        matrix.m11 = m11 * other.m11 + m12 * other.m21;
+        matrix.m12 = m11 * other.m12 + m12 * other.m22;
+        matrix.m21 = m21 * other.m11 + m22 * other.m21;
+        matrix.m22 = m21 * other.m12 + m22 * other.m22;
+        matrix.dx = dx * other.m11 + dy * other.m21 + other.dx;
+        matrix.dy = dx * other.m12 + dy * other.m22 + other.dy;
+        return matrix;
+    }
+
+    float Determinant() const
+    {
+        return m11 * m22 - m12 * m21;
+    }
+
+    // Leaves the matrix unchanged and returns false if it is singular
+    bool Invert()
+    {
+        float determinant = Determinant();
+
+        if (determinant == 0)
+        {
+            return false;
+        }
+
+        RenderMatrix inverse;
+        inverse.m11 = m22 / determinant;
+        inverse.m12 = -m12 / determinant;
+        inverse.m21 = -m21 / determinant;
+        inverse.m22 = m11 / determinant;
+        inverse.dx = (m21 * dy - m22 * dx) / determinant;
+        inverse.dy = (m12 * dx - m11 * dy) / determinant;
+
+        *this = inverse;
+        return true;
+    }
+
+    RenderPoint TransformPoint(RenderPoint point) const
+    {
+        return MakePoint(point.x * m11 + point.y * m21 + dx,
+                         point.x * m12 + point.y * m22 + dy);
+    }
+};
+
+// A squiggly underline starting at the origin of its command. The wave has
+// an amplitude of thickness and a period of 5 * thickness, starts at the
+// given phase (in DIPs), and is sampled about once per pixel.
+struct SquigglyLine
+{
+    float thickness;
+    float width;
+    float phase;
+    float pixelsPerDip;
+};
@@ -0,0 +1,64 @@
+#include "pch.h"
+#include "RetainedDisplayList.h"
+
+RetainedDisplayList::RetainedDisplayList() :
+    m_isValid(false),
+    m_key(),
+    m_generation(0)
+{
+}
+
+RetainedDisplayList::Key RetainedDisplayList::GetKey(ID2D1RenderTarget * renderTarget,
+                                                     IDWriteTextLayout * textLayout,
+                                                     D2D1_POINT_2F origin,
+                                                     const D2D1_RECT_F * clipRect)
+{
+    Key key;
+    key.textLayout = textLayout;
+    key.origin = origin;
+    renderTarget->GetTransform(&key.transform);
+    renderTarget->GetDpi(&key.dpiX, &key.dpiY);
+    key.hasClip = clipRect != nullptr;
+    key.clip = key.hasClip ? *clipRect : D2D1_RECT_F();
+    return key;
+}
+
+void RetainedDisplayList::Validate(ID2D1RenderTarget * renderTarget,
+                                   IDWriteTextLayout * textLayout,
+                                   D2D1_POINT_2F origin,
+                                   const D2D1_RECT_F * clipRect)
+{
+    m_key = GetKey(renderTarget, textLayout, origin, clipRect);
+    m_textLayout = TrackedLayout(textLayout);
+    m_generation = m_textLayout.GetGeneration();
+    m_isValid = true;
+}
+
+bool RetainedDisplayList::IsValid(ID2D1RenderTarget * renderTarget,
+                                  IDWriteTextLayout * textLayout,
+                                  D2D1_POINT_2F origin,
+                                  const D2D1_RECT_F * clipRect) const
+{
+    if (!m_isValid)
+    {
+        return false;
+    }
+
+    Key key = GetKey(renderTarget, textLayout, origin, clipRect);
+
+    return key.textLayout == m_key.textLayout &&
+           key.origin.x == m_key.origin.x &&
+           key.origin.y == m_key.origin.y &&
+           memcmp(&key.transform, &m_key.transform, sizeof(D2D1_MATRIX_3X2_F)) == 0 &&
+           key.dpiX == m_key.dpiX &&
+           key.dpiY == m_key.dpiY &&
+           m_textLayout.GetGeneration() == m_generation &&
+           key.hasClip == m_key.hasClip &&
+           memcmp(&key.clip, &m_key.clip, sizeof(D2D1_RECT_F)) == 0;
+}
+
+void RetainedDisplayList::Invalidate()
+{
+    m_isValid = false;
+    m_textLayout = TrackedLayout();
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "DisplayList.h"
+#include "TrackedLayout.h"
+
+// A display list kept across frames. It remembers the layout, origin,
+// transform, DPI, clip rectangle and formatting generation it was recorded
+// for, so that it is only recorded again when one of them changes. Brushes
+// are resolved when the list is replayed, so neither the default brush nor
+// the loss of the device invalidates it.
+class RetainedDisplayList : public DisplayList
+{
+public:
+    RetainedDisplayList();
+
+    void Validate(ID2D1RenderTarget * renderTarget,
+                  IDWriteTextLayout * textLayout,
+                  D2D1_POINT_2F origin,
+                  const D2D1_RECT_F * clipRect = nullptr);
+
+    bool IsValid(ID2D1RenderTarget * renderTarget,
+                 IDWriteTextLayout * textLayout,
+                 D2D1_POINT_2F origin,
+                 const D2D1_RECT_F * clipRect = nullptr) const;
+
+    // Must be called when the layout is changed other than through
+    // CharacterFormatSpecifier or FormattingBatch
+    void Invalidate();
+
+private:
+    // Everything the recorded commands depend on
+    struct Key
+    {
+        IDWriteTextLayout * textLayout;
+        D2D1_POINT_2F       origin;
+        D2D1_MATRIX_3X2_F   transform;
+        float               dpiX;
+        float               dpiY;
+        bool                hasClip;
+        D2D1_RECT_F         clip;
+    };
+
+    static Key GetKey(ID2D1RenderTarget * renderTarget,
+                      IDWriteTextLayout * textLayout,
+                      D2D1_POINT_2F origin,
+                      const D2D1_RECT_F * clipRect);
+
+    bool m_isValid;
+    Key  m_key;
+
+    // Formatting generation of the layout when the list was recorded
+    TrackedLayout m_textLayout;
+    UINT32        m_generation;
+};
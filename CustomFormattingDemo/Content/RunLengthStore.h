@@ -0,0 +1,198 @@
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <map>
+
+// Maps every character position to a value, stored as runs of identical
+// values in a balanced tree keyed by the start of each run. Setting,
+// updating and querying a range costs O(log n) plus the number of runs
+// in the range. Adjacent runs with equal values are always merged, so
+// TValue must be copyable and comparable with ==.
+//
+// This class is plain C++ with no DirectWrite dependency.
+template<typename TValue>
+class RunLengthStore
+{
+public:
+    static const uint32_t MaxPosition = UINT32_MAX;
+
+    RunLengthStore(const TValue & defaultValue = TValue()) :
+        m_defaultValue(defaultValue)
+    {
+        m_runs.emplace(0, defaultValue);
+    }
+
+    // Reset all positions to the default value
+    void Clear()
+    {
+        m_runs.clear();
+        m_runs.emplace(0, m_defaultValue);
+    }
+
+    // Number of runs, including the final run that extends to MaxPosition
+    size_t GetRunCount() const
+    {
+        return m_runs.size();
+    }
+
+    // Get the value at a position and the run that contains it
+    const TValue & Get(uint32_t position,
+                       uint32_t * runStart = nullptr,
+                       uint32_t * runLength = nullptr) const
+    {
+        auto run = Find(position);
+
+        if (runStart != nullptr)
+        {
+            *runStart = run->first;
+        }
+
+        if (runLength != nullptr)
+        {
+            *runLength = GetEnd(run) - run->first;
+        }
+
+        return run->second;
+    }
+
+    // Set all positions of a range to a value
+    void Set(uint32_t start, uint32_t length, const TValue & value)
+    {
+        uint32_t end = GetEnd(start, length);
+
+        if (start == end)
+        {
+            return;
+        }
+
+        auto first = Split(start);
+        auto last = Split(end);
+
+        first->second = value;
+        m_runs.erase(std::next(first), last);
+
+        Merge(first, last);
+    }
+
+    // Call update(TValue &) once for each run in a range
+    template<typename TUpdate>
+    void Update(uint32_t start, uint32_t length, const TUpdate & update)
+    {
+        uint32_t end = GetEnd(start, length);
+
+        if (start == end)
+        {
+            return;
+        }
+
+        auto first = Split(start);
+        auto last = Split(end);
+
+        for (auto run = first; run != last; run++)
+        {
+            update(run->second);
+        }
+
+        Merge(first, last);
+    }
+
+    // Call visit(uint32_t start, uint32_t length, const TValue &) for each
+    // run in a range, clipped to the range
+    template<typename TVisit>
+    void ForEachRun(uint32_t start, uint32_t length, const TVisit & visit) const
+    {
+        uint32_t end = GetEnd(start, length);
+
+        if (start == end)
+        {
+            return;
+        }
+
+        for (auto run = Find(start); run != m_runs.end() && run->first < end; run++)
+        {
+            uint32_t runStart = run->first > start ? run->first : start;
+            uint32_t runEnd = GetEnd(run) < end ? GetEnd(run) : end;
+
+            visit(runStart, runEnd - runStart, run->second);
+        }
+    }
+
+private:
+    typedef typename std::map<uint32_t, TValue>::iterator Iterator;
+    typedef typename std::map<uint32_t, TValue>::const_iterator ConstIterator;
+
+    static uint32_t GetEnd(uint32_t start, uint32_t length)
+    {
+        return length > MaxPosition - start ? MaxPosition : start + length;
+    }
+
+    uint32_t GetEnd(ConstIterator run) const
+    {
+        auto next = std::next(run);
+        return next == m_runs.end() ? MaxPosition : next->first;
+    }
+
+    // The run containing a position; there is always a run at 0
+    ConstIterator Find(uint32_t position) const
+    {
+        return std::prev(m_runs.upper_bound(position));
+    }
+
+    // Make a run start at a position and return it
+    Iterator Split(uint32_t position)
+    {
+        if (position == MaxPosition)
+        {
+            return m_runs.end();
+        }
+
+        auto next = m_runs.upper_bound(position);
+        auto run = std::prev(next);
+
+        if (run->first == position)
+        {
+            return run;
+        }
+
+        return m_runs.emplace_hint(next, position, run->second);
+    }
+
+    // Merge equal neighbours from the run before first up to the run at last
+    void Merge(Iterator first, Iterator last)
+    {
+        auto run = first == m_runs.begin() ? first : std::prev(first);
+
+        while (run != m_runs.end())
+        {
+            auto next = std::next(run);
+
+            if (next == m_runs.end())
+            {
+                break;
+            }
+
+            if (next->second == run->second)
+            {
+                bool isLast = next == last;
+                m_runs.erase(next);
+
+                if (isLast)
+                {
+                    break;
+                }
+            }
+            else if (next == last)
+            {
+                break;
+            }
+            else
+            {
+                run = next;
+            }
+        }
+    }
+
+    TValue m_defaultValue;
+    std::map<uint32_t, TValue> m_runs;
+};
@@ -0,0 +1,412 @@
+#include "pch.h"
+#include "SoftwareRenderSink.h"
+#include "Waveform.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(DIRECTX_MATH_VERSION)
+#include <DirectXPackedVector.h>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    inline float Clamp(float value, float low, float high)
+    {
+        return value < low ? low : (value > high ? high : value);
+    }
+
+    // Channel from 0 to 1, rounded to a whole number from 0 to 255
+    inline UINT32 ToByte(float channel)
+    {
+        return (UINT32) (Clamp(channel, 0, 1) * 255 + 0.5f);
+    }
+
+    // Pixel of a premultiplied color
+    inline UINT32 PackColor(const RenderColor & color)
+    {
+        return ToByte(color.r) |
+               (ToByte(color.g) << 8) |
+               (ToByte(color.b) << 16) |
+               (ToByte(color.a) << 24);
+    }
+
+    // Source-over of a premultiplied color with the given coverage, one
+    // channel at a time
+    inline void BlendScalar(UINT32 * pixel, const RenderColor & color, float coverage)
+    {
+        UINT8 * bytes = (UINT8 *) pixel;
+        const float * source = &color.r;
+        float inverse = 1 - color.a * coverage;
+
+        for (int channel = 0; channel < 4; channel++)
+        {
+            float value = source[channel] * coverage + bytes[channel] / 255.0f * inverse;
+            bytes[channel] = (UINT8) ToByte(value);
+        }
+    }
+
+#if defined(DIRECTX_MATH_VERSION)
+
+    // The four channels of a pixel at once, rounded like ToByte
+    inline void BlendSpanSimd(UINT32 * pixels, int count, const RenderColor & color, float coverage)
+    {
+        XMVECTOR vSource = XMVectorScale(XMLoadFloat4((const XMFLOAT4 *) &color), coverage);
+        XMVECTOR vInverse = XMVectorReplicate(1 - color.a * coverage);
+
+        for (int index = 0; index < count; index++)
+        {
+            XMVECTOR vDestination = XMLoadUByteN4((const XMUBYTEN4 *) (pixels + index));
+            XMVECTOR vResult = XMVectorMultiplyAdd(vDestination, vInverse, vSource);
+            XMVECTOR vBytes = XMVectorMultiplyAdd(XMVectorSaturate(vResult),
+                                                  XMVectorReplicate(255),
+                                                  XMVectorReplicate(0.5f));
+
+            XMStoreUByte4((XMUBYTE4 *) (pixels + index), XMVectorTruncate(vBytes));
+        }
+    }
+
+#elif defined(__SSE2__)
+
+    // Blends the channels of one pixel, held in the low lanes of a vector
+    // of 32-bit integers, and returns them in the range [0, 255]
+    inline __m128 BlendChannels(__m128i vChannels, __m128 vSource, __m128 vInverse)
+    {
+        __m128 vResult = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(vChannels), vInverse), vSource);
+        return _mm_min_ps(_mm_max_ps(vResult, _mm_setzero_ps()), _mm_set1_ps(255));
+    }
+
+    // Four pixels at a time, in the range [0, 255] so that the bytes do not
+    // have to be scaled, and rounded like ToByte
+    inline void BlendSpanSimd(UINT32 * pixels, int count, const RenderColor & color, float coverage)
+    {
+        __m128 vSource = _mm_mul_ps(_mm_loadu_ps(&color.r), _mm_set1_ps(coverage * 255));
+        __m128 vInverse = _mm_set1_ps(1 - color.a * coverage);
+        __m128 vHalf = _mm_set1_ps(0.5f);
+        __m128i vZero = _mm_setzero_si128();
+
+        int index = 0;
+
+        for (; index + 4 <= count; index += 4)
+        {
+            __m128i vPixels = _mm_loadu_si128((const __m128i *) (pixels + index));
+            __m128i vLow = _mm_unpacklo_epi8(vPixels, vZero);
+            __m128i vHigh = _mm_unpackhi_epi8(vPixels, vZero);
+
+            __m128 v0 = BlendChannels(_mm_unpacklo_epi16(vLow, vZero), vSource, vInverse);
+            __m128 v1 = BlendChannels(_mm_unpackhi_epi16(vLow, vZero), vSource, vInverse);
+            __m128 v2 = BlendChannels(_mm_unpacklo_epi16(vHigh, vZero), vSource, vInverse);
+            __m128 v3 = BlendChannels(_mm_unpackhi_epi16(vHigh, vZero), vSource, vInverse);
+
+            __m128i vBytes01 = _mm_packs_epi32(_mm_cvttps_epi32(_mm_add_ps(v0, vHalf)),
+                                               _mm_cvttps_epi32(_mm_add_ps(v1, vHalf)));
+            __m128i vBytes23 = _mm_packs_epi32(_mm_cvttps_epi32(_mm_add_ps(v2, vHalf)),
+                                               _mm_cvttps_epi32(_mm_add_ps(v3, vHalf)));
+
+            _mm_storeu_si128((__m128i *) (pixels + index), _mm_packus_epi16(vBytes01, vBytes23));
+        }
+
+        // Remaining pixels, one at a time
+        for (; index < count; index++)
+        {
+            __m128i vPixel = _mm_cvtsi32_si128((int) pixels[index]);
+            vPixel = _mm_unpacklo_epi16(_mm_unpacklo_epi8(vPixel, vZero), vZero);
+
+            __m128i vBytes = _mm_cvttps_epi32(_mm_add_ps(BlendChannels(vPixel, vSource, vInverse), vHalf));
+            vBytes = _mm_packs_epi32(vBytes, vBytes);
+
+            pixels[index] = (UINT32) _mm_cvtsi128_si32(_mm_packus_epi16(vBytes, vBytes));
+        }
+    }
+
+#else
+
+    inline void BlendSpanSimd(UINT32 * pixels, int count, const RenderColor & color, float coverage)
+    {
+        for (int index = 0; index < count; index++)
+        {
+            BlendScalar(pixels + index, color, coverage);
+        }
+    }
+
+#endif
+}
+
+SoftwareRenderSink::SoftwareRenderSink() :
+    m_pixels(nullptr),
+    m_width(0),
+    m_height(0),
+    m_stride(0),
+    m_worldToPixel(RenderMatrix::Identity()),
+    m_isScalarReference(false),
+    m_pixelCount(0)
+{
+}
+
+void SoftwareRenderSink::SetTarget(UINT32 * pixels, UINT32 width, UINT32 height, UINT32 stride)
+{
+    m_pixels = pixels;
+    m_width = (int) width;
+    m_height = (int) height;
+    m_stride = stride;
+}
+
+void SoftwareRenderSink::SetTransform(const RenderMatrix & worldToPixel)
+{
+    m_worldToPixel = worldToPixel;
+}
+
+void SoftwareRenderSink::SetBrushColor(BrushIndex brush, const RenderColor & color)
+{
+    if (brush >= m_brushColors.size())
+    {
+        m_brushColors.resize(brush + 1, BrushColor());
+    }
+
+    m_brushColors[brush].hasColor = true;
+    m_brushColors[brush].color = MakeColor(color.r * color.a,
+                                           color.g * color.a,
+                                           color.b * color.a,
+                                           color.a);
+}
+
+bool SoftwareRenderSink::GetColor(BrushIndex brush, RenderColor * color) const
+{
+    if (brush >= m_brushColors.size() || !m_brushColors[brush].hasColor)
+    {
+        return false;
+    }
+
+    *color = m_brushColors[brush].color;
+    return true;
+}
+
+void SoftwareRenderSink::Clear(const RenderColor & color)
+{
+    RenderColor premultiplied = MakeColor(color.r * color.a,
+                                          color.g * color.a,
+                                          color.b * color.a,
+                                          color.a);
+
+    for (int y = 0; y < m_height; y++)
+    {
+        // Transparent, then the color over it
+        UINT32 * row = m_pixels + (size_t) y * m_stride;
+        std::fill(row, row + m_width, 0);
+        FillSpan(row, 0, m_width, premultiplied, 1);
+    }
+}
+
+void SoftwareRenderSink::BlendPixel(UINT32 * pixel, const RenderColor & color, float coverage)
+{
+    if (m_isScalarReference)
+    {
+        BlendScalar(pixel, color, coverage);
+    }
+    else
+    {
+        BlendSpanSimd(pixel, 1, color, coverage);
+    }
+}
+
+void SoftwareRenderSink::FillSpan(UINT32 * row, int x0, int x1,
+                                  const RenderColor & color, float coverage)
+{
+    if (x0 >= x1 || coverage <= 0)
+    {
+        return;
+    }
+
+    m_pixelCount += x1 - x0;
+
+    if (m_isScalarReference)
+    {
+        for (int x = x0; x < x1; x++)
+        {
+            BlendScalar(row + x, color, coverage);
+        }
+
+        return;
+    }
+
+    // Opaque spans are a plain fill
+    if (coverage >= 1 && color.a >= 1)
+    {
+        std::fill(row + x0, row + x1, PackColor(color));
+        return;
+    }
+
+    BlendSpanSimd(row + x0, x1 - x0, color, min(coverage, 1.0f));
+}
+
+void SoftwareRenderSink::BeginPass(RenderPass)
+{
+}
+
+void SoftwareRenderSink::FillRectangle(const RenderRect & rect,
+                                       BrushIndex brush)
+{
+    RenderColor color;
+
+    if (m_pixels == nullptr || !GetColor(brush, &color))
+    {
+        return;
+    }
+
+    RenderPoint point0 = m_worldToPixel.TransformPoint(MakePoint(rect.left, rect.top));
+    RenderPoint point1 = m_worldToPixel.TransformPoint(MakePoint(rect.right, rect.bottom));
+
+    float left = max(min(point0.x, point1.x), 0.0f);
+    float top = max(min(point0.y, point1.y), 0.0f);
+    float right = min(max(point0.x, point1.x), (float) m_width);
+    float bottom = min(max(point0.y, point1.y), (float) m_height);
+
+    if (left >= right || top >= bottom)
+    {
+        return;
+    }
+
+    int x0 = (int) std::floor(left);
+    int x1 = (int) std::ceil(right);
+    int y0 = (int) std::floor(top);
+    int y1 = (int) std::ceil(bottom);
+
+    // Partial coverage on the edges, full coverage inside
+    for (int y = y0; y < y1; y++)
+    {
+        UINT32 * row = m_pixels + (size_t) y * m_stride;
+        float coverageY = min(bottom, y + 1.0f) - max(top, (float) y);
+
+        if (x1 - x0 == 1)
+        {
+            FillSpan(row, x0, x1, color, coverageY * (right - left));
+            continue;
+        }
+
+        FillSpan(row, x0, x0 + 1, color, coverageY * (x0 + 1 - left));
+        FillSpan(row, x0 + 1, x1 - 1, color, coverageY);
+        FillSpan(row, x1 - 1, x1, color, coverageY * (right - (x1 - 1)));
+    }
+}
+
+void SoftwareRenderSink::DrawGlyphRun(RenderPoint,
+                                      const DWRITE_GLYPH_RUN *,
+                                      BrushIndex,
+                                      DWRITE_MEASURING_MODE)
+{
+}
+
+void SoftwareRenderSink::DrawSquiggly(RenderPoint offset,
+                                      const SquigglyLine & squiggly,
+                                      BrushIndex brush)
+{
+    RenderColor color;
+
+    if (m_pixels == nullptr || !GetColor(brush, &color))
+    {
+        return;
+    }
+
+    // The same samples as the geometries of SquigglyGeometryCache, moved
+    // directly into pixel coordinates
+    UINT32 samplesPerDip = max(1u, (UINT32) std::ceil(squiggly.pixelsPerDip));
+    UINT32 count = GetWaveformPointCount((UINT32) squiggly.width, samplesPerDip);
+
+    m_points.resize(count);
+
+    GenerateWaveform(squiggly.thickness,
+                     5 * squiggly.thickness,
+                     squiggly.phase,
+                     samplesPerDip,
+                     count,
+                     m_points.data());
+
+    RenderMatrix transform = RenderMatrix::Translation(offset.x, offset.y) * m_worldToPixel;
+
+    for (RenderPoint & point : m_points)
+    {
+        point = transform.TransformPoint(point);
+    }
+
+    float halfWidth = squiggly.thickness * std::sqrt(std::fabs(m_worldToPixel.Determinant())) / 2;
+
+    // Coverage mask over the bounds of the stroke, so that pixels where
+    // segments join are only blended once
+    RenderRect bounds = MakeRect(m_points[0].x, m_points[0].y, m_points[0].x, m_points[0].y);
+
+    for (const RenderPoint & point : m_points)
+    {
+        bounds.left = min(bounds.left, point.x);
+        bounds.top = min(bounds.top, point.y);
+        bounds.right = max(bounds.right, point.x);
+        bounds.bottom = max(bounds.bottom, point.y);
+    }
+
+    int maskLeft = max(0, (int) std::floor(bounds.left - halfWidth - 1));
+    int maskTop = max(0, (int) std::floor(bounds.top - halfWidth - 1));
+    int maskRight = min(m_width, (int) std::ceil(bounds.right + halfWidth + 1));
+    int maskBottom = min(m_height, (int) std::ceil(bounds.bottom + halfWidth + 1));
+
+    if (maskLeft >= maskRight || maskTop >= maskBottom)
+    {
+        return;
+    }
+
+    int maskWidth = maskRight - maskLeft;
+    m_coverage.assign((size_t) maskWidth * (maskBottom - maskTop), 0.0f);
+
+    for (size_t index = 0; index + 1 < m_points.size(); index++)
+    {
+        RenderPoint a = m_points[index];
+        RenderPoint b = m_points[index + 1];
+
+        float dx = b.x - a.x;
+        float dy = b.y - a.y;
+        float lengthSquared = dx * dx + dy * dy;
+
+        int x0 = max(maskLeft, (int) std::floor(min(a.x, b.x) - halfWidth - 1));
+        int y0 = max(maskTop, (int) std::floor(min(a.y, b.y) - halfWidth - 1));
+        int x1 = min(maskRight, (int) std::ceil(max(a.x, b.x) + halfWidth + 1));
+        int y1 = min(maskBottom, (int) std::ceil(max(a.y, b.y) + halfWidth + 1));
+
+        for (int y = y0; y < y1; y++)
+        {
+            float * coverage = m_coverage.data() + (size_t) (y - maskTop) * maskWidth;
+            float py = y + 0.5f;
+
+            for (int x = x0; x < x1; x++)
+            {
+                // Distance from the pixel center to the segment
+                float px = x + 0.5f;
+                float t = lengthSquared > 0 ?
+                    Clamp(((px - a.x) * dx + (py - a.y) * dy) / lengthSquared, 0, 1) : 0;
+
+                float ex = a.x + t * dx - px;
+                float ey = a.y + t * dy - py;
+                float distance = std::sqrt(ex * ex + ey * ey);
+
+                float & pixelCoverage = coverage[x - maskLeft];
+                pixelCoverage = max(pixelCoverage, Clamp(halfWidth + 0.5f - distance, 0, 1));
+            }
+        }
+    }
+
+    for (int y = maskTop; y < maskBottom; y++)
+    {
+        UINT32 * row = m_pixels + (size_t) y * m_stride;
+        const float * coverage = m_coverage.data() + (size_t) (y - maskTop) * maskWidth;
+
+        for (int x = maskLeft; x < maskRight; x++)
+        {
+            if (coverage[x - maskLeft] > 0)
+            {
+                BlendPixel(row + x, color, coverage[x - maskLeft]);
+                m_pixelCount++;
+            }
+        }
+    }
+}
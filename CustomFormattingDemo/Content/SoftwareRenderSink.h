@@ -0,0 +1,86 @@
+#pragma once
+#include "RenderSink.h"
+
+// Rasterizes the backgrounds, decorations and highlights of a DisplayList
+// on the CPU, into a buffer of premultiplied RGBA pixels (R in the lowest
+// byte), with no Direct2D device. Glyph runs are skipped. Rectangles are
+// antialiased by coverage, squiggles are sampled as polylines and stroked
+// with a distance-based coverage mask, and everything is blended with
+// source-over, so translucent highlights match the Direct2D output. Spans
+// are blended four pixels at a time with SSE2, or one pixel at a time with
+// DirectXMath when it is available.
+//
+// Brushes are palette indices whose colors are given with SetBrushColor,
+// NoBrush being the default color; commands with a brush that has no color
+// are skipped. The world-to-pixel transform must not rotate or skew.
+class SoftwareRenderSink : public RenderSink
+{
+public:
+    SoftwareRenderSink();
+
+    // Pixels of the target, with rows stride pixels apart
+    void SetTarget(UINT32 * pixels, UINT32 width, UINT32 height, UINT32 stride);
+
+    // Usually the render transform times the DPI scale, like the
+    // worldToPixel transform CharacterFormatter snaps decorations with
+    void SetTransform(const RenderMatrix & worldToPixel);
+
+    // Colors have straight alpha, like those of BrushPalette, whose colors
+    // go to the same indices
+    void SetBrushColor(BrushIndex brush, const RenderColor & color);
+
+    void Clear(const RenderColor & color);
+
+    // Blend one channel of one pixel at a time instead of with SIMD, as a
+    // reference for the output and the speed
+    void SetScalarReference(bool isScalarReference) { m_isScalarReference = isScalarReference; }
+
+    // Pixels blended or filled, to measure throughput
+    UINT64 GetPixelCount() const { return m_pixelCount; }
+
+    virtual void BeginPass(RenderPass pass) override;
+
+    virtual void FillRectangle(const RenderRect & rect,
+                               BrushIndex brush) override;
+
+    virtual void DrawGlyphRun(RenderPoint baselineOrigin,
+                              const DWRITE_GLYPH_RUN * glyphRun,
+                              BrushIndex brush,
+                              DWRITE_MEASURING_MODE measuringMode) override;
+
+    virtual void DrawSquiggly(RenderPoint offset,
+                              const SquigglyLine & squiggly,
+                              BrushIndex brush) override;
+
+private:
+    // Premultiplied color of a brush
+    bool GetColor(BrushIndex brush, RenderColor * color) const;
+
+    // Blend a color over pixels [x0, x1) of a row with a uniform coverage
+    void FillSpan(UINT32 * row, int x0, int x1,
+                  const RenderColor & color, float coverage);
+
+    void BlendPixel(UINT32 * pixel, const RenderColor & color, float coverage);
+
+    UINT32 * m_pixels;
+    int      m_width;
+    int      m_height;
+    UINT32   m_stride;
+
+    RenderMatrix m_worldToPixel;
+    bool         m_isScalarReference;
+    UINT64       m_pixelCount;
+
+    struct BrushColor
+    {
+        bool        hasColor;
+        RenderColor color;      // Premultiplied
+    };
+
+    // Indexed by brush
+    std::vector<BrushColor> m_brushColors;
+
+    // Reused buffers for stroking squiggles
+    std::vector<RenderPoint> m_points;
+    std::vector<float>       m_coverage;
+};
@@ -0,0 +1,110 @@
+#include "pch.h"
+#include "SquigglyGeometryCache.h"
+#include "Waveform.h"
+
+using namespace D2D1;
+using namespace Microsoft::WRL;
+
+SquigglyGeometryCache::SquigglyGeometryCache()
+{
+}
+
+void SquigglyGeometryCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_geometries.clear();
+}
+
+HRESULT SquigglyGeometryCache::GetGeometry(ID2D1Factory * factory,
+                                           float thickness,
+                                           float width,
+                                           float phase,
+                                           float pixelsPerDip,
+                                           ID2D1Geometry ** geometry)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    // Geometries belong to the factory that created them
+    if (m_factory.Get() != factory)
+    {
+        m_geometries.clear();
+        m_factory = factory;
+    }
+
+    // The line has a whole number of points per DIP, so the integer width
+    // determines it
+    float period = 5 * thickness;
+    UINT32 phaseBuckets = (UINT32) (period * PhaseSteps + 0.5f);
+
+    Key key;
+    key.thickness = thickness;
+    key.widthBucket = (UINT32) width;
+    key.phaseBucket = (UINT32) (phase * PhaseSteps + 0.5f);
+
+    if (phaseBuckets > 0)
+    {
+        key.phaseBucket %= phaseBuckets;
+    }
+
+    key.samplesPerDip = max(1u, (UINT32) std::ceil(pixelsPerDip));
+
+    auto iterator = m_geometries.find(key);
+
+    if (iterator != m_geometries.end())
+    {
+        return iterator->second.CopyTo(geometry);
+    }
+
+    if (m_geometries.size() >= MaxGeometries)
+    {
+        m_geometries.clear();
+    }
+
+    ComPtr<ID2D1Geometry> newGeometry;
+    HRESULT hr;
+
+    if (S_OK != (hr = CreateGeometry(key, &newGeometry)))
+        return hr;
+
+    m_geometries[key] = newGeometry;
+    return newGeometry.CopyTo(geometry);
+}
+
+HRESULT SquigglyGeometryCache::CreateGeometry(const Key & key,
+                                              ID2D1Geometry ** geometry)
+{
+    HRESULT hr;
+    ComPtr<ID2D1PathGeometry> pathGeometry;
+
+    if (S_OK != (hr = m_factory->CreatePathGeometry(&pathGeometry)))
+        return hr;
+
+    ComPtr<ID2D1GeometrySink> geometrySink;
+    if (S_OK != (hr = pathGeometry->Open(&geometrySink)))
+        return hr;
+
+    float amplitude = 1 * key.thickness;
+    float period = 5 * key.thickness;
+    float phase = (float) key.phaseBucket / PhaseSteps;
+
+    UINT32 count = GetWaveformPointCount(key.widthBucket, key.samplesPerDip);
+    m_points.resize(count);
+
+    GenerateWaveform(amplitude,
+                     period,
+                     phase,
+                     key.samplesPerDip,
+                     count,
+                     m_points.data());
+
+    static_assert(sizeof(RenderPoint) == sizeof(D2D1_POINT_2F), "Points are passed as they are");
+
+    geometrySink->BeginFigure(Point2F(m_points[0].x, m_points[0].y), D2D1_FIGURE_BEGIN_HOLLOW);
+    geometrySink->AddLines((const D2D1_POINT_2F *) (m_points.data() + 1), count - 1);
+    geometrySink->EndFigure(D2D1_FIGURE_END_OPEN);
+
+    if (S_OK != (hr = geometrySink->Close()))
+        return hr;
+
+    return pathGeometry.CopyTo(geometry);
+}
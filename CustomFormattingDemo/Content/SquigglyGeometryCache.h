@@ -0,0 +1,75 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include "RenderTypes.h"
+
+// Caches the path geometries of squiggly underlines. Each geometry starts
+// at (0, 0) and is translated into place when drawn, so identical squiggles
+// anywhere on the page share one realized geometry. The cache can be used
+// from several threads at once.
+class SquigglyGeometryCache
+{
+public:
+    SquigglyGeometryCache();
+
+    // Get a squiggly line of the given thickness and width whose wave
+    // starts at the given phase (in DIPs, from 0 up to 5 * thickness),
+    // sampled about once per pixel
+    HRESULT GetGeometry(ID2D1Factory * factory,
+                        float thickness,
+                        float width,
+                        float phase,
+                        float pixelsPerDip,
+                        ID2D1Geometry ** geometry);
+
+    void Clear();
+
+    // Phase is rounded to 1/PhaseSteps of a DIP
+    static const int PhaseSteps = 16;
+
+    // The whole cache is discarded when it grows beyond this
+    static const size_t MaxGeometries = 256;
+
+private:
+    struct Key
+    {
+        float  thickness;
+        UINT32 widthBucket;
+        UINT32 phaseBucket;
+        UINT32 samplesPerDip;
+
+        bool operator==(const Key & other) const
+        {
+            return thickness == other.thickness &&
+                   widthBucket == other.widthBucket &&
+                   phaseBucket == other.phaseBucket &&
+                   samplesPerDip == other.samplesPerDip;
+        }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key & key) const
+        {
+            size_t hash = std::hash<float>()(key.thickness);
+            hash = hash * 31 + key.widthBucket;
+            hash = hash * 31 + key.phaseBucket;
+            hash = hash * 31 + key.samplesPerDip;
+            return hash;
+        }
+    };
+
+    HRESULT CreateGeometry(const Key & key, ID2D1Geometry ** geometry);
+
+    std::mutex m_lock;
+
+    Microsoft::WRL::ComPtr<ID2D1Factory> m_factory;
+
+    std::unordered_map<Key,
+                       Microsoft::WRL::ComPtr<ID2D1Geometry>,
+                       KeyHash> m_geometries;
+
+    // Reused buffer for the points of a new geometry
+    std::vector<RenderPoint> m_points;
+};
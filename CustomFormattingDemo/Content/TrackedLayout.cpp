@@ -0,0 +1,99 @@
+#include "pch.h"
+#include "TrackedLayout.h"
+
+TrackedLayout::Shard TrackedLayout::s_shards[TrackedLayout::ShardCount];
+
+TrackedLayout::TrackedLayout() :
+    m_entry(nullptr)
+{
+}
+
+TrackedLayout::TrackedLayout(IDWriteTextLayout * textLayout) :
+    m_textLayout(textLayout),
+    m_entry(nullptr)
+{
+    Track();
+}
+
+TrackedLayout::TrackedLayout(const TrackedLayout & other) :
+    m_textLayout(other.m_textLayout),
+    m_entry(nullptr)
+{
+    Track();
+}
+
+TrackedLayout::TrackedLayout(TrackedLayout && other) :
+    m_textLayout(std::move(other.m_textLayout)),
+    m_entry(other.m_entry)
+{
+    other.m_entry = nullptr;
+}
+
+TrackedLayout::~TrackedLayout()
+{
+    Untrack();
+}
+
+TrackedLayout & TrackedLayout::operator=(TrackedLayout other)
+{
+    // The argument is tracked before this one is released, so assigning
+    // the same layout keeps its entry and generation
+    std::swap(m_textLayout, other.m_textLayout);
+    std::swap(m_entry, other.m_entry);
+    return *this;
+}
+
+TrackedLayout::Shard & TrackedLayout::GetShard(IDWriteTextLayout * textLayout)
+{
+    // Layouts are heap objects, so the low bits of their addresses are
+    // always the same
+    size_t hash = (size_t) textLayout >> 6;
+    return s_shards[(hash ^ (hash >> 4)) % ShardCount];
+}
+
+void TrackedLayout::IncrementGeneration(IDWriteTextLayout * textLayout)
+{
+    Shard & shard = GetShard(textLayout);
+    std::lock_guard<std::mutex> lock(shard.lock);
+
+    auto iterator = shard.entries.find(textLayout);
+
+    if (iterator != shard.entries.end())
+    {
+        iterator->second.generation++;
+    }
+}
+
+void TrackedLayout::Track()
+{
+    if (m_textLayout == nullptr)
+    {
+        return;
+    }
+
+    Shard & shard = GetShard(m_textLayout.Get());
+    std::lock_guard<std::mutex> lock(shard.lock);
+
+    m_entry = &shard.entries[m_textLayout.Get()];
+    m_entry->trackerCount++;
+}
+
+void TrackedLayout::Untrack()
+{
+    if (m_entry == nullptr)
+    {
+        return;
+    }
+
+    {
+        Shard & shard = GetShard(m_textLayout.Get());
+        std::lock_guard<std::mutex> lock(shard.lock);
+
+        if (--m_entry->trackerCount == 0)
+        {
+            shard.entries.erase(m_textLayout.Get());
+        }
+    }
+
+    m_entry = nullptr;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+// Holds an IDWriteTextLayout together with the generation of its
+// formatting, which CharacterFormatSpecifier and FormattingBatch increment
+// whenever they set formatting on it, so that a rendering retained across
+// frames can tell when it is out of date. Only layouts held by a
+// TrackedLayout have a generation: formatting the other layouts of a
+// document or a log as they are created costs one lookup in a table
+// sharded by address, and never invalidates the renderings of other
+// layouts.
+class TrackedLayout
+{
+public:
+    TrackedLayout();
+    explicit TrackedLayout(IDWriteTextLayout * textLayout);
+    TrackedLayout(const TrackedLayout & other);
+    TrackedLayout(TrackedLayout && other);
+    ~TrackedLayout();
+
+    TrackedLayout & operator=(TrackedLayout other);
+
+    IDWriteTextLayout * Get() const { return m_textLayout.Get(); }
+
+    // Can be compared with a generation read earlier to know whether the
+    // formatting changed since; 0 when no layout is held
+    UINT32 GetGeneration() const
+    {
+        return m_entry != nullptr ? m_entry->generation.load() : 0;
+    }
+
+    // Called after the formatting of a layout is changed
+    static void IncrementGeneration(IDWriteTextLayout * textLayout);
+
+private:
+    struct Entry
+    {
+        Entry() :
+            generation(0),
+            trackerCount(0)
+        {
+        }
+
+        std::atomic<UINT32> generation;
+        UINT32              trackerCount;   // Guarded by the lock of the shard
+    };
+
+    // Entries are never moved by the map, so a tracker keeps a pointer to
+    // its entry and reads the generation without locking
+    struct Shard
+    {
+        std::mutex lock;
+        std::unordered_map<IDWriteTextLayout *, Entry> entries;
+    };
+
+    static const int ShardCount = 16;
+    static Shard s_shards[ShardCount];
+
+    static Shard & GetShard(IDWriteTextLayout * textLayout);
+
+    void Track();
+    void Untrack();
+
+    // Keeps the layout alive so its address cannot be reused
+    Microsoft::WRL::ComPtr<IDWriteTextLayout> m_textLayout;
+    Entry * m_entry;
+};
@@ -0,0 +1,151 @@
+#include "pch.h"
+#include "Waveform.h"
+
+#ifdef DIRECTX_MATH_VERSION
+
+using namespace DirectX;
+
+void GenerateWaveform(float amplitude,
+                      float period,
+                      float phase,
+                      UINT32 samplesPerDip,
+                      UINT32 count,
+                      RenderPoint * points)
+{
+    float step = 1.0f / samplesPerDip;
+    float scale = XM_2PI / period;
+
+    // Four samples per iteration, written out as interleaved points
+    XMVECTOR vOffsets = XMVectorSet(0, 1, 2, 3);
+    XMVECTOR vStep = XMVectorReplicate(step);
+    XMVECTOR vPhase = XMVectorReplicate(phase);
+    XMVECTOR vScale = XMVectorReplicate(scale);
+    XMVECTOR vAmplitude = XMVectorReplicate(amplitude);
+
+    UINT32 index = 0;
+
+    for (; index + 4 <= count; index += 4)
+    {
+        XMVECTOR vIndex = XMVectorAdd(XMVectorReplicate((float) index), vOffsets);
+        XMVECTOR vX = XMVectorMultiply(vIndex, vStep);
+        XMVECTOR vAngle = XMVectorMultiply(XMVectorAdd(vPhase, vX), vScale);
+        XMVECTOR vY = XMVectorMultiply(vAmplitude, XMVectorSin(vAngle));
+
+        // A point is two floats, so four points are two XMFLOAT4
+        XMFLOAT4 * destination = (XMFLOAT4 *) (points + index);
+        XMStoreFloat4(destination, XMVectorMergeXY(vX, vY));
+        XMStoreFloat4(destination + 1, XMVectorMergeZW(vX, vY));
+    }
+
+    // Remaining samples
+    for (; index < count; index++)
+    {
+        float x = index * step;
+        points[index].x = x;
+        points[index].y = amplitude * XMScalarSin(scale * (phase + x));
+    }
+}
+
+#elif defined(__SSE2__)
+
+#include <cstring>
+#include <emmintrin.h>
+
+namespace
+{
+    // The approximation of XMVectorSin: the angle is brought into
+    // [-pi, pi], reflected into [-pi/2, pi/2], and fed to an odd
+    // polynomial of degree 11
+    __m128 VectorSin(__m128 angle)
+    {
+        const float pi = 3.141592654f;
+
+        // Nearest multiple of 2 pi, rounding halves to even
+        __m128 turns = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(angle, _mm_set1_ps(1 / (2 * pi)))));
+        __m128 x = _mm_sub_ps(angle, _mm_mul_ps(turns, _mm_set1_ps(2 * pi)));
+
+        // sin(x) = sin(pi - x) = sin(-pi - x)
+        __m128 sign = _mm_and_ps(x, _mm_set1_ps(-0.0f));
+        __m128 reflected = _mm_sub_ps(_mm_or_ps(_mm_set1_ps(pi), sign), x);
+        __m128 isInner = _mm_cmple_ps(_mm_andnot_ps(sign, x), _mm_set1_ps(pi / 2));
+        x = _mm_or_ps(_mm_and_ps(isInner, x), _mm_andnot_ps(isInner, reflected));
+
+        __m128 x2 = _mm_mul_ps(x, x);
+        __m128 result = _mm_mul_ps(_mm_set1_ps(-2.3889859e-08f), x2);
+        result = _mm_mul_ps(_mm_add_ps(result, _mm_set1_ps(2.7525562e-06f)), x2);
+        result = _mm_mul_ps(_mm_add_ps(result, _mm_set1_ps(-0.00019840874f)), x2);
+        result = _mm_mul_ps(_mm_add_ps(result, _mm_set1_ps(0.0083333310f)), x2);
+        result = _mm_mul_ps(_mm_add_ps(result, _mm_set1_ps(-0.16666667f)), x2);
+        result = _mm_add_ps(result, _mm_set1_ps(1));
+
+        return _mm_mul_ps(result, x);
+    }
+}
+
+void GenerateWaveform(float amplitude,
+                      float period,
+                      float phase,
+                      UINT32 samplesPerDip,
+                      UINT32 count,
+                      RenderPoint * points)
+{
+    float step = 1.0f / samplesPerDip;
+    float scale = 2 * 3.141592654f / period;
+
+    // Four samples per iteration, written out as interleaved points
+    __m128 vOffsets = _mm_setr_ps(0, 1, 2, 3);
+    __m128 vStep = _mm_set1_ps(step);
+    __m128 vPhase = _mm_set1_ps(phase);
+    __m128 vScale = _mm_set1_ps(scale);
+    __m128 vAmplitude = _mm_set1_ps(amplitude);
+
+    for (UINT32 index = 0; index < count; index += 4)
+    {
+        __m128 vIndex = _mm_add_ps(_mm_set1_ps((float) index), vOffsets);
+        __m128 vX = _mm_mul_ps(vIndex, vStep);
+        __m128 vAngle = _mm_mul_ps(_mm_add_ps(vPhase, vX), vScale);
+        __m128 vY = _mm_mul_ps(vAmplitude, VectorSin(vAngle));
+
+        __m128 low = _mm_unpacklo_ps(vX, vY);
+        __m128 high = _mm_unpackhi_ps(vX, vY);
+
+        if (index + 4 <= count)
+        {
+            _mm_storeu_ps((float *) (points + index), low);
+            _mm_storeu_ps((float *) (points + index + 2), high);
+        }
+        else
+        {
+            // The remaining samples, from the same approximation
+            RenderPoint last[4];
+            _mm_storeu_ps((float *) last, low);
+            _mm_storeu_ps((float *) (last + 2), high);
+
+            std::memcpy(points + index, last, (count - index) * sizeof(RenderPoint));
+        }
+    }
+}
+
+#else
+
+#include <cmath>
+
+void GenerateWaveform(float amplitude,
+                      float period,
+                      float phase,
+                      UINT32 samplesPerDip,
+                      UINT32 count,
+                      RenderPoint * points)
+{
+    float step = 1.0f / samplesPerDip;
+    float scale = 2 * 3.141592654f / period;
+
+    for (UINT32 index = 0; index < count; index++)
+    {
+        float x = index * step;
+        points[index].x = x;
+        points[index].y = amplitude * std::sin(scale * (phase + x));
+    }
+}
+
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+#include "RenderTypes.h"
+
+// Number of points needed to sample a waveform of the given width with
+// the given number of samples per DIP, including both end points
+inline UINT32 GetWaveformPointCount(UINT32 width, UINT32 samplesPerDip)
+{
+    return width * samplesPerDip + 1;
+}
+
+// Fills points with the sine wave y = amplitude * sin(2 pi (phase + x) / period)
+// sampled at x = 0, 1 / samplesPerDip, 2 / samplesPerDip, and so on. Four
+// samples are computed at once with DirectXMath, which uses SSE2 on x86 and
+// x64, NEON on ARM, and scalar code when _XM_NO_INTRINSICS_ is defined.
+// Without DirectXMath, SSE2 computes the same approximation of the sine,
+// and the last resort is std::sin. RenderPoint has the layout of
+// D2D1_POINT_2F, so the points can go to a geometry sink as they are.
+void GenerateWaveform(float amplitude,
+                      float period,
+                      float phase,
+                      UINT32 samplesPerDip,
+                      UINT32 count,
+                      RenderPoint * points);
@@ -7,9 +7,36 @@ using namespace Windows::Foundation;
 using namespace Windows::System::Threading;
 using namespace Concurrency;
 
+// Refresh interval of a 60 Hz display, used to estimate the refreshes that
+// the on-demand render loop sleeps through; the actual display may differ.
+static const std::chrono::microseconds NominalRefreshInterval(16667);
+
+// How long StopRenderLoop waits for the render loop before it checks whether
+// the loop ever started.
+static const unsigned int RenderLoopStopPollMilliseconds = 100;
+
+namespace
+{
+	// Sets an event when it goes out of scope, however the scope is left.
+	class ScopedEventSet
+	{
+	public:
+		explicit ScopedEventSet(Concurrency::event& event) : m_event(event) {}
+		~ScopedEventSet() { m_event.set(); }
+
+	private:
+		ScopedEventSet(const ScopedEventSet&);
+		ScopedEventSet& operator=(const ScopedEventSet&);
+
+		Concurrency::event& m_event;
+	};
+}
+
 // Loads and initializes application assets when the application is loaded.
 CustomFormattingDemoMain::CustomFormattingDemoMain(const std::shared_ptr<DX::DeviceResources>& deviceResources) :
-	m_deviceResources(deviceResources), m_pointerLocationX(0.0f)
+	m_deviceResources(deviceResources), m_renderLoopStarted(false), m_pendingDisplayState(),
+	m_renderOnDemand(true), m_isDirty(true), m_framesRendered(0), m_estimatedFramesSkipped(0),
+	m_pointerLocationX(0.0f)
 {
 	// Register to be notified if the Device is lost or recreated
 	m_deviceResources->RegisterDeviceNotify(this);
@@ -23,6 +50,9 @@ CustomFormattingDemoMain::CustomFormattingDemoMain(const std::shared_ptr<DX::Dev
 	m_timer.SetFixedTimeStep(true);
 	m_timer.SetTargetElapsedSeconds(1.0 / 60);
 	*/
+
+	// The text is static, so frames are only rendered when something changes.
+	// Call SetRenderOnDemand(false) to render on every vertical blank instead.
 }
 
 CustomFormattingDemoMain::~CustomFormattingDemoMain()
@@ -37,6 +67,67 @@ void CustomFormattingDemoMain::CreateWindowSizeDependentResources()
 	// TODO: Replace this with the size-dependent initialization of your app's content.
 }
 
+void CustomFormattingDemoMain::SetRenderOnDemand(bool renderOnDemand)
+{
+	m_renderOnDemand = renderOnDemand;
+	Invalidate();
+}
+
+void CustomFormattingDemoMain::SetBitmapCaching(bool useBitmapCache)
+{
+	m_customFormattingDemoRenderer->SetBitmapCaching(useBitmapCache);
+	Invalidate();
+}
+
+void CustomFormattingDemoMain::SetDocument(const std::shared_ptr<const Document>& document)
+{
+	m_customFormattingDemoRenderer->SetDocument(document);
+	Invalidate();
+}
+
+void CustomFormattingDemoMain::LoadDocument(std::vector<ParagraphSource> paragraphs, const BrushPalette& brushPalette)
+{
+	// The render loop continues the layout while it holds this lock.
+	{
+		DX::TimedScopedLock lock(m_criticalSection, GetLockWaitStats(LockSite::LoadDocument));
+		m_customFormattingDemoRenderer->LoadDocument(std::move(paragraphs), brushPalette);
+	}
+
+	Invalidate();
+}
+
+HRESULT CustomFormattingDemoMain::LoadDocumentInParallel(const std::vector<ParagraphSource>& paragraphs,
+	const BrushPalette& brushPalette, unsigned int maxConcurrency)
+{
+	// The loader is shared with the incremental layout of the render loop.
+	HRESULT hr;
+	{
+		DX::TimedScopedLock lock(m_criticalSection, GetLockWaitStats(LockSite::LoadDocument));
+		hr = m_customFormattingDemoRenderer->LoadDocumentInParallel(paragraphs, brushPalette, maxConcurrency);
+	}
+
+	Invalidate();
+	return hr;
+}
+
+void CustomFormattingDemoMain::SetLayoutBudgetSeconds(double seconds)
+{
+	m_customFormattingDemoRenderer->SetLayoutBudgetSeconds(seconds);
+}
+
+void CustomFormattingDemoMain::SetLog(const std::shared_ptr<LogDocument>& log)
+{
+	m_customFormattingDemoRenderer->SetLog(log);
+	Invalidate();
+}
+
+// Requests a new frame; called on size, DPI, input and content changes.
+void CustomFormattingDemoMain::Invalidate()
+{
+	m_isDirty = true;
+	m_invalidated.set();
+}
+
 void CustomFormattingDemoMain::StartRenderLoop()
 {
 	// If the animation render loop is already running then do not start another thread.
@@ -45,33 +136,201 @@ void CustomFormattingDemoMain::StartRenderLoop()
 		return;
 	}
 
+	m_renderLoopStopped.reset();
+	m_renderLoopStarted = false;
+
 	// Create a task that will be run on a background thread.
 	auto workItemHandler = ref new WorkItemHandler([this](IAsyncAction ^ action)
 	{
-		// Calculate the updated frame and render once per vertical blanking interval.
+		// StopRenderLoop is released on every exit, including an exception thrown
+		// by Update, Render or Present.
+		m_renderLoopStarted = true;
+		ScopedEventSet stopped(m_renderLoopStopped);
+
+		// Calculate the updated frame and render once per vertical blanking interval,
+		// or only when invalidated in on-demand mode.
 		while (action->Status == AsyncStatus::Started)
 		{
-			critical_section::scoped_lock lock(m_criticalSection);
-			Update();
-			if (Render())
+			if (m_renderOnDemand)
 			{
-				m_deviceResources->Present();
+				auto sleepStart = std::chrono::steady_clock::now();
+				m_invalidated.wait();
+				m_invalidated.reset();
+
+				m_estimatedFramesSkipped += (std::chrono::steady_clock::now() - sleepStart) / NominalRefreshInterval;
+
+				if (!m_isDirty.exchange(false) || action->Status != AsyncStatus::Started)
+				{
+					continue;
+				}
+			}
+
+			bool rendered;
+			{
+				DX::TimedScopedLock lock(m_criticalSection, GetLockWaitStats(LockSite::RenderLoop));
+				ApplyDisplayState();
+
+				DX::ScopedFramePhase framePhase(m_timer, DX::FramePhase::Frame);
+				Update();
+				rendered = Render();
+			}
+
+			// Present waits for the vertical blank, so it is called outside the lock.
+			if (rendered)
+			{
+				bool presented;
+				{
+					DX::ScopedFramePhase presentPhase(m_timer, DX::FramePhase::Present);
+					presented = m_deviceResources->Present();
+				}
+
+				// Device lost: the renderers release and recreate their resources under
+				// the lock, so that the UI thread never sees them half recreated.
+				if (!presented)
+				{
+					DX::TimedScopedLock lock(m_criticalSection, GetLockWaitStats(LockSite::RenderLoop));
+					m_deviceResources->HandleDeviceLost();
+					continue;
+				}
+
+				m_timer.RecordPresent();
+				m_framesRendered++;
+			}
+			else
+			{
+				m_estimatedFramesSkipped++;
 			}
 		}
 	});
 
 	// Run task on a dedicated high priority background thread.
 	m_renderLoopWorker = ThreadPool::RunAsync(workItemHandler, WorkItemPriority::High, WorkItemOptions::TimeSliced);
+
+	// The swap chain must be redrawn when rendering resumes.
+	Invalidate();
 }
 
 void CustomFormattingDemoMain::StopRenderLoop()
 {
+	if (m_renderLoopWorker == nullptr)
+	{
+		return;
+	}
+
 	m_renderLoopWorker->Cancel();
+
+	// Wake the loop so that it sees the cancellation, and wait for it to leave the
+	// frame in progress; a loop started afterwards never overlaps with this one.
+	// A work item cancelled before it started never runs, so there is nothing to
+	// wait for; if it starts late, it sees the cancellation before rendering.
+	m_invalidated.set();
+
+	while (m_renderLoopStopped.wait(RenderLoopStopPollMilliseconds) == COOPERATIVE_WAIT_TIMEOUT)
+	{
+		if (!m_renderLoopStarted)
+		{
+			break;
+		}
+
+		m_invalidated.set();
+	}
+}
+
+void CustomFormattingDemoMain::SetLogicalSize(Size logicalSize)
+{
+	{
+		DX::TimedScopedLock lock(m_displayStateLock, GetLockWaitStats(LockSite::SizeChanged));
+		m_pendingDisplayState.logicalSize = logicalSize;
+		m_pendingDisplayState.changes |= LogicalSizeChange;
+	}
+	Invalidate();
+}
+
+void CustomFormattingDemoMain::SetCurrentOrientation(Windows::Graphics::Display::DisplayOrientations currentOrientation)
+{
+	{
+		DX::TimedScopedLock lock(m_displayStateLock, GetLockWaitStats(LockSite::OrientationChanged));
+		m_pendingDisplayState.currentOrientation = currentOrientation;
+		m_pendingDisplayState.changes |= OrientationChange;
+	}
+	Invalidate();
+}
+
+void CustomFormattingDemoMain::SetDpi(float dpi)
+{
+	{
+		DX::TimedScopedLock lock(m_displayStateLock, GetLockWaitStats(LockSite::DpiChanged));
+		m_pendingDisplayState.dpi = dpi;
+		m_pendingDisplayState.changes |= DpiChange;
+	}
+	Invalidate();
+}
+
+void CustomFormattingDemoMain::SetCompositionScale(float compositionScaleX, float compositionScaleY)
+{
+	{
+		DX::TimedScopedLock lock(m_displayStateLock, GetLockWaitStats(LockSite::CompositionScaleChanged));
+		m_pendingDisplayState.compositionScaleX = compositionScaleX;
+		m_pendingDisplayState.compositionScaleY = compositionScaleY;
+		m_pendingDisplayState.changes |= CompositionScaleChange;
+	}
+	Invalidate();
+}
+
+void CustomFormattingDemoMain::ValidateDevice()
+{
+	{
+		DX::TimedScopedLock lock(m_displayStateLock, GetLockWaitStats(LockSite::DisplayContentsInvalidated));
+		m_pendingDisplayState.changes |= ValidateDeviceChange;
+	}
+	Invalidate();
+}
+
+// Applies the display state changes made since the last frame.
+void CustomFormattingDemoMain::ApplyDisplayState()
+{
+	DisplayState state;
+	{
+		critical_section::scoped_lock lock(m_displayStateLock);
+		state = m_pendingDisplayState;
+		m_pendingDisplayState.changes = 0;
+	}
+
+	if (state.changes & DpiChange)
+	{
+		m_deviceResources->SetDpi(state.dpi);
+	}
+
+	if (state.changes & OrientationChange)
+	{
+		m_deviceResources->SetCurrentOrientation(state.currentOrientation);
+	}
+
+	if (state.changes & CompositionScaleChange)
+	{
+		m_deviceResources->SetCompositionScale(state.compositionScaleX, state.compositionScaleY);
+	}
+
+	if (state.changes & LogicalSizeChange)
+	{
+		m_deviceResources->SetLogicalSize(state.logicalSize);
+	}
+
+	if (state.changes & ValidateDeviceChange)
+	{
+		m_deviceResources->ValidateDevice();
+	}
+
+	if (state.changes & ~ValidateDeviceChange)
+	{
+		CreateWindowSizeDependentResources();
+	}
 }
 
 // Updates the application state once per frame.
 void CustomFormattingDemoMain::Update() 
 {
+	DX::ScopedFramePhase updatePhase(m_timer, DX::FramePhase::Update);
 	ProcessInput();
 
 	// Update scene objects.
@@ -99,9 +358,17 @@ bool CustomFormattingDemoMain::Render()
 	}
 
 
+	DX::ScopedFramePhase renderPhase(m_timer, DX::FramePhase::Render);
+
 	// Render the scene objects.
 	// Content rendering functions.
-	m_customFormattingDemoRenderer->Render();
+	m_customFormattingDemoRenderer->Render(m_timer);
+
+	// Keep rendering in on-demand mode until the document is laid out.
+	if (m_customFormattingDemoRenderer->IsLayoutPending())
+	{
+		Invalidate();
+	}
 
 	return true;
 }
@@ -117,4 +384,5 @@ void CustomFormattingDemoMain::OnDeviceRestored()
 {
 	m_customFormattingDemoRenderer->CreateDeviceDependentResources();
 	CreateWindowSizeDependentResources();
+	Invalidate();
 }
@@ -1,12 +1,28 @@
 ﻿#pragma once
 
+#include <atomic>
+#include <chrono>
 #include "Common\StepTimer.h"
 #include "Common\DeviceResources.h"
+#include "Common\LockWaitStats.h"
 #include "Content\CustomFormattingDemoRenderer.h"
 
 // Renders Direct2D and 3D content on the screen.
 namespace CustomFormattingDemo
 {
+	// Places where a lock is taken, for lock wait instrumentation.
+	enum class LockSite
+	{
+		SizeChanged,
+		DpiChanged,
+		OrientationChanged,
+		CompositionScaleChanged,
+		DisplayContentsInvalidated,
+		RenderLoop,
+		LoadDocument,
+		Count
+	};
+
 	class CustomFormattingDemoMain : public DX::IDeviceNotify
 	{
 	public:
@@ -14,13 +30,64 @@ namespace CustomFormattingDemo
 		~CustomFormattingDemoMain();
 		void CreateWindowSizeDependentResources();
 		void StartTracking() {  }
-		void TrackingUpdate(float positionX) { m_pointerLocationX = positionX; }
+		void TrackingUpdate(float positionX) { m_pointerLocationX = positionX; Invalidate(); }
 		void StopTracking() {  }
 		bool IsTracking() { return false; }
 		void StartRenderLoop();
+
+		// Returns once the frame in progress, if any, is presented, so that the caller
+		// can use the device afterwards.
 		void StopRenderLoop();
 		Concurrency::critical_section& GetCriticalSection() { return m_criticalSection; }
 
+		// In on-demand mode the render loop sleeps until Invalidate is called.
+		void SetRenderOnDemand(bool renderOnDemand);
+		void Invalidate();
+
+		// Composite the paragraph from a cached bitmap.
+		void SetBitmapCaching(bool useBitmapCache);
+
+		// Show a document built by a DocumentLoader; can be called from any thread.
+		void SetDocument(const std::shared_ptr<const Document>& document);
+
+		// Lay out a document over several frames, within a time budget per frame.
+		void LoadDocument(std::vector<ParagraphSource> paragraphs, const BrushPalette& brushPalette);
+
+		// Lay out a whole document at once on up to maxConcurrency threads, zero for
+		// all cores, and show it. Frames wait for the load, which holds the render lock.
+		HRESULT LoadDocumentInParallel(const std::vector<ParagraphSource>& paragraphs,
+			const BrushPalette& brushPalette, unsigned int maxConcurrency = 0);
+		void SetLayoutBudgetSeconds(double seconds);
+
+		// First paragraph that failed to lay out in the last LoadDocument, or S_OK.
+		HRESULT GetLayoutResult() const { return m_customFormattingDemoRenderer->GetLayoutResult(); }
+
+		// Show a live log. Threads that append lines to it call Invalidate
+		// afterwards; lines appended between two frames are drawn together.
+		void SetLog(const std::shared_ptr<LogDocument>& log);
+
+		// Frames presented.
+		uint64 GetFramesRendered() const { return m_framesRendered; }
+
+		// Display refreshes that were not rendered, estimated for a 60 Hz display: the
+		// frames that had nothing to draw, plus the time the on-demand render loop
+		// slept in 1/60 s intervals.
+		uint64 GetEstimatedFramesSkipped() const { return m_estimatedFramesSkipped; }
+
+		// Frame time histograms, per phase of the frame.
+		DX::StepTimer& GetTimer() { return m_timer; }
+
+		// Display state set by the UI thread and applied by the render loop before
+		// the next frame, so that the UI never waits for a frame to be presented.
+		void SetLogicalSize(Windows::Foundation::Size logicalSize);
+		void SetCurrentOrientation(Windows::Graphics::Display::DisplayOrientations currentOrientation);
+		void SetDpi(float dpi);
+		void SetCompositionScale(float compositionScaleX, float compositionScaleY);
+		void ValidateDevice();
+
+		// Time spent waiting for locks, per call site.
+		DX::LockWaitStats& GetLockWaitStats(LockSite site) { return m_lockWaitStats[static_cast<int>(site)]; }
+
 		// IDeviceNotify
 		virtual void OnDeviceLost();
 		virtual void OnDeviceRestored();
@@ -29,6 +96,27 @@ namespace CustomFormattingDemo
 		void ProcessInput();
 		void Update();
 		bool Render();
+		void ApplyDisplayState();
+
+		// Parameter block handed from the UI thread to the render loop.
+		enum DisplayStateChange
+		{
+			LogicalSizeChange		= 0x01,
+			OrientationChange		= 0x02,
+			DpiChange				= 0x04,
+			CompositionScaleChange	= 0x08,
+			ValidateDeviceChange	= 0x10
+		};
+
+		struct DisplayState
+		{
+			uint32 changes;
+			Windows::Foundation::Size logicalSize;
+			Windows::Graphics::Display::DisplayOrientations currentOrientation;
+			float dpi;
+			float compositionScaleX;
+			float compositionScaleY;
+		};
 
 		// Cached pointer to device resources.
 		std::shared_ptr<DX::DeviceResources> m_deviceResources;
@@ -37,8 +125,23 @@ namespace CustomFormattingDemo
 		std::unique_ptr<CustomFormattingDemoRenderer> m_customFormattingDemoRenderer;
 
 		Windows::Foundation::IAsyncAction^ m_renderLoopWorker;
+		Concurrency::event m_renderLoopStopped;
+		std::atomic<bool> m_renderLoopStarted;
 		Concurrency::critical_section m_criticalSection;
 
+		// Only held to copy the pending display state, never while rendering.
+		DisplayState m_pendingDisplayState;
+		Concurrency::critical_section m_displayStateLock;
+
+		DX::LockWaitStats m_lockWaitStats[static_cast<int>(LockSite::Count)];
+
+		// On-demand rendering.
+		std::atomic<bool> m_renderOnDemand;
+		std::atomic<bool> m_isDirty;
+		Concurrency::event m_invalidated;
+		std::atomic<uint64> m_framesRendered;
+		std::atomic<uint64> m_estimatedFramesSkipped;
+
 		// Rendering loop timer.
 		DX::StepTimer m_timer;
 
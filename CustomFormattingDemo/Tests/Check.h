@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdio>
+
+// The checks of the tests: a CHECK that fails prints its line and
+// condition and is counted, and main returns ReportChecks(), which prints
+// the summary and is nonzero if any check failed.
+#define CHECK(condition) Check((condition), #condition, __LINE__)
+
+// Checks that failed so far
+inline int & GetFailureCount()
+{
+    static int s_failureCount = 0;
+    return s_failureCount;
+}
+
+inline void Check(bool condition, const char * text, int line)
+{
+    if (!condition)
+    {
+        std::printf("line %d: CHECK(%s) failed\n", line, text);
+        GetFailureCount()++;
+    }
+}
+
+inline int ReportChecks()
+{
+    if (GetFailureCount() != 0)
+    {
+        std::printf("%d checks failed\n", GetFailureCount());
+        return 1;
+    }
+
+    std::printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,141 @@
+// Checks the buckets and percentiles of FrameTimeHistogram: exact values
+// below 64 microseconds, the relative error above, percentiles of a known
+// distribution, and values in the last bucket and beyond it.
+#include "FrameTimeHistogram.h"
+#include "Check.h"
+
+static void TestEmpty()
+{
+    DX::FrameTimeHistogram histogram;
+
+    CHECK(histogram.GetCount() == 0);
+    CHECK(histogram.GetMax() == 0);
+    CHECK(histogram.GetMean() == 0);
+    CHECK(histogram.GetP50() == 0);
+    CHECK(histogram.GetP99() == 0);
+}
+
+static void TestLinearBuckets()
+{
+    // Values below 64 have a bucket each, so percentiles are exact
+    DX::FrameTimeHistogram histogram;
+
+    for (uint64_t value = 0; value < 64; value++)
+    {
+        histogram.Record(value);
+    }
+
+    CHECK(histogram.GetCount() == 64);
+    CHECK(histogram.GetMax() == 63);
+    CHECK(histogram.GetPercentile(0.5) == 31);
+    CHECK(histogram.GetPercentile(0.25) == 15);
+    CHECK(histogram.GetPercentile(1.0) == 63);
+}
+
+static void TestRelativeError()
+{
+    // A value is reported as the upper bound of its bucket, which is
+    // within 1/32 of it; a larger value keeps the maximum out of the way
+    for (uint64_t value = 64; value < 4000000000ull; value += value / 7 + 1)
+    {
+        DX::FrameTimeHistogram histogram;
+        histogram.Record(value);
+        histogram.Record(value * 2);
+
+        uint64_t reported = histogram.GetP50();
+        CHECK(reported >= value);
+        CHECK(reported - value <= value / 32);
+    }
+}
+
+static void TestPercentiles()
+{
+    // 100 frames: 90 of 10 us, 5 of 1 ms, 4 of 16 ms and one of 50 ms
+    DX::FrameTimeHistogram histogram;
+
+    for (int frame = 0; frame < 90; frame++)
+    {
+        histogram.Record(10);
+    }
+
+    for (int frame = 0; frame < 5; frame++)
+    {
+        histogram.Record(1000);
+    }
+
+    for (int frame = 0; frame < 4; frame++)
+    {
+        histogram.Record(16000);
+    }
+
+    histogram.Record(50000);
+
+    CHECK(histogram.GetCount() == 100);
+    CHECK(histogram.GetMax() == 50000);
+    CHECK(histogram.GetMean() == 1199);
+
+    // 1000 is in the bucket 992..1007, and 16000 in 15872..16127
+    CHECK(histogram.GetP50() == 10);
+    CHECK(histogram.GetP95() == 1007);
+    CHECK(histogram.GetP99() == 16127);
+
+    // The last bucket reaches past the maximum, which bounds it
+    CHECK(histogram.GetPercentile(1.0) == 50000);
+
+    histogram.Reset();
+    CHECK(histogram.GetCount() == 0);
+    CHECK(histogram.GetP99() == 0);
+}
+
+static void TestLastBucket()
+{
+    // Bucket 895, the last one, holds 63 << 26 up to 2^32 - 1; larger
+    // values are recorded as 2^32 - 1
+    const uint64_t MaxValue = (1ull << 32) - 1;
+    const uint64_t LastBucketStart = 63ull << 26;
+
+    DX::FrameTimeHistogram histogram;
+
+    for (int frame = 0; frame < 97; frame++)
+    {
+        histogram.Record(100);
+    }
+
+    histogram.Record(LastBucketStart - 1);
+    histogram.Record(LastBucketStart);
+    histogram.Record(1ull << 40);
+
+    CHECK(histogram.GetCount() == 100);
+    CHECK(histogram.GetMax() == MaxValue);
+
+    // 100 is in the bucket 100..101
+    CHECK(histogram.GetP50() == 101);
+    CHECK(histogram.GetP95() == 101);
+
+    // Ranks 98, 99 and 100: the end of bucket 894, then bucket 895
+    CHECK(histogram.GetPercentile(0.98) == LastBucketStart - 1);
+    CHECK(histogram.GetP99() == MaxValue);
+    CHECK(histogram.GetPercentile(1.0) == MaxValue);
+
+    // Only values beyond the last bucket
+    DX::FrameTimeHistogram overflow;
+    overflow.Record(1ull << 40);
+    overflow.Record(UINT64_MAX);
+
+    CHECK(overflow.GetCount() == 2);
+    CHECK(overflow.GetMax() == MaxValue);
+    CHECK(overflow.GetMean() == MaxValue);
+    CHECK(overflow.GetP50() == MaxValue);
+    CHECK(overflow.GetP99() == MaxValue);
+}
+
+int main()
+{
+    TestEmpty();
+    TestLinearBuckets();
+    TestRelativeError();
+    TestPercentiles();
+    TestLastBucket();
+
+    return ReportChecks();
+}
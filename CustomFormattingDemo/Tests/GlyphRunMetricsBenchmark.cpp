@@ -0,0 +1,254 @@
+// Measures the two per-glyph-run costs of LayoutRecorder on synthetic
+// glyph runs: the width of a run, summed by SumGlyphAdvances against the
+// sequential loop it replaced, and the metrics of its face, read through
+// FontMetricsCache against asking the face for every run.
+#include "pch.h"
+#include "FontMetricsCache.h"
+#include "GlyphAdvances.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+typedef std::chrono::steady_clock Clock;
+
+// Keeps the results alive, so that the loops are not optimized away
+static volatile float s_result;
+
+// The loop of GetRectangle before SumGlyphAdvances
+static float SumSequentially(const FLOAT * advances, UINT32 count)
+{
+    float sum = 0;
+
+    for (UINT32 index = 0; index < count; index++)
+    {
+        sum += advances[index];
+    }
+
+    return sum;
+}
+
+// Repeats body, which processes itemCount items, for at least minSeconds
+// and returns the items per second
+template<class Body>
+static double Measure(double minSeconds, UINT64 itemCount, Body body)
+{
+    UINT64 repeatCount = 0;
+    double seconds = 0;
+    Clock::time_point start = Clock::now();
+
+    while (seconds < minSeconds)
+    {
+        body();
+        repeatCount++;
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    return repeatCount * itemCount / seconds;
+}
+
+typedef float (*SumFunction)(const FLOAT * advances, UINT32 count);
+
+// Both sums are called through these, so that neither is inlined into the
+// loop that measures it
+static SumFunction volatile s_kernel = SumGlyphAdvances;
+static SumFunction volatile s_loop = SumSequentially;
+
+static void BenchmarkAdvances(double minSeconds)
+{
+    // Advances of a proportional font at 16 DIPs
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> advance(3, 14);
+    std::vector<FLOAT> advances(1 << 16);
+
+    for (FLOAT & value : advances)
+    {
+        value = advance(random);
+    }
+
+    std::printf("%-12s %14s %14s %8s %12s\n",
+                "glyphs/run", "kernel glyphs/s", "loop glyphs/s", "speedup", "max rel diff");
+
+    UINT32 runLengths[] = { 1, 3, 8, 16, 64, 256 };
+
+    for (UINT32 runLength : runLengths)
+    {
+        UINT32 runCount = (UINT32) advances.size() / runLength;
+        UINT64 glyphCount = (UINT64) runCount * runLength;
+        double maxDifference = 0;
+
+        for (UINT32 run = 0; run < runCount; run++)
+        {
+            const FLOAT * first = advances.data() + run * runLength;
+            double kernel = SumGlyphAdvances(first, runLength);
+            double loop = SumSequentially(first, runLength);
+            maxDifference = std::fmax(maxDifference, std::fabs(kernel - loop) / loop);
+        }
+
+        double kernel = Measure(minSeconds, glyphCount, [&]()
+        {
+            SumFunction sum = s_kernel;
+            float total = 0;
+
+            for (UINT32 run = 0; run < runCount; run++)
+            {
+                total += sum(advances.data() + run * runLength, runLength);
+            }
+
+            s_result = total;
+        });
+
+        double loop = Measure(minSeconds, glyphCount, [&]()
+        {
+            SumFunction sum = s_loop;
+            float total = 0;
+
+            for (UINT32 run = 0; run < runCount; run++)
+            {
+                total += sum(advances.data() + run * runLength, runLength);
+            }
+
+            s_result = total;
+        });
+
+        std::printf("%-12u %14.3g %14.3g %7.2fx %12.2g\n",
+                    runLength, kernel, loop, kernel / loop, maxDifference);
+    }
+}
+
+// A face that reports fixed metrics, and counts how often it is asked
+class BenchmarkFontFace : public IDWriteFontFace
+{
+public:
+    BenchmarkFontFace(UINT16 ascent) :
+        m_ascent(ascent),
+        m_callCount(0)
+    {
+    }
+
+    virtual ULONG AddRef() override { return 1; }
+    virtual ULONG Release() override { return 1; }
+
+    virtual void GetMetrics(DWRITE_FONT_METRICS * fontFaceMetrics) override
+    {
+        *fontFaceMetrics = DWRITE_FONT_METRICS();
+        fontFaceMetrics->designUnitsPerEm = 2048;
+        fontFaceMetrics->ascent = m_ascent;
+        fontFaceMetrics->descent = 434;
+        fontFaceMetrics->lineGap = 67;
+        m_callCount++;
+    }
+
+    UINT64 GetCallCount() const { return m_callCount; }
+
+private:
+    UINT16 m_ascent;
+    UINT64 m_callCount;
+};
+
+static void BenchmarkMetrics(double minSeconds)
+{
+    // Runs of a paragraph, mostly in one face, with others for emphasis
+    // and code
+    std::vector<BenchmarkFontFace> faces;
+
+    for (UINT16 face = 0; face < 8; face++)
+    {
+        faces.push_back(BenchmarkFontFace((UINT16) (1800 + face)));
+    }
+
+    std::printf("\n%-12s %14s %14s %14s %10s\n",
+                "faces", "direct runs/s", "cache runs/s", "memo runs/s", "face calls");
+
+    UINT32 faceCounts[] = { 1, 2, 8 };
+
+    for (UINT32 faceCount : faceCounts)
+    {
+        std::mt19937 random(2);
+        std::vector<IDWriteFontFace *> runs(1 << 14);
+
+        for (IDWriteFontFace *& run : runs)
+        {
+            // Three runs in four are in the first face
+            UINT32 face = random() % 4 != 0 ? 0 : random() % faceCount;
+            run = &faces[face];
+        }
+
+        // Every run asks its face, as GetRectangle used to
+        double direct = Measure(minSeconds, runs.size(), [&]()
+        {
+            float total = 0;
+
+            for (IDWriteFontFace * fontFace : runs)
+            {
+                DWRITE_FONT_METRICS fontMetrics;
+                fontFace->GetMetrics(&fontMetrics);
+                total += (float) fontMetrics.ascent / fontMetrics.designUnitsPerEm;
+            }
+
+            s_result = total;
+        });
+
+        // Every run asks the cache
+        FontMetricsCache cache;
+        UINT64 callCount = 0;
+
+        for (const BenchmarkFontFace & face : faces)
+        {
+            callCount -= face.GetCallCount();
+        }
+
+        double cached = Measure(minSeconds, runs.size(), [&]()
+        {
+            float total = 0;
+
+            for (IDWriteFontFace * fontFace : runs)
+            {
+                total += cache.GetMetrics(fontFace).ascent;
+            }
+
+            s_result = total;
+        });
+
+        for (const BenchmarkFontFace & face : faces)
+        {
+            callCount += face.GetCallCount();
+        }
+
+        // Runs ask the cache only when the face changes, as LayoutRecorder
+        // does
+        double memo = Measure(minSeconds, runs.size(), [&]()
+        {
+            IDWriteFontFace * lastFace = nullptr;
+            FontMetricsPerEm metrics = FontMetricsPerEm();
+            float total = 0;
+
+            for (IDWriteFontFace * fontFace : runs)
+            {
+                if (fontFace != lastFace)
+                {
+                    metrics = cache.GetMetrics(fontFace);
+                    lastFace = fontFace;
+                }
+
+                total += metrics.ascent;
+            }
+
+            s_result = total;
+        });
+
+        std::printf("%-12u %14.3g %14.3g %14.3g %10llu\n",
+                    faceCount, direct, cached, memo, (unsigned long long) callCount);
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    double minSeconds = argc > 1 ? std::atof(argv[1]) : 0.3;
+
+    BenchmarkAdvances(minSeconds);
+    BenchmarkMetrics(minSeconds);
+
+    return 0;
+}
@@ -0,0 +1,218 @@
+// Measures how interning scales with threads, the way paragraphs are
+// formatted in parallel by DocumentLoader: each thread interns formats and
+// releases the ones it interned earlier, half of them the default format
+// of the text and the others drawn from a palette of a document. Reports
+// the wall time of a fixed amount of work, and its speedup over one
+// thread, for 1 to N threads, with the table split into 16 shards and with
+// a single lock, as CharacterFormatSpecifier had.
+#include "InternTable.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+struct ItemHasher
+{
+    template<typename T>
+    size_t operator()(const T * item) const
+    {
+        return (size_t) item->GetValue();
+    }
+};
+
+struct ItemComparer
+{
+    template<typename T>
+    bool operator()(const T * item1, const T * item2) const
+    {
+        return item1->GetValue() == item2->GetValue();
+    }
+};
+
+template<int ShardCount>
+class Item
+{
+public:
+    typedef InternTable<Item, ItemHasher, ItemComparer, ShardCount> Table;
+
+    explicit Item(int value, Table * table = nullptr) :
+        m_value(value),
+        m_refCount(0),
+        m_table(table)
+    {
+    }
+
+    static Item * Intern(Table * table, int value)
+    {
+        Item prototype(value);
+
+        return table->Intern(prototype, [table, value]()
+        {
+            Item * item = new Item(value, table);
+            item->m_refCount = 1;
+            return item;
+        });
+    }
+
+    void Release()
+    {
+        if (--m_refCount == 0)
+        {
+            m_table->Remove(this);
+            delete this;
+        }
+    }
+
+    bool TryAddRef()
+    {
+        int count = m_refCount;
+
+        while (count != 0)
+        {
+            if (m_refCount.compare_exchange_weak(count, count + 1))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    int GetValue() const { return m_value; }
+
+private:
+    int              m_value;
+    std::atomic<int> m_refCount;
+    Table *          m_table;
+};
+
+// Interns per second of operationCount interns shared by threadCount
+// threads, each holding the last 32 formats it interned, with the wall
+// time in seconds
+template<int ShardCount>
+static double Measure(unsigned int threadCount,
+                      uint64_t operationCount,
+                      int formatCount,
+                      double * seconds)
+{
+    typedef Item<ShardCount> ItemType;
+    typename ItemType::Table table;
+    const size_t heldCount = 32;
+
+    // Keeps the default format alive, as the text of a document does
+    ItemType * defaultFormat = ItemType::Intern(&table, 0);
+
+    std::atomic<bool> isStarted(false);
+    std::vector<std::thread> threads;
+
+    for (unsigned int thread = 0; thread < threadCount; thread++)
+    {
+        threads.push_back(std::thread([&, thread]()
+        {
+            std::mt19937 random(thread + 1);
+            std::vector<ItemType *> held(heldCount, nullptr);
+            uint64_t count = operationCount / threadCount;
+
+            while (!isStarted)
+            {
+                std::this_thread::yield();
+            }
+
+            for (uint64_t operation = 0; operation < count; operation++)
+            {
+                int value = random() % 2 == 0 ? 0 : (int) (random() % formatCount);
+                ItemType *& slot = held[operation % heldCount];
+
+                if (slot != nullptr)
+                {
+                    slot->Release();
+                }
+
+                slot = ItemType::Intern(&table, value);
+            }
+
+            for (ItemType * item : held)
+            {
+                if (item != nullptr)
+                {
+                    item->Release();
+                }
+            }
+        }));
+    }
+
+    Clock::time_point start = Clock::now();
+    isStarted = true;
+
+    for (std::thread & thread : threads)
+    {
+        thread.join();
+    }
+
+    *seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    defaultFormat->Release();
+    return operationCount / *seconds;
+}
+
+int main(int argc, char ** argv)
+{
+    // Interns done at each thread count; the first argument scales the
+    // work, and the second one overrides the number of cores
+    double scale = argc > 1 ? std::atof(argv[1]) / 0.3 : 1;
+    uint64_t operationCount = (uint64_t) (4000000 * scale);
+    unsigned int maxThreadCount = argc > 2 ? (unsigned int) std::atoi(argv[2]) :
+                                             std::thread::hardware_concurrency();
+    maxThreadCount = std::max(1u, maxThreadCount);
+
+    std::vector<unsigned int> threadCounts;
+
+    for (unsigned int threadCount = 1; threadCount < maxThreadCount; threadCount *= 2)
+    {
+        threadCounts.push_back(threadCount);
+    }
+
+    threadCounts.push_back(maxThreadCount);
+
+    int formatCounts[] = { 16, 256 };
+
+    for (int formatCount : formatCounts)
+    {
+        std::printf("%d formats, %llu interns\n", formatCount, (unsigned long long) operationCount);
+        std::printf("%-8s %14s %10s %8s %14s %10s %8s\n",
+                    "threads", "sharded /s", "seconds", "speedup",
+                    "one lock /s", "seconds", "speedup");
+
+        double shardedBase = 0;
+        double singleBase = 0;
+
+        for (unsigned int threadCount : threadCounts)
+        {
+            double shardedSeconds;
+            double singleSeconds;
+            double sharded = Measure<16>(threadCount, operationCount, formatCount, &shardedSeconds);
+            double single = Measure<1>(threadCount, operationCount, formatCount, &singleSeconds);
+
+            if (threadCount == 1)
+            {
+                shardedBase = shardedSeconds;
+                singleBase = singleSeconds;
+            }
+
+            std::printf("%-8u %14.3g %10.3f %7.2fx %14.3g %10.3f %7.2fx\n",
+                        threadCount,
+                        sharded, shardedSeconds, shardedBase / shardedSeconds,
+                        single, singleSeconds, singleBase / singleSeconds);
+        }
+
+        std::printf("\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,249 @@
+// Checks InternTable with reference-counted items that release themselves
+// the way CharacterFormatSpecifier does: equal values share one item, the
+// last release removes it, and an item whose last reference is being
+// released is replaced rather than revived, including from many threads.
+#include "InternTable.h"
+#include "Check.h"
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+class Item;
+
+struct ItemHasher
+{
+    size_t operator()(const Item * item) const;
+};
+
+struct ItemComparer
+{
+    bool operator()(const Item * item1, const Item * item2) const;
+};
+
+typedef InternTable<Item, ItemHasher, ItemComparer> ItemTable;
+
+static std::atomic<int> s_liveCount(0);
+
+class Item
+{
+public:
+    explicit Item(int value, ItemTable * table = nullptr) :
+        m_value(value),
+        m_refCount(0),
+        m_table(table)
+    {
+        if (m_table != nullptr)
+        {
+            s_liveCount++;
+        }
+    }
+
+    ~Item()
+    {
+        if (m_table != nullptr)
+        {
+            s_liveCount--;
+        }
+    }
+
+    static Item * Intern(ItemTable * table, int value)
+    {
+        Item prototype(value);
+
+        return table->Intern(prototype, [table, value]()
+        {
+            Item * item = new Item(value, table);
+            item->AddRef();
+            return item;
+        });
+    }
+
+    void AddRef() { m_refCount++; }
+
+    // The count of Release, before the item has removed itself
+    void DropLastReference() { m_refCount = 0; }
+
+    void Release()
+    {
+        if (--m_refCount == 0)
+        {
+            m_table->Remove(this);
+            delete this;
+        }
+    }
+
+    bool TryAddRef()
+    {
+        int count = m_refCount;
+
+        while (count != 0)
+        {
+            if (m_refCount.compare_exchange_weak(count, count + 1))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    int GetValue() const { return m_value; }
+    int GetRefCount() const { return m_refCount; }
+
+private:
+    int              m_value;
+    std::atomic<int> m_refCount;
+    ItemTable *      m_table;
+};
+
+size_t ItemHasher::operator()(const Item * item) const
+{
+    return (size_t) item->GetValue();
+}
+
+bool ItemComparer::operator()(const Item * item1, const Item * item2) const
+{
+    return item1->GetValue() == item2->GetValue();
+}
+
+static void TestSharing()
+{
+    ItemTable table;
+    Item * first = Item::Intern(&table, 7);
+    Item * second = Item::Intern(&table, 7);
+    Item * other = Item::Intern(&table, 8);
+
+    CHECK(first == second);
+    CHECK(first->GetRefCount() == 2);
+    CHECK(other != first);
+    CHECK(other->GetValue() == 8);
+    CHECK(table.GetSize() == 2);
+
+    first->Release();
+    CHECK(table.GetSize() == 2);
+
+    second->Release();
+    CHECK(table.GetSize() == 1);
+
+    other->Release();
+    CHECK(table.GetSize() == 0);
+    CHECK(s_liveCount == 0);
+}
+
+static void TestShards()
+{
+    // Many values spread over the shards, and are all found again
+    ItemTable table;
+    std::vector<Item *> items;
+
+    for (int value = 0; value < 1000; value++)
+    {
+        items.push_back(Item::Intern(&table, value));
+    }
+
+    CHECK(table.GetSize() == 1000);
+
+    for (int value = 0; value < 1000; value++)
+    {
+        Item * item = Item::Intern(&table, value);
+        CHECK(item == items[value]);
+        item->Release();
+    }
+
+    for (Item * item : items)
+    {
+        item->Release();
+    }
+
+    CHECK(table.GetSize() == 0);
+}
+
+static void TestDyingItem()
+{
+    // An item whose count has dropped to zero, but which has not removed
+    // itself yet, is replaced; its late Remove leaves the new one alone
+    ItemTable table;
+    Item * dying = Item::Intern(&table, 3);
+    dying->DropLastReference();
+
+    Item * replacement = Item::Intern(&table, 3);
+    CHECK(replacement != dying);
+    CHECK(replacement->GetRefCount() == 1);
+    CHECK(table.GetSize() == 1);
+
+    table.Remove(dying);
+    CHECK(table.GetSize() == 1);
+    CHECK(Item::Intern(&table, 3) == replacement);
+
+    delete dying;
+    replacement->Release();
+    replacement->Release();
+    CHECK(table.GetSize() == 0);
+    CHECK(s_liveCount == 0);
+}
+
+static void TestThreads()
+{
+    // Threads intern and release a few values at random; every intern of a
+    // value must return an item of that value, and nothing may leak
+    ItemTable table;
+    std::atomic<int> mismatchCount(0);
+    std::vector<std::thread> threads;
+
+    for (unsigned int thread = 0; thread < 8; thread++)
+    {
+        threads.push_back(std::thread([&table, &mismatchCount, thread]()
+        {
+            std::mt19937 random(thread);
+            std::vector<Item *> held;
+
+            for (int step = 0; step < 20000; step++)
+            {
+                if (held.size() < 4 || (random() % 2 == 0 && held.size() < 16))
+                {
+                    int value = (int) (random() % 24);
+                    Item * item = Item::Intern(&table, value);
+
+                    if (item->GetValue() != value)
+                    {
+                        mismatchCount++;
+                    }
+
+                    held.push_back(item);
+                }
+                else
+                {
+                    size_t index = random() % held.size();
+                    held[index]->Release();
+                    held[index] = held.back();
+                    held.pop_back();
+                }
+            }
+
+            for (Item * item : held)
+            {
+                item->Release();
+            }
+        }));
+    }
+
+    for (std::thread & thread : threads)
+    {
+        thread.join();
+    }
+
+    CHECK(mismatchCount == 0);
+    CHECK(table.GetSize() == 0);
+    CHECK(s_liveCount == 0);
+}
+
+int main()
+{
+    TestSharing();
+    TestShards();
+    TestDyingItem();
+    TestThreads();
+
+    return ReportChecks();
+}
@@ -0,0 +1,380 @@
+// Checks what LayoutRecorder records for synthetic layouts: the pass of
+// each command, the painter's order of decorations and glyphs, merging,
+// brush fallbacks, culling and pixel snapping; and the advance sums and
+// font metrics it relies on.
+#include "StubLayout.h"
+#include "GlyphAdvances.h"
+#include "Check.h"
+#include <cmath>
+
+typedef RecordingRenderSink::Command Command;
+typedef RecordingRenderSink::CommandType CommandType;
+
+// Record the layout and capture the commands, pass by pass
+static std::vector<Command> Record(StubLayout & layout,
+                                   const RenderRect * clipRect = nullptr,
+                                   const RenderMatrix & transform = RenderMatrix::Identity(),
+                                   float dpi = 96,
+                                   HRESULT * result = nullptr)
+{
+    LayoutRecorder recorder;
+    DisplayList displayList;
+    RecordingRenderSink sink;
+
+    HRESULT hr = layout.Draw(&recorder, &displayList, MakePoint(0, 0), clipRect, transform, dpi);
+
+    if (result != nullptr)
+    {
+        *result = hr;
+    }
+
+    displayList.Replay(&sink);
+    return sink.GetCommands();
+}
+
+static std::vector<Command> GetPass(const std::vector<Command> & commands, RenderPass pass)
+{
+    std::vector<Command> passCommands;
+
+    for (const Command & command : commands)
+    {
+        if (command.pass == pass)
+        {
+            passCommands.push_back(command);
+        }
+    }
+
+    return passCommands;
+}
+
+static void TestPasses()
+{
+    FormatValues format;
+    format.foregroundBrush = 1;
+    format.backgroundBrush = 2;
+    format.highlightBrush = 3;
+
+    StubLayout layout;
+    layout.AddLine(20, 16);
+    layout.AddRun(4, 8, &format);
+    layout.AddRun(2, 8, nullptr);
+
+    std::vector<Command> commands = Record(layout);
+    std::vector<Command> initial = GetPass(commands, RenderPass::Initial);
+    std::vector<Command> main = GetPass(commands, RenderPass::Main);
+    std::vector<Command> final = GetPass(commands, RenderPass::Final);
+
+    // Background below, highlight above the glyphs
+    CHECK(initial.size() == 1);
+    CHECK(initial[0].type == CommandType::FillRectangle);
+    CHECK(initial[0].brush == 2);
+    CHECK(initial[0].rect.left == 0 && initial[0].rect.right == 32);
+
+    // Text height from the font metrics of the stub
+    CHECK(initial[0].rect.top == 16 - StubLayout::EmSize * 0.9f);
+    CHECK(initial[0].rect.bottom == 16 + StubLayout::EmSize * 0.25f);
+
+    CHECK(main.size() == 2);
+    CHECK(main[0].type == CommandType::GlyphRun && main[0].brush == 1);
+    CHECK(main[0].glyphCount == 4 && main[0].width == 32);
+
+    // Runs without formatting take the default brush
+    CHECK(main[1].type == CommandType::GlyphRun && main[1].brush == NoBrush);
+    CHECK(main[1].origin.x == 32);
+
+    CHECK(final.size() == 1);
+    CHECK(final[0].brush == 3);
+}
+
+static void TestBackgroundModes()
+{
+    FormatValues format;
+    format.backgroundBrush = 1;
+
+    StubLayout layout;
+    layout.AddLine(30, 20);
+
+    format.backgroundMode = BackgroundMode::LineHeight;
+    layout.AddRun(1, 8, &format);
+
+    format.backgroundMode = BackgroundMode::TextHeightWithLineGap;
+    layout.AddRun(1, 8, &format);
+
+    std::vector<Command> initial = GetPass(Record(layout), RenderPass::Initial);
+
+    CHECK(initial.size() == 2);
+    CHECK(initial[0].rect.top == 0 && initial[0].rect.bottom == 30);
+    CHECK(std::fabs(initial[1].rect.bottom - (20 + StubLayout::EmSize * 0.35f)) < 1e-4f);
+}
+
+static void TestTrailingWhiteSpace()
+{
+    FormatValues format;
+    format.backgroundBrush = 1;
+    format.highlightBrush = 2;
+
+    StubLayout layout;
+    layout.AddLine(20, 16);
+    layout.AddRun(3, 8, &format);
+    layout.AddTrailingSpace(4, &format);
+
+    std::vector<Command> commands = Record(layout);
+
+    // The space is drawn, but without background or highlight
+    CHECK(GetPass(commands, RenderPass::Initial).size() == 1);
+    CHECK(GetPass(commands, RenderPass::Main).size() == 2);
+    CHECK(GetPass(commands, RenderPass::Final).size() == 1);
+}
+
+static void TestMergedUnderlines()
+{
+    // A color change splits the text, but not its underline
+    FormatValues format1;
+    format1.foregroundBrush = 1;
+    format1.underlineType = UnderlineType::Single;
+    format1.underlineBrush = 3;
+
+    FormatValues format2 = format1;
+    format2.foregroundBrush = 2;
+
+    StubLayout layout;
+    layout.AddLine(20, 16);
+    layout.AddRun(3, 8, &format1);
+    layout.AddRun(3, 8, &format2);
+
+    LayoutRecorder recorder;
+    DisplayList displayList;
+    RecordingRenderSink sink;
+
+    CHECK(layout.Draw(&recorder, &displayList, MakePoint(0, 0)) == S_OK);
+    displayList.Replay(&sink);
+
+    std::vector<Command> main = GetPass(sink.GetCommands(), RenderPass::Main);
+
+    CHECK(recorder.GetDecorationRectangleCount() == 2);
+    CHECK(recorder.GetDecorationFillCount() == 1);
+
+    CHECK(main.size() == 3);
+    CHECK(main[2].type == CommandType::FillRectangle);
+    CHECK(main[2].brush == 3);
+    CHECK(main[2].rect.left == 0 && main[2].rect.right == 48);
+    CHECK(main[2].rect.bottom - main[2].rect.top == StubLayout::EmSize / 16);
+}
+
+static void TestDecorationBrushes()
+{
+    // Without a brush of their own, decorations take the foreground brush
+    FormatValues format;
+    format.foregroundBrush = 4;
+    format.underlineType = UnderlineType::Single;
+    format.strikethroughCount = 1;
+    format.strikethroughBrush = 5;
+
+    FormatValues plain;
+    plain.underlineType = UnderlineType::Single;
+
+    StubLayout layout;
+    layout.AddLine(20, 16);
+    layout.AddRun(3, 8, &format);
+    layout.AddLine(20, 16);
+    layout.AddRun(3, 8, &plain);
+
+    std::vector<Command> main = GetPass(Record(layout), RenderPass::Main);
+
+    CHECK(main.size() == 5);
+    CHECK(main[0].type == CommandType::GlyphRun && main[0].brush == 4);
+    CHECK(main[1].type == CommandType::FillRectangle && main[1].brush == 4);
+    CHECK(main[2].type == CommandType::FillRectangle && main[2].brush == 5);
+    CHECK(main[3].type == CommandType::GlyphRun && main[3].brush == NoBrush);
+    CHECK(main[4].type == CommandType::FillRectangle && main[4].brush == NoBrush);
+}
+
+static void TestPaintersOrder()
+{
+    // Decorations of a line are drawn before the glyphs of the next line
+    // and before a squiggle, as the layout reports them
+    FormatValues underlined;
+    underlined.underlineType = UnderlineType::Single;
+    underlined.underlineBrush = 1;
+
+    FormatValues squiggly;
+    squiggly.underlineType = UnderlineType::Squiggly;
+    squiggly.underlineBrush = 2;
+
+    StubLayout layout;
+    layout.AddLine(20, 16);
+    layout.AddRun(3, 8, &underlined);
+    layout.AddRun(3, 8, &squiggly);
+    layout.AddRun(3, 8, &underlined);
+    layout.AddLine(20, 16);
+    layout.AddRun(3, 8, &underlined);
+
+    std::vector<Command> main = GetPass(Record(layout), RenderPass::Main);
+
+    CommandType expected[] =
+    {
+        CommandType::GlyphRun,
+        CommandType::GlyphRun,
+        CommandType::GlyphRun,
+        CommandType::FillRectangle,     // First underline
+        CommandType::Squiggly,
+        CommandType::FillRectangle,     // Third underline
+        CommandType::GlyphRun,          // Second line
+        CommandType::FillRectangle
+    };
+
+    CHECK(main.size() == sizeof(expected) / sizeof(expected[0]));
+
+    for (size_t index = 0; index < main.size() && index < sizeof(expected) / sizeof(expected[0]); index++)
+    {
+        CHECK(main[index].type == expected[index]);
+    }
+
+    // The squiggle starts where its run does; its wave is anchored to x = 0
+    CHECK(main[4].origin.x == 24);
+    CHECK(main[4].width == 24);
+}
+
+static void TestSquigglyPhase()
+{
+    FormatValues squiggly;
+    squiggly.underlineType = UnderlineType::Squiggly;
+
+    StubLayout layout;
+    layout.AddLine(20, 16);
+    layout.AddRun(3, 7, nullptr);
+    layout.AddRun(3, 8, &squiggly);
+
+    LayoutRecorder recorder;
+    DisplayList displayList;
+
+    // Capture the parameters through a sink of our own
+    class SquigglySink : public RecordingRenderSink
+    {
+    public:
+        virtual void DrawSquiggly(RenderPoint offset,
+                                  const SquigglyLine & line,
+                                  BrushIndex brush) override
+        {
+            squiggly = line;
+            RecordingRenderSink::DrawSquiggly(offset, line, brush);
+        }
+
+        SquigglyLine squiggly;
+    };
+
+    SquigglySink sink;
+    CHECK(layout.Draw(&recorder, &displayList, MakePoint(0, 0), nullptr,
+                      RenderMatrix::Identity(), 192) == S_OK);
+    displayList.Replay(&sink);
+
+    float thickness = StubLayout::EmSize / 16;
+    CHECK(sink.squiggly.thickness == thickness);
+    CHECK(sink.squiggly.pixelsPerDip == 2);
+    CHECK(std::fabs(sink.squiggly.phase - std::fmod(21.0f, 5 * thickness)) < 1e-4f);
+}
+
+static void TestCulling()
+{
+    StubLayout layout = StubLayout::CreateParagraph(10, 4, 5);
+
+    // Lines 3 to 5 are visible, and only the left of them
+    RenderRect clipRect = MakeRect(0, 3 * 20 + 1, 50, 6 * 20 - 1);
+    std::vector<Command> commands = Record(layout, &clipRect);
+
+    CHECK(!commands.empty());
+
+    for (const Command & command : commands)
+    {
+        // Decorations are culled as a whole, so an overline can lie just
+        // above the clip
+        if (command.type == CommandType::FillRectangle)
+        {
+            CHECK(command.rect.top >= 3 * 20 - 1 && command.rect.bottom <= 6 * 20 + 1);
+            CHECK(command.rect.right >= clipRect.left && command.rect.left <= clipRect.right);
+        }
+        else
+        {
+            CHECK(command.origin.y > 3 * 20 && command.origin.y < 6 * 20);
+            CHECK(command.origin.x <= clipRect.right);
+        }
+    }
+
+    // Without a clip, everything is recorded
+    std::vector<Command> all = Record(layout);
+    UINT32 glyphRunCount = 0;
+
+    for (const Command & command : all)
+    {
+        glyphRunCount += command.type == CommandType::GlyphRun;
+    }
+
+    CHECK(glyphRunCount == 10 * 5);
+}
+
+static void TestPixelSnapping()
+{
+    FormatValues format;
+    format.underlineType = UnderlineType::Single;
+
+    // A fractional baseline, at 1.5 pixels per DIP
+    StubLayout layout;
+    layout.AddLine(20, 16.3f);
+    layout.AddRun(3, 8, &format);
+
+    std::vector<Command> main = GetPass(Record(layout, nullptr, RenderMatrix::Identity(), 144),
+                                        RenderPass::Main);
+
+    CHECK(main.size() == 2);
+
+    float pixelTop = main[1].rect.top * 1.5f;
+    CHECK(std::fabs(pixelTop - std::floor(pixelTop + 0.5f)) < 1e-3f);
+}
+
+static void TestInvalidInput()
+{
+    FormatValues format;
+    format.strikethroughCount = 4;
+
+    StubLayout layout;
+    layout.AddLine(20, 16);
+    layout.AddRun(3, 8, &format);
+
+    HRESULT hr;
+    Record(layout, nullptr, RenderMatrix::Identity(), 96, &hr);
+    CHECK(hr == E_INVALIDARG);
+}
+
+static void TestGlyphAdvances()
+{
+    // Whole advances add up exactly in any order, whatever the remainder
+    FLOAT advances[11] = { 3, 9, 4, 12, 7, 7, 5, 10, 6, 8, 11 };
+    float sum = 0;
+
+    for (UINT32 count = 0; count <= 11; count++)
+    {
+        CHECK(SumGlyphAdvances(advances, count) == sum);
+
+        if (count < 11)
+        {
+            sum += advances[count];
+        }
+    }
+}
+
+int main()
+{
+    TestGlyphAdvances();
+    TestPasses();
+    TestBackgroundModes();
+    TestTrailingWhiteSpace();
+    TestMergedUnderlines();
+    TestDecorationBrushes();
+    TestPaintersOrder();
+    TestSquigglyPhase();
+    TestCulling();
+    TestPixelSnapping();
+    TestInvalidInput();
+
+    return ReportChecks();
+}
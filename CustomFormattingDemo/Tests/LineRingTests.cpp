@@ -0,0 +1,152 @@
+// Checks LineRing, the ring buffer of LogDocument: lines are kept up to the
+// capacity, the oldest ones are evicted first and handed back to the
+// caller, and the tail is read newest first up to a height.
+#include "pch.h"
+#include "LineRing.h"
+#include "Check.h"
+#include <memory>
+
+// A line whose layout is a number, shared to see when it is released
+struct TestLine
+{
+    std::shared_ptr<int> layout;
+    FLOAT                height;
+};
+
+static std::vector<TestLine> CreateLines(int first, int count, FLOAT height = 10)
+{
+    std::vector<TestLine> lines(count);
+
+    for (int index = 0; index < count; index++)
+    {
+        lines[index].layout = std::make_shared<int>(first + index);
+        lines[index].height = height;
+    }
+
+    return lines;
+}
+
+static void TestFilling()
+{
+    LineRing<TestLine> ring(4);
+    std::vector<TestLine> lines = CreateLines(0, 3);
+    ring.Push(&lines, 0);
+
+    CHECK(ring.GetCapacity() == 4);
+    CHECK(ring.GetCount() == 3);
+    CHECK(ring.GetPushedCount() == 3);
+
+    // Nothing was evicted: the slots swapped back were empty
+    CHECK(lines.size() == 3);
+    CHECK(lines[0].layout == nullptr && lines[2].layout == nullptr);
+
+    std::vector<TestLine> tail;
+    ring.GetTail(1000, &tail);
+    CHECK(tail.size() == 3);
+    CHECK(*tail[0].layout == 2 && *tail[2].layout == 0);
+}
+
+static void TestEviction()
+{
+    LineRing<TestLine> ring(4);
+    std::vector<TestLine> lines = CreateLines(0, 4);
+    ring.Push(&lines, 0);
+
+    std::vector<TestLine> tail;
+    ring.GetTail(1000, &tail);
+    std::weak_ptr<int> oldest = tail.back().layout;
+    tail.clear();
+
+    // Each new line replaces the oldest, which comes back in the batch
+    lines = CreateLines(4, 2);
+    ring.Push(&lines, 0);
+
+    CHECK(ring.GetCount() == 4);
+    CHECK(ring.GetPushedCount() == 6);
+    CHECK(lines.size() == 2);
+    CHECK(*lines[0].layout == 0 && *lines[1].layout == 1);
+    CHECK(!oldest.expired());
+
+    // Released with the batch, outside the ring
+    lines.clear();
+    CHECK(oldest.expired());
+
+    ring.GetTail(1000, &tail);
+    CHECK(tail.size() == 4);
+    CHECK(*tail[0].layout == 5 && *tail[3].layout == 2);
+}
+
+static void TestWrapping()
+{
+    // Many pushes of odd sizes keep the newest lines in order
+    LineRing<TestLine> ring(5);
+    int next = 0;
+
+    for (int batch = 0; batch < 50; batch++)
+    {
+        int count = 1 + batch % 3;
+        std::vector<TestLine> lines = CreateLines(next, count);
+        ring.Push(&lines, 0);
+        next += count;
+    }
+
+    std::vector<TestLine> tail;
+    ring.GetTail(1000, &tail);
+    CHECK(tail.size() == 5);
+    CHECK(ring.GetPushedCount() == (UINT64) next);
+
+    for (size_t index = 0; index < tail.size(); index++)
+    {
+        CHECK(*tail[index].layout == next - 1 - (int) index);
+    }
+}
+
+static void TestTailHeight()
+{
+    // The tail stops once the lines cover the height, including the one
+    // that crosses it
+    LineRing<TestLine> ring(100);
+    std::vector<TestLine> lines = CreateLines(0, 100, 12);
+    ring.Push(&lines, 0);
+
+    std::vector<TestLine> tail;
+    ring.GetTail(120, &tail);
+    CHECK(tail.size() == 10);
+
+    ring.GetTail(121, &tail);
+    CHECK(tail.size() == 11);
+    CHECK(*tail[0].layout == 99);
+
+    ring.GetTail(0, &tail);
+    CHECK(tail.empty());
+}
+
+static void TestSkipped()
+{
+    // Lines skipped by a batch larger than the ring count as pushed
+    LineRing<TestLine> ring(3);
+    std::vector<TestLine> lines = CreateLines(7, 3);
+    ring.Push(&lines, 7);
+
+    CHECK(ring.GetCount() == 3);
+    CHECK(ring.GetPushedCount() == 10);
+
+    // A capacity of zero keeps one line
+    LineRing<TestLine> single(0);
+    lines = CreateLines(0, 2);
+    single.Push(&lines, 0);
+    CHECK(single.GetCapacity() == 1);
+    CHECK(single.GetCount() == 1);
+    CHECK(*lines[1].layout == 0);
+}
+
+int main()
+{
+    TestFilling();
+    TestEviction();
+    TestWrapping();
+    TestTailHeight();
+    TestSkipped();
+
+    return ReportChecks();
+}
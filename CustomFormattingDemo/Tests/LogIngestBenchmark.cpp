@@ -0,0 +1,231 @@
+// Measures a live log at a sustained append rate while frames are drawn at
+// 60 fps, the way LogDocument and RenderLog share the lines: an ingest
+// thread lays out lines and pushes them in batches into a LineRing under a
+// lock, releasing the evicted ones after it, and the render thread reads
+// the tail that fills a 1920 x 1080 screen once per frame, records each
+// line and rasterizes it into a SoftwareRenderSink. StubLayout stands in
+// for the DirectWrite layouts, so laying out a line costs less than it
+// does in the app; Windows/LogIngestBenchmark measures LogDocument itself.
+//
+// Reports the append rate reached and the work time of the frames against
+// the 16.7 ms budget, for 10k lines per second and faster rates.
+#include "StubLayout.h"
+#include "LineRing.h"
+#include "SoftwareRenderSink.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+typedef std::chrono::steady_clock Clock;
+
+const UINT32 ScreenWidth = 1920;
+const UINT32 ScreenHeight = 1080;
+const size_t MaxLineCount = 100000;
+const double FrameSeconds = 1.0 / 60;
+
+struct StubLogLine
+{
+    std::shared_ptr<StubLayout> layout;
+    FLOAT                       height;
+};
+
+// LogDocument, with StubLayout lines
+class StubLog
+{
+public:
+    StubLog() :
+        m_lines(MaxLineCount)
+    {
+    }
+
+    void Append(UINT32 count, UINT32 firstLine)
+    {
+        std::vector<StubLogLine> lines(count);
+
+        // Laid out outside the lock; lines vary from 2 to 9 runs
+        for (UINT32 index = 0; index < count; index++)
+        {
+            UINT32 runCount = 2 + (firstLine + index) % 8;
+            lines[index].layout = std::make_shared<StubLayout>(
+                                    StubLayout::CreateParagraph(1, runCount, 6));
+            lines[index].height = lines[index].layout->GetHeight();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_lines.Push(&lines, 0);
+        }
+
+        // The evicted lines are released here, after the lock
+    }
+
+    void GetTail(FLOAT height, std::vector<StubLogLine> * lines) const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_lines.GetTail(height, lines);
+    }
+
+private:
+    mutable std::mutex    m_lock;
+    LineRing<StubLogLine> m_lines;
+};
+
+struct Result
+{
+    double appendRate;
+    double medianMilliseconds;
+    double p99Milliseconds;
+    double maxMilliseconds;
+    size_t frameCount;
+    size_t missedCount;
+    double linesPerFrame;
+};
+
+static Result Measure(double targetRate, double seconds)
+{
+    StubLog log;
+
+    // Fill the log first, so that evicting is part of every append
+    for (UINT32 line = 0; line < MaxLineCount; line += 1000)
+    {
+        log.Append(1000, line);
+    }
+
+    std::atomic<bool> isDone(false);
+    std::atomic<UINT64> appendedCount(0);
+    Clock::time_point start = Clock::now();
+
+    // Appends whatever is due every millisecond, as a tailed file would
+    std::thread ingest([&]()
+    {
+        while (!isDone)
+        {
+            double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            UINT64 due = (UINT64) (elapsed * targetRate);
+            UINT64 appended = appendedCount;
+
+            if (due > appended)
+            {
+                log.Append((UINT32) (due - appended), (UINT32) appended);
+                appendedCount = due;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    std::vector<UINT32> pixels(ScreenWidth * ScreenHeight);
+    SoftwareRenderSink sink;
+    sink.SetTarget(pixels.data(), ScreenWidth, ScreenHeight, ScreenWidth);
+
+    for (BrushIndex brush = 0; brush <= 6; brush++)
+    {
+        sink.SetBrushColor(brush, MakeColor(0.1f * brush, 0.5f, 1 - 0.1f * brush,
+                                            brush == 6 ? 0.35f : 1));
+    }
+
+    // Reused from frame to frame, as by the renderer
+    LayoutRecorder recorder;
+    DisplayList displayList;
+    std::vector<StubLogLine> tail;
+    std::vector<double> frameTimes;
+    size_t tailLineCount = 0;
+
+    Clock::time_point nextFrame = Clock::now();
+    Clock::time_point end = nextFrame + std::chrono::duration_cast<Clock::duration>(
+                                            std::chrono::duration<double>(seconds));
+
+    while (Clock::now() < end)
+    {
+        std::this_thread::sleep_until(nextFrame);
+        nextFrame += std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double>(FrameSeconds));
+
+        Clock::time_point frameStart = Clock::now();
+
+        sink.Clear(MakeColor(1, 1, 1));
+        log.GetTail((FLOAT) ScreenHeight, &tail);
+
+        FLOAT bottom = (FLOAT) ScreenHeight;
+
+        for (const StubLogLine & line : tail)
+        {
+            bottom -= line.height;
+            line.layout->Draw(&recorder, &displayList, MakePoint(0, bottom));
+            displayList.Replay(&sink);
+        }
+
+        tailLineCount += tail.size();
+        tail.clear();
+
+        frameTimes.push_back(std::chrono::duration<double>(Clock::now() - frameStart).count());
+
+        // A late frame skips the vsyncs it missed instead of catching up
+        Clock::time_point now = Clock::now();
+
+        while (nextFrame < now)
+        {
+            nextFrame += std::chrono::duration_cast<Clock::duration>(
+                            std::chrono::duration<double>(FrameSeconds));
+        }
+    }
+
+    isDone = true;
+    ingest.join();
+
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    Result result;
+    result.appendRate = appendedCount / elapsed;
+    result.frameCount = frameTimes.size();
+    result.missedCount = std::count_if(frameTimes.begin(), frameTimes.end(),
+                                       [](double time) { return time > FrameSeconds; });
+    result.linesPerFrame = (double) tailLineCount / frameTimes.size();
+
+    std::sort(frameTimes.begin(), frameTimes.end());
+    result.medianMilliseconds = 1000 * frameTimes[frameTimes.size() / 2];
+    result.p99Milliseconds = 1000 * frameTimes[frameTimes.size() * 99 / 100];
+    result.maxMilliseconds = 1000 * frameTimes.back();
+    return result;
+}
+
+int main(int argc, char ** argv)
+{
+    double seconds = argc > 1 ? std::atof(argv[1]) : 3;
+
+    double targetRates[] = { 10000, 30000, 100000 };
+    bool holds = true;
+
+    std::printf("%-10s %12s %8s %10s %10s %10s %8s %12s\n",
+                "target/s", "appended/s", "frames", "p50 ms", "p99 ms", "max ms",
+                "missed", "lines/frame");
+
+    for (double targetRate : targetRates)
+    {
+        Result result = Measure(targetRate, seconds);
+
+        std::printf("%-10.0f %12.0f %8u %10.2f %10.2f %10.2f %8u %12.1f\n",
+                    targetRate,
+                    result.appendRate,
+                    (unsigned int) result.frameCount,
+                    result.medianMilliseconds,
+                    result.p99Milliseconds,
+                    result.maxMilliseconds,
+                    (unsigned int) result.missedCount,
+                    result.linesPerFrame);
+
+        if (targetRate == 10000)
+        {
+            holds = result.appendRate >= 0.99 * targetRate &&
+                    result.p99Milliseconds < 1000 * FrameSeconds;
+        }
+    }
+
+    std::printf("\n10k lines/s at 60 fps: %s\n", holds ? "held" : "NOT held");
+    return 0;
+}
@@ -0,0 +1,112 @@
+// Measures the recording layer on synthetic paragraphs, through all three
+// passes: LayoutRecorder records the layout into a DisplayList, which is
+// replayed into a RecordingRenderSink. Reports glyph runs per second for
+// recording, replaying and both, with and without a clip.
+#include "StubLayout.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+typedef std::chrono::steady_clock Clock;
+
+struct Configuration
+{
+    const char * name;
+    UINT32       lineCount;
+    UINT32       runsPerLine;
+    UINT32       glyphsPerRun;
+    bool         isClipped;
+};
+
+enum class Phase
+{
+    Record,
+    Replay,
+    Both
+};
+
+// Runs per second of one phase, repeated for at least minSeconds
+static double Measure(StubLayout & layout,
+                      const RenderRect * clipRect,
+                      Phase phase,
+                      double minSeconds,
+                      UINT64 * commandCount)
+{
+    LayoutRecorder recorder;
+    DisplayList displayList;
+    RecordingRenderSink sink;
+
+    // Warm up the buffers, and record once for the replay phase
+    layout.Draw(&recorder, &displayList, MakePoint(0, 0), clipRect);
+    displayList.Replay(&sink);
+    *commandCount = sink.GetCommands().size();
+
+    UINT64 frameCount = 0;
+    double seconds = 0;
+    Clock::time_point start = Clock::now();
+
+    while (seconds < minSeconds)
+    {
+        for (int repeat = 0; repeat < 16; repeat++)
+        {
+            if (phase != Phase::Replay)
+            {
+                layout.Draw(&recorder, &displayList, MakePoint(0, 0), clipRect);
+            }
+
+            if (phase != Phase::Record)
+            {
+                sink.Clear();
+                displayList.Replay(&sink);
+            }
+        }
+
+        frameCount += 16;
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    return frameCount * layout.GetRunCount() / seconds;
+}
+
+int main(int argc, char ** argv)
+{
+    double minSeconds = argc > 1 ? std::atof(argv[1]) : 0.5;
+
+    Configuration configurations[] =
+    {
+        { "paragraph", 20, 8, 6, false },
+        { "document", 500, 8, 6, false },
+        { "long runs", 500, 2, 40, false },
+        { "document, clipped", 500, 8, 6, true }
+    };
+
+    std::printf("%-20s %8s %10s %14s %14s %14s\n",
+                "layout", "runs", "commands", "record runs/s", "replay runs/s", "both runs/s");
+
+    for (const Configuration & configuration : configurations)
+    {
+        StubLayout layout = StubLayout::CreateParagraph(configuration.lineCount,
+                                                        configuration.runsPerLine,
+                                                        configuration.glyphsPerRun);
+
+        // A screen of 1080 DIPs in the middle of the layout
+        float middle = layout.GetHeight() / 2;
+        RenderRect clipRect = MakeRect(0, middle - 540, 1920, middle + 540);
+        const RenderRect * clip = configuration.isClipped ? &clipRect : nullptr;
+
+        UINT64 commandCount;
+        double record = Measure(layout, clip, Phase::Record, minSeconds, &commandCount);
+        double replay = Measure(layout, clip, Phase::Replay, minSeconds, &commandCount);
+        double both = Measure(layout, clip, Phase::Both, minSeconds, &commandCount);
+
+        std::printf("%-20s %8u %10llu %14.3g %14.3g %14.3g\n",
+                    configuration.name,
+                    layout.GetRunCount(),
+                    (unsigned long long) commandCount,
+                    record,
+                    replay,
+                    both);
+    }
+
+    return 0;
+}
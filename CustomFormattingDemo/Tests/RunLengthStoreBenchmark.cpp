@@ -0,0 +1,191 @@
+// Formats documents of up to a million characters with random ranges, as
+// a syntax highlighter would, and compares RunLengthStore with a plain
+// array holding the formatting of each character. The array is the
+// simplest store that owns the formatting: setting a range costs its
+// length and reading a position is an index, but its memory grows with
+// the text and finding the runs costs the whole document.
+#include "RunLengthStore.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+struct Range
+{
+    uint32_t start;
+    uint32_t length;
+    int      value;
+};
+
+static double GetSeconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::vector<Range> MakeRanges(uint32_t documentLength, size_t count, unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<uint32_t> position(0, documentLength - 1);
+    std::uniform_int_distribution<uint32_t> length(1, 100);
+    std::uniform_int_distribution<int> value(1, 16);
+
+    std::vector<Range> ranges(count);
+
+    for (Range & range : ranges)
+    {
+        range.start = position(random);
+        range.length = std::min(length(random), documentLength - range.start);
+        range.value = value(random);
+    }
+
+    return ranges;
+}
+
+// Time to apply all the ranges, to query random positions, and to visit
+// the runs of the whole document once, as pushing it into a layout does
+struct Timings
+{
+    double setSeconds;
+    double getSeconds;
+    double runSeconds;
+    size_t runCount;
+    long long checksum;
+};
+
+static Timings MeasureStore(uint32_t documentLength,
+                            const std::vector<Range> & ranges,
+                            const std::vector<uint32_t> & probes)
+{
+    Timings timings;
+    RunLengthStore<int> store;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (const Range & range : ranges)
+    {
+        store.Set(range.start, range.length, range.value);
+    }
+
+    timings.setSeconds = GetSeconds(start);
+
+    start = std::chrono::steady_clock::now();
+    long long checksum = 0;
+
+    for (uint32_t probe : probes)
+    {
+        checksum += store.Get(probe);
+    }
+
+    timings.getSeconds = GetSeconds(start);
+
+    start = std::chrono::steady_clock::now();
+    size_t runCount = 0;
+
+    store.ForEachRun(0, documentLength, [&runCount, &checksum](uint32_t, uint32_t length, int value)
+    {
+        checksum += (long long) length * value;
+        runCount++;
+    });
+
+    timings.runSeconds = GetSeconds(start);
+    timings.runCount = runCount;
+    timings.checksum = checksum;
+    return timings;
+}
+
+static Timings MeasureArray(uint32_t documentLength,
+                            const std::vector<Range> & ranges,
+                            const std::vector<uint32_t> & probes)
+{
+    Timings timings;
+    std::vector<int> values(documentLength, 0);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (const Range & range : ranges)
+    {
+        std::fill(values.begin() + range.start,
+                  values.begin() + range.start + range.length,
+                  range.value);
+    }
+
+    timings.setSeconds = GetSeconds(start);
+
+    start = std::chrono::steady_clock::now();
+    long long checksum = 0;
+
+    for (uint32_t probe : probes)
+    {
+        checksum += values[probe];
+    }
+
+    timings.getSeconds = GetSeconds(start);
+
+    start = std::chrono::steady_clock::now();
+    size_t runCount = 0;
+    uint32_t runStart = 0;
+
+    for (uint32_t position = 1; position <= documentLength; position++)
+    {
+        if (position == documentLength || values[position] != values[runStart])
+        {
+            checksum += (long long) (position - runStart) * values[runStart];
+            runCount++;
+            runStart = position;
+        }
+    }
+
+    timings.runSeconds = GetSeconds(start);
+    timings.runCount = runCount;
+    timings.checksum = checksum;
+    return timings;
+}
+
+int main()
+{
+    const uint32_t DocumentLengths[] = { 10000, 100000, 1000000 };
+    const size_t ProbeCount = 100000;
+
+    std::printf("%10s %8s %7s | %10s %10s %10s | %10s %10s %10s\n",
+                "chars", "ranges", "runs",
+                "set ns", "get ns", "runs ms",
+                "array set", "array get", "array runs");
+
+    for (uint32_t documentLength : DocumentLengths)
+    {
+        // About one range per ten characters, like highlighted source code
+        std::vector<Range> ranges = MakeRanges(documentLength, documentLength / 10, 1);
+
+        std::mt19937 random(2);
+        std::uniform_int_distribution<uint32_t> position(0, documentLength - 1);
+        std::vector<uint32_t> probes(ProbeCount);
+
+        for (uint32_t & probe : probes)
+        {
+            probe = position(random);
+        }
+
+        Timings store = MeasureStore(documentLength, ranges, probes);
+        Timings array = MeasureArray(documentLength, ranges, probes);
+
+        if (store.checksum != array.checksum || store.runCount != array.runCount)
+        {
+            std::printf("Store and array disagree\n");
+            return 1;
+        }
+
+        std::printf("%10u %8zu %7zu | %10.1f %10.1f %10.3f | %10.1f %10.1f %10.3f\n",
+                    documentLength,
+                    ranges.size(),
+                    store.runCount,
+                    store.setSeconds * 1e9 / ranges.size(),
+                    store.getSeconds * 1e9 / probes.size(),
+                    store.runSeconds * 1e3,
+                    array.setSeconds * 1e9 / ranges.size(),
+                    array.getSeconds * 1e9 / probes.size(),
+                    array.runSeconds * 1e3);
+    }
+
+    return 0;
+}
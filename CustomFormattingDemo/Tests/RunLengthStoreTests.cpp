@@ -0,0 +1,215 @@
+// Checks RunLengthStore against a plain array with one value per
+// position, with hand-written cases and random operations.
+#include "RunLengthStore.h"
+#include "Check.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// The runs of a range, as visited by ForEachRun
+struct Run
+{
+    uint32_t start;
+    uint32_t length;
+    int      value;
+};
+
+static std::vector<Run> GetRuns(const RunLengthStore<int> & store,
+                                uint32_t start,
+                                uint32_t length)
+{
+    std::vector<Run> runs;
+
+    store.ForEachRun(start, length, [&runs](uint32_t runStart, uint32_t runLength, int value)
+    {
+        Run run = { runStart, runLength, value };
+        runs.push_back(run);
+    });
+
+    return runs;
+}
+
+static void TestDefault()
+{
+    RunLengthStore<int> store(7);
+
+    CHECK(store.GetRunCount() == 1);
+    CHECK(store.Get(0) == 7);
+    CHECK(store.Get(RunLengthStore<int>::MaxPosition - 1) == 7);
+
+    uint32_t runStart, runLength;
+    store.Get(12345, &runStart, &runLength);
+    CHECK(runStart == 0);
+    CHECK(runLength == RunLengthStore<int>::MaxPosition);
+}
+
+static void TestSetAndMerge()
+{
+    RunLengthStore<int> store;
+
+    store.Set(10, 5, 1);
+    CHECK(store.GetRunCount() == 3);
+    CHECK(store.Get(9) == 0);
+    CHECK(store.Get(10) == 1);
+    CHECK(store.Get(14) == 1);
+    CHECK(store.Get(15) == 0);
+
+    // Adjacent runs with the same value become one
+    store.Set(15, 5, 1);
+    CHECK(store.GetRunCount() == 3);
+
+    uint32_t runStart, runLength;
+    store.Get(17, &runStart, &runLength);
+    CHECK(runStart == 10);
+    CHECK(runLength == 10);
+
+    // Setting the default value back removes the runs
+    store.Set(0, 100, 0);
+    CHECK(store.GetRunCount() == 1);
+
+    // Empty ranges change nothing
+    store.Set(50, 0, 3);
+    CHECK(store.GetRunCount() == 1);
+
+    // Ranges past the last position are clipped
+    store.Set(RunLengthStore<int>::MaxPosition - 2, 100, 4);
+    CHECK(store.Get(RunLengthStore<int>::MaxPosition - 1) == 4);
+    CHECK(store.GetRunCount() == 2);
+
+    store.Clear();
+    CHECK(store.GetRunCount() == 1);
+    CHECK(store.Get(RunLengthStore<int>::MaxPosition - 1) == 0);
+}
+
+static void TestUpdate()
+{
+    RunLengthStore<int> store;
+    store.Set(0, 10, 1);
+    store.Set(10, 10, 2);
+    store.Set(20, 10, 3);
+
+    // Called once per run of the range, split at its ends
+    int callCount = 0;
+    store.Update(5, 20, [&callCount](int & value)
+    {
+        value *= 10;
+        callCount++;
+    });
+
+    CHECK(callCount == 3);
+    CHECK(store.Get(4) == 1);
+    CHECK(store.Get(5) == 10);
+    CHECK(store.Get(10) == 20);
+    CHECK(store.Get(24) == 30);
+    CHECK(store.Get(25) == 3);
+
+    // Runs that become equal are merged
+    store.Update(0, 30, [](int & value)
+    {
+        value = 5;
+    });
+
+    CHECK(store.GetRunCount() == 2);
+}
+
+static void TestForEachRun()
+{
+    RunLengthStore<int> store;
+    store.Set(10, 10, 1);
+    store.Set(20, 10, 2);
+
+    // Runs are clipped to the range
+    std::vector<Run> runs = GetRuns(store, 15, 10);
+    CHECK(runs.size() == 2);
+    CHECK(runs[0].start == 15 && runs[0].length == 5 && runs[0].value == 1);
+    CHECK(runs[1].start == 20 && runs[1].length == 5 && runs[1].value == 2);
+
+    runs = GetRuns(store, 0, 40);
+    CHECK(runs.size() == 4);
+    CHECK(runs[3].start == 30 && runs[3].length == 10 && runs[3].value == 0);
+
+    CHECK(GetRuns(store, 12, 0).empty());
+}
+
+// Random sets and updates, checked after each operation against an array
+static void TestRandomOperations()
+{
+    const uint32_t Length = 2000;
+    const int OperationCount = 20000;
+
+    std::mt19937 random(12345);
+    std::uniform_int_distribution<uint32_t> position(0, Length - 1);
+    std::uniform_int_distribution<uint32_t> length(0, 200);
+    std::uniform_int_distribution<int> value(0, 4);
+
+    RunLengthStore<int> store;
+    std::vector<int> reference(Length, 0);
+
+    for (int operation = 0; operation < OperationCount && GetFailureCount() == 0; operation++)
+    {
+        uint32_t start = position(random);
+        uint32_t end = std::min(Length, start + length(random));
+        int newValue = value(random);
+
+        if (operation % 3 == 0)
+        {
+            store.Update(start, end - start, [newValue](int & current)
+            {
+                current = (current + newValue) % 5;
+            });
+
+            for (uint32_t index = start; index < end; index++)
+            {
+                reference[index] = (reference[index] + newValue) % 5;
+            }
+        }
+        else
+        {
+            store.Set(start, end - start, newValue);
+
+            for (uint32_t index = start; index < end; index++)
+            {
+                reference[index] = newValue;
+            }
+        }
+
+        // The runs cover the array exactly, and neighbours always differ
+        std::vector<Run> runs = GetRuns(store, 0, Length);
+        uint32_t expectedStart = 0;
+
+        for (size_t index = 0; index < runs.size(); index++)
+        {
+            const Run & run = runs[index];
+            CHECK(run.start == expectedStart);
+            CHECK(run.length > 0);
+
+            for (uint32_t offset = 0; offset < run.length; offset++)
+            {
+                CHECK(reference[run.start + offset] == run.value);
+            }
+
+            if (index > 0)
+            {
+                CHECK(runs[index - 1].value != run.value);
+            }
+
+            expectedStart = run.start + run.length;
+        }
+
+        CHECK(expectedStart == Length);
+
+        uint32_t probe = position(random);
+        CHECK(store.Get(probe) == reference[probe]);
+    }
+}
+
+int main()
+{
+    TestDefault();
+    TestSetAndMerge();
+    TestUpdate();
+    TestForEachRun();
+    TestRandomOperations();
+
+    return ReportChecks();
+}
@@ -0,0 +1,139 @@
+// Measures SoftwareRenderSink in megapixels per second on a 1920 x 1080
+// target, with the SIMD span blending and with the scalar reference:
+// opaque backgrounds, translucent highlights, and pages of a synthetic
+// document with every kind of background and decoration.
+#include "StubLayout.h"
+#include "SoftwareRenderSink.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+typedef std::chrono::steady_clock Clock;
+
+const UINT32 TargetWidth = 1920;
+const UINT32 TargetHeight = 1080;
+
+enum class Scene
+{
+    OpaqueFills,
+    Highlights,
+    Page
+};
+
+// Rectangles of a few lines of text each, at fractional positions
+static std::vector<RenderRect> CreateRectangles()
+{
+    std::mt19937 random(4);
+    std::uniform_real_distribution<float> x(0, TargetWidth - 400);
+    std::uniform_real_distribution<float> y(0, TargetHeight - 60);
+    std::uniform_real_distribution<float> width(20, 400);
+    std::uniform_real_distribution<float> height(16, 60);
+
+    std::vector<RenderRect> rects(200);
+
+    for (RenderRect & rect : rects)
+    {
+        float left = x(random);
+        float top = y(random);
+        rect = MakeRect(left, top, left + width(random), top + height(random));
+    }
+
+    return rects;
+}
+
+static void SetColors(SoftwareRenderSink * sink)
+{
+    sink->SetBrushColor(NoBrush, MakeColor(0, 0, 0));
+    sink->SetBrushColor(1, MakeColor(0.8f, 0.1f, 0.1f));
+    sink->SetBrushColor(2, MakeColor(0.1f, 0.5f, 0.1f));
+    sink->SetBrushColor(3, MakeColor(0.2f, 0.2f, 0.9f));
+    sink->SetBrushColor(4, MakeColor(0.9f, 0.9f, 0.6f));
+    sink->SetBrushColor(5, MakeColor(1, 0, 0));
+
+    // Highlights are translucent
+    sink->SetBrushColor(6, MakeColor(1, 1, 0, 0.35f));
+}
+
+// Megapixels per second of one scene, drawn for at least minSeconds
+static double Measure(Scene scene,
+                      const std::vector<RenderRect> & rects,
+                      const DisplayList & page,
+                      bool isScalarReference,
+                      double minSeconds)
+{
+    std::vector<UINT32> pixels(TargetWidth * TargetHeight, 0xFFFFFFFFu);
+
+    SoftwareRenderSink sink;
+    sink.SetTarget(pixels.data(), TargetWidth, TargetHeight, TargetWidth);
+    sink.SetScalarReference(isScalarReference);
+    SetColors(&sink);
+
+    double seconds = 0;
+    Clock::time_point start = Clock::now();
+
+    while (seconds < minSeconds)
+    {
+        switch (scene)
+        {
+        case Scene::OpaqueFills:
+            for (const RenderRect & rect : rects)
+            {
+                sink.FillRectangle(rect, 4);
+            }
+            break;
+
+        case Scene::Highlights:
+            for (const RenderRect & rect : rects)
+            {
+                sink.FillRectangle(rect, 6);
+            }
+            break;
+
+        case Scene::Page:
+            page.Replay(&sink);
+            break;
+        }
+
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    return sink.GetPixelCount() / seconds / 1e6;
+}
+
+int main(int argc, char ** argv)
+{
+    double minSeconds = argc > 1 ? std::atof(argv[1]) : 0.5;
+
+    std::vector<RenderRect> rects = CreateRectangles();
+
+    // A page of 54 lines of 8 runs, at 96 DPI
+    StubLayout layout = StubLayout::CreateParagraph(54, 8, 12);
+    LayoutRecorder recorder;
+    DisplayList page;
+    layout.Draw(&recorder, &page, MakePoint(8.5f, 0.25f));
+
+    struct
+    {
+        const char * name;
+        Scene        scene;
+    }
+    scenes[] =
+    {
+        { "opaque fills", Scene::OpaqueFills },
+        { "highlights", Scene::Highlights },
+        { "page", Scene::Page }
+    };
+
+    std::printf("%-14s %12s %12s %8s\n", "scene", "SIMD MP/s", "scalar MP/s", "speedup");
+
+    for (auto & scene : scenes)
+    {
+        double simd = Measure(scene.scene, rects, page, false, minSeconds);
+        double scalar = Measure(scene.scene, rects, page, true, minSeconds);
+
+        std::printf("%-14s %12.1f %12.1f %7.2fx\n", scene.name, simd, scalar, simd / scalar);
+    }
+
+    return 0;
+}
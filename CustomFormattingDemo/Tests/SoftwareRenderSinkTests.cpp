@@ -0,0 +1,195 @@
+// Checks the pixels written by SoftwareRenderSink: opaque fills, coverage
+// on fractional edges, the world-to-pixel transform, squiggles, brushes
+// without a color, and that the SIMD blending matches the scalar reference.
+#include "StubLayout.h"
+#include "SoftwareRenderSink.h"
+#include "Check.h"
+#include <cstdlib>
+
+static UINT32 GetChannel(UINT32 pixel, int channel)
+{
+    return (pixel >> (8 * channel)) & 0xFF;
+}
+
+static void TestOpaqueFill()
+{
+    std::vector<UINT32> pixels(8 * 4);
+    SoftwareRenderSink sink;
+    sink.SetTarget(pixels.data(), 8, 4, 8);
+    sink.Clear(MakeColor(0, 0, 0, 0));
+    sink.SetBrushColor(1, MakeColor(1, 0, 0));
+
+    sink.FillRectangle(MakeRect(1, 1, 5, 3), 1);
+
+    for (UINT32 y = 0; y < 4; y++)
+    {
+        for (UINT32 x = 0; x < 8; x++)
+        {
+            bool isInside = x >= 1 && x < 5 && y >= 1 && y < 3;
+            CHECK(pixels[y * 8 + x] == (isInside ? 0xFF0000FFu : 0u));
+        }
+    }
+
+    CHECK(sink.GetPixelCount() == 8 * 4 + 4 * 2);
+}
+
+static void TestEdgeCoverage()
+{
+    // Half a pixel on each side, over opaque white
+    std::vector<UINT32> pixels(4);
+    SoftwareRenderSink sink;
+    sink.SetTarget(pixels.data(), 4, 1, 4);
+    sink.Clear(MakeColor(1, 1, 1));
+    sink.SetBrushColor(1, MakeColor(0, 0, 0));
+
+    sink.FillRectangle(MakeRect(0.5f, 0, 2.5f, 1), 1);
+
+    CHECK(GetChannel(pixels[0], 0) == 128 && GetChannel(pixels[0], 3) == 255);
+    CHECK(pixels[1] == 0xFF000000u);
+    CHECK(GetChannel(pixels[2], 0) == 128);
+    CHECK(pixels[3] == 0xFFFFFFFFu);
+}
+
+static void TestTransform()
+{
+    // Pixel snapping happens in pixels, after the transform
+    std::vector<UINT32> pixels(8);
+    SoftwareRenderSink sink;
+    sink.SetTarget(pixels.data(), 8, 1, 8);
+    sink.Clear(MakeColor(0, 0, 0, 0));
+    sink.SetBrushColor(1, MakeColor(0, 0, 1));
+    sink.SetTransform(RenderMatrix::Scale(2, 2) * RenderMatrix::Translation(1, 0));
+
+    sink.FillRectangle(MakeRect(1, 0, 2, 1), 1);
+
+    for (UINT32 x = 0; x < 8; x++)
+    {
+        CHECK(pixels[x] == (x >= 3 && x < 5 ? 0xFFFF0000u : 0u));
+    }
+}
+
+static void TestMissingColor()
+{
+    std::vector<UINT32> pixels(4);
+    SoftwareRenderSink sink;
+    sink.SetTarget(pixels.data(), 4, 1, 4);
+    sink.SetBrushColor(2, MakeColor(1, 1, 1));
+
+    sink.FillRectangle(MakeRect(0, 0, 4, 1), NoBrush);
+    sink.FillRectangle(MakeRect(0, 0, 4, 1), 1);
+    sink.FillRectangle(MakeRect(0, 0, 4, 1), 9);
+
+    CHECK(sink.GetPixelCount() == 0);
+    CHECK(pixels[0] == 0 && pixels[3] == 0);
+}
+
+static void TestSquiggly()
+{
+    // The stroke stays within the amplitude plus half its width
+    const UINT32 width = 64;
+    const UINT32 height = 16;
+    std::vector<UINT32> pixels(width * height);
+    SoftwareRenderSink sink;
+    sink.SetTarget(pixels.data(), width, height, width);
+    sink.SetBrushColor(NoBrush, MakeColor(0, 0, 0));
+
+    SquigglyLine squiggly = { 1, 40, 0, 1 };
+    sink.DrawSquiggly(MakePoint(10, 8), squiggly, NoBrush);
+
+    UINT32 paintedCount = 0;
+
+    for (UINT32 y = 0; y < height; y++)
+    {
+        for (UINT32 x = 0; x < width; x++)
+        {
+            if (pixels[y * width + x] != 0)
+            {
+                paintedCount++;
+                CHECK(y >= 8 - 3 && y <= 8 + 2);
+                CHECK(x >= 10 - 2 && x <= 50 + 1);
+            }
+        }
+    }
+
+    CHECK(paintedCount >= 40);
+    CHECK(sink.GetPixelCount() == paintedCount);
+}
+
+// Replays a recorded paragraph with translucent colors over a noisy
+// background
+static std::vector<UINT32> Render(const DisplayList & displayList,
+                                  UINT32 width,
+                                  UINT32 height,
+                                  bool isScalarReference)
+{
+    std::vector<UINT32> pixels(width * height);
+    std::srand(3);
+
+    for (UINT32 & pixel : pixels)
+    {
+        // Opaque, so that the pixels are valid premultiplied colors
+        pixel = 0xFF000000u | (UINT32) (std::rand() & 0xFFFFFF);
+    }
+
+    SoftwareRenderSink sink;
+    sink.SetTarget(pixels.data(), width, height, width);
+    sink.SetTransform(RenderMatrix::Scale(1.25f, 1.25f));
+    sink.SetScalarReference(isScalarReference);
+
+    sink.SetBrushColor(NoBrush, MakeColor(0, 0, 0));
+    sink.SetBrushColor(1, MakeColor(0.8f, 0.1f, 0.1f));
+    sink.SetBrushColor(2, MakeColor(0.1f, 0.5f, 0.1f, 0.7f));
+    sink.SetBrushColor(3, MakeColor(0.2f, 0.2f, 0.9f));
+    sink.SetBrushColor(4, MakeColor(0.9f, 0.9f, 0.6f, 0.5f));
+    sink.SetBrushColor(5, MakeColor(1, 0, 0, 0.9f));
+    sink.SetBrushColor(6, MakeColor(1, 1, 0, 0.35f));
+
+    displayList.Replay(&sink);
+    return pixels;
+}
+
+static void TestSimdMatchesScalar()
+{
+    // An odd width, so that rows end with partial groups of four
+    const UINT32 width = 203;
+    const UINT32 height = 160;
+
+    StubLayout layout = StubLayout::CreateParagraph(6, 4, 5);
+    LayoutRecorder recorder;
+    DisplayList displayList;
+    CHECK(layout.Draw(&recorder, &displayList, MakePoint(1.5f, 2.25f)) == S_OK);
+
+    std::vector<UINT32> simd = Render(displayList, width, height, false);
+    std::vector<UINT32> scalar = Render(displayList, width, height, true);
+
+    UINT32 differentCount = 0;
+    UINT32 maxDifference = 0;
+
+    for (size_t index = 0; index < simd.size(); index++)
+    {
+        for (int channel = 0; channel < 4; channel++)
+        {
+            int difference = (int) GetChannel(simd[index], channel) -
+                             (int) GetChannel(scalar[index], channel);
+
+            maxDifference = max(maxDifference, (UINT32) std::abs(difference));
+            differentCount += difference != 0;
+        }
+    }
+
+    // Only rounding may differ
+    CHECK(maxDifference <= 1);
+    CHECK(differentCount < simd.size() / 100);
+}
+
+int main()
+{
+    TestOpaqueFill();
+    TestEdgeCoverage();
+    TestTransform();
+    TestMissingColor();
+    TestSquiggly();
+    TestSimdMatchesScalar();
+
+    return ReportChecks();
+}
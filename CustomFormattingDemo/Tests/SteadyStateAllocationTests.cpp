@@ -0,0 +1,196 @@
+// Checks that steady-state frames make no heap allocations. The global
+// operator new of this executable counts every allocation; frames are drawn
+// the way CharacterFormatter::Draw does, with a pooled LayoutRecorder and
+// DisplayList, and replayed into a sink. Once a frame has warmed up the
+// buffers, repeating it must not allocate. SquigglyGeometryCache and
+// FontMetricsCache need Direct2D and DirectWrite, so they are not covered.
+#include "StubLayout.h"
+#include "ObjectPool.h"
+#include "Check.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<size_t> s_allocationCount(0);
+
+void * operator new(size_t size)
+{
+    s_allocationCount++;
+
+    void * p = std::malloc(size != 0 ? size : 1);
+
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    return p;
+}
+
+void * operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void * operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    s_allocationCount++;
+    return std::malloc(size != 0 ? size : 1);
+}
+
+void * operator new[](size_t size, const std::nothrow_t & tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void * p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void * p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void * p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void * p, size_t) noexcept
+{
+    std::free(p);
+}
+
+// The scratch storage of CharacterFormatter, and the sink of the frame
+class Frame
+{
+public:
+    void Draw(StubLayout & layout, const RenderRect * clipRect = nullptr)
+    {
+        ObjectPool<LayoutRecorder>::Handle recorder = m_recorderPool.Acquire();
+        ObjectPool<DisplayList>::Handle displayList = m_displayListPool.Acquire();
+
+        CHECK(layout.Draw(recorder.Get(), displayList.Get(), MakePoint(0, 0), clipRect) == S_OK);
+
+        m_sink.Clear();
+        displayList->Replay(&m_sink);
+        displayList->Clear();
+    }
+
+    // Allocations made by a call of Draw
+    size_t CountAllocations(StubLayout & layout, const RenderRect * clipRect = nullptr)
+    {
+        size_t count = s_allocationCount;
+        Draw(layout, clipRect);
+        return s_allocationCount - count;
+    }
+
+    const RecordingRenderSink & GetSink() const { return m_sink; }
+
+private:
+    ObjectPool<LayoutRecorder> m_recorderPool;
+    ObjectPool<DisplayList>    m_displayListPool;
+    RecordingRenderSink        m_sink;
+};
+
+static void TestCounting()
+{
+    // The first frame creates the pooled objects and grows their buffers;
+    // if it did not count, the other tests would prove nothing
+    StubLayout layout = StubLayout::CreateParagraph(20, 8, 6);
+    Frame frame;
+
+    CHECK(frame.CountAllocations(layout) > 0);
+    CHECK(!frame.GetSink().GetCommands().empty());
+}
+
+static void TestRepeatedFrame()
+{
+    StubLayout layout = StubLayout::CreateParagraph(200, 8, 6);
+    Frame frame;
+    frame.Draw(layout);
+
+    for (int repeat = 0; repeat < 100; repeat++)
+    {
+        size_t count = frame.CountAllocations(layout);
+
+        if (count != 0)
+        {
+            std::printf("frame %d: %u allocations\n", repeat, (UINT32) count);
+            CHECK(count == 0);
+            break;
+        }
+    }
+}
+
+static void TestScrolling()
+{
+    // Once the whole layout has been drawn, and one clipped frame has sized
+    // the line tops used for culling, no part of it allocates
+    StubLayout layout = StubLayout::CreateParagraph(200, 8, 6);
+    RenderRect firstClipRect = MakeRect(0, 0, 1920, 1080);
+    Frame frame;
+    frame.Draw(layout);
+    frame.Draw(layout, &firstClipRect);
+
+    for (float top = 0; top < layout.GetHeight(); top += 37)
+    {
+        RenderRect clipRect = MakeRect(0, top, 1920, top + 1080);
+        size_t count = frame.CountAllocations(layout, &clipRect);
+
+        if (count != 0)
+        {
+            std::printf("scrolled to %g: %u allocations\n", top, (UINT32) count);
+            CHECK(count == 0);
+            break;
+        }
+    }
+}
+
+static void TestSmallerLayout()
+{
+    // A layout that fits the buffers of a larger one does not allocate
+    StubLayout large = StubLayout::CreateParagraph(100, 8, 6);
+    StubLayout small = StubLayout::CreateParagraph(10, 4, 12);
+    Frame frame;
+    frame.Draw(large);
+
+    CHECK(frame.CountAllocations(small) == 0);
+    CHECK(frame.CountAllocations(large) == 0);
+}
+
+static void TestRetainedReplay()
+{
+    // Replaying a retained list allocates nothing once the sink has grown
+    StubLayout layout = StubLayout::CreateParagraph(100, 8, 6);
+    LayoutRecorder recorder;
+    DisplayList displayList;
+    RecordingRenderSink sink;
+
+    CHECK(layout.Draw(&recorder, &displayList, MakePoint(0, 0)) == S_OK);
+    displayList.Replay(&sink);
+
+    size_t count = s_allocationCount;
+
+    for (int repeat = 0; repeat < 100; repeat++)
+    {
+        sink.Clear();
+        displayList.Replay(&sink);
+    }
+
+    CHECK(s_allocationCount == count);
+}
+
+int main()
+{
+    TestCounting();
+    TestRepeatedFrame();
+    TestScrolling();
+    TestSmallerLayout();
+    TestRetainedReplay();
+
+    return ReportChecks();
+}
@@ -0,0 +1,122 @@
+// Checks BasicStepTimer driven by a VirtualClock: the catch-up updates of
+// the fixed timestep, the clamp of large time deltas, and the frame count
+// and frame rate after one virtual second.
+#include "StepTimer.h"
+#include "Check.h"
+
+typedef DX::BasicStepTimer<DX::VirtualClock> VirtualStepTimer;
+
+// 1/60 of a second, the default fixed timestep
+const uint64_t StepTicks = VirtualStepTimer::TicksPerSecond / 60;
+
+static void TestFixedStepCatchUp()
+{
+    VirtualStepTimer timer;
+    timer.SetFixedTimeStep(true);
+
+    int updateCount = 0;
+    auto update = [&]() { updateCount++; };
+
+    // A late frame runs one update per step it missed, and carries the rest
+    timer.GetClock().Advance(3 * StepTicks + 10000);
+    timer.Tick(update);
+
+    CHECK(updateCount == 3);
+    CHECK(timer.GetFrameCount() == 3);
+    CHECK(timer.GetElapsedTicks() == StepTicks);
+    CHECK(timer.GetTotalTicks() == 3 * StepTicks);
+
+    // Less than a step: no update
+    timer.GetClock().Advance(StepTicks / 2);
+    timer.Tick(update);
+
+    CHECK(updateCount == 3);
+    CHECK(timer.GetFrameCount() == 3);
+
+    // The carried time completes the next step
+    timer.GetClock().Advance(StepTicks / 2);
+    timer.Tick(update);
+
+    CHECK(updateCount == 4);
+    CHECK(timer.GetTotalTicks() == 4 * StepTicks);
+
+    // Within a quarter of a millisecond of the step is taken as the step
+    timer.ResetElapsedTime();
+    timer.GetClock().Advance(StepTicks + 2000);
+    timer.Tick(update);
+
+    CHECK(updateCount == 5);
+    timer.GetClock().Advance(StepTicks - 2000);
+    timer.Tick(update);
+
+    CHECK(updateCount == 6);
+    CHECK(timer.GetTotalTicks() == 6 * StepTicks);
+}
+
+static void TestMaxDeltaClamp()
+{
+    // A pause of five seconds counts as a tenth of a second
+    VirtualStepTimer timer;
+    timer.GetClock().AdvanceSeconds(5);
+    timer.Tick([]() {});
+
+    CHECK(timer.GetFrameCount() == 1);
+    CHECK(timer.GetElapsedTicks() == VirtualStepTimer::TicksPerSecond / 10);
+    CHECK(timer.GetTotalTicks() == VirtualStepTimer::TicksPerSecond / 10);
+
+    // So the fixed timestep catches up by six steps, not three hundred
+    VirtualStepTimer fixedTimer;
+    fixedTimer.SetFixedTimeStep(true);
+    fixedTimer.GetClock().AdvanceSeconds(5);
+
+    int updateCount = 0;
+    fixedTimer.Tick([&]() { updateCount++; });
+
+    CHECK(updateCount == 6);
+    CHECK(fixedTimer.GetTotalTicks() == 6 * StepTicks);
+}
+
+static void TestFramesPerSecond()
+{
+    VirtualStepTimer timer;
+
+    // The rate is reported once a whole second has elapsed
+    for (int frame = 0; frame < 59; frame++)
+    {
+        timer.GetClock().Advance(StepTicks + 1);
+        timer.Tick([]() {});
+    }
+
+    CHECK(timer.GetFrameCount() == 59);
+    CHECK(timer.GetFramesPerSecond() == 0);
+
+    timer.GetClock().Advance(StepTicks + 1);
+    timer.Tick([]() {});
+
+    CHECK(timer.GetFrameCount() == 60);
+    CHECK(timer.GetFramesPerSecond() == 60);
+    CHECK(timer.GetTotalTicks() == 60 * (StepTicks + 1));
+
+    // A fixed timestep of 30 Hz over one second at 60 Hz updates 30 times
+    VirtualStepTimer fixedTimer;
+    fixedTimer.SetFixedTimeStep(true);
+    fixedTimer.SetTargetElapsedSeconds(1.0 / 30);
+
+    for (int frame = 0; frame < 60; frame++)
+    {
+        fixedTimer.GetClock().Advance(StepTicks + 1);
+        fixedTimer.Tick([]() {});
+    }
+
+    CHECK(fixedTimer.GetFrameCount() == 30);
+    CHECK(fixedTimer.GetFramesPerSecond() == 30);
+}
+
+int main()
+{
+    TestFixedStepCatchUp();
+    TestMaxDeltaClamp();
+    TestFramesPerSecond();
+
+    return ReportChecks();
+}
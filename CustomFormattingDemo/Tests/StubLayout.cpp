@@ -0,0 +1,234 @@
+#include "StubLayout.h"
+
+const float StubLayout::EmSize = 16;
+
+StubLayout::FontFace StubLayout::s_fontFace;
+FontMetricsCache StubLayout::s_fontMetrics;
+
+void StubLayout::FontFace::GetMetrics(DWRITE_FONT_METRICS * fontFaceMetrics)
+{
+    *fontFaceMetrics = DWRITE_FONT_METRICS();
+    fontFaceMetrics->designUnitsPerEm = 2000;
+    fontFaceMetrics->ascent = 1800;
+    fontFaceMetrics->descent = 500;
+    fontFaceMetrics->lineGap = 200;
+}
+
+StubLayout::StubLayout() :
+    m_textRunCount(0)
+{
+}
+
+void StubLayout::AddLine(float height, float baseline)
+{
+    DWRITE_LINE_METRICS lineMetrics = {};
+    lineMetrics.height = height;
+    lineMetrics.baseline = baseline;
+
+    m_lineMetrics.push_back(lineMetrics);
+}
+
+void StubLayout::AddRun(UINT32 glyphCount, float advance, const FormatValues * format)
+{
+    DWRITE_LINE_METRICS & lineMetrics = m_lineMetrics.back();
+    UINT32 line = (UINT32) m_lineMetrics.size() - 1;
+
+    Run run;
+    run.line = line;
+    run.x = 0;
+    run.width = glyphCount * advance;
+    run.firstGlyph = (UINT32) m_glyphIndices.size();
+    run.glyphCount = glyphCount;
+    run.hasFormat = format != nullptr;
+    run.format = format != nullptr ? *format : FormatValues();
+
+    if (!m_runs.empty() && m_runs.back().line == line)
+    {
+        run.x = m_runs.back().x + m_runs.back().width;
+    }
+
+    for (UINT32 glyph = 0; glyph < glyphCount; glyph++)
+    {
+        m_glyphIndices.push_back((UINT16) (glyph % 64 + 3));
+        m_glyphAdvances.push_back(advance);
+    }
+
+    m_runs.push_back(run);
+    lineMetrics.length += glyphCount;
+    m_textRunCount++;
+}
+
+void StubLayout::AddTrailingSpace(float advance, const FormatValues * format)
+{
+    AddRun(1, advance, format);
+
+    m_lineMetrics.back().trailingWhitespaceLength++;
+    m_textRunCount--;
+}
+
+StubLayout StubLayout::CreateParagraph(UINT32 lineCount,
+                                       UINT32 runsPerLine,
+                                       UINT32 glyphsPerRun)
+{
+    // Brushes 1 to 6 of a palette
+    FormatValues formats[8];
+
+    formats[1].foregroundBrush = 1;
+
+    formats[2].foregroundBrush = 1;
+    formats[2].underlineType = UnderlineType::Single;
+    formats[2].underlineBrush = 3;
+
+    formats[3].foregroundBrush = 2;
+    formats[3].underlineType = UnderlineType::Single;
+    formats[3].underlineBrush = 3;
+
+    formats[4].backgroundBrush = 4;
+    formats[4].backgroundMode = BackgroundMode::TextHeight;
+
+    formats[5].underlineType = UnderlineType::Squiggly;
+    formats[5].underlineBrush = 5;
+
+    formats[6].strikethroughCount = 1;
+    formats[6].highlightBrush = 6;
+
+    formats[7].foregroundBrush = 2;
+    formats[7].underlineType = UnderlineType::Double;
+    formats[7].hasOverline = true;
+
+    StubLayout layout;
+
+    for (UINT32 line = 0; line < lineCount; line++)
+    {
+        layout.AddLine(EmSize * 1.25f, EmSize);
+
+        for (UINT32 run = 0; run < runsPerLine; run++)
+        {
+            // Runs without formatting are format 0
+            UINT32 index = (line * runsPerLine + run) % 8;
+            layout.AddRun(glyphsPerRun, EmSize / 2, index != 0 ? &formats[index] : nullptr);
+        }
+
+        layout.AddTrailingSpace(EmSize / 4, nullptr);
+    }
+
+    return layout;
+}
+
+float StubLayout::GetHeight() const
+{
+    float height = 0;
+
+    for (const DWRITE_LINE_METRICS & lineMetrics : m_lineMetrics)
+    {
+        height += lineMetrics.height;
+    }
+
+    return height;
+}
+
+HRESULT StubLayout::Draw(LayoutRecorder * recorder,
+                         DisplayList * displayList,
+                         RenderPoint origin,
+                         const RenderRect * clipRect,
+                         const RenderMatrix & transform,
+                         float dpi)
+{
+    HRESULT hr;
+
+    recorder->Begin(displayList,
+                    &s_fontMetrics,
+                    m_lineMetrics.data(),
+                    (UINT32) m_lineMetrics.size(),
+                    origin,
+                    clipRect);
+
+    recorder->SetTransform(transform, dpi, dpi);
+
+    float top = origin.y;
+    size_t first = 0;
+
+    for (UINT32 line = 0; line < m_lineMetrics.size(); line++)
+    {
+        float baselineY = top + m_lineMetrics[line].baseline;
+        size_t end = first;
+
+        while (end < m_runs.size() && m_runs[end].line == line)
+        {
+            end++;
+        }
+
+        // Glyph runs
+        for (size_t index = first; index < end; index++)
+        {
+            const Run & run = m_runs[index];
+
+            DWRITE_GLYPH_RUN glyphRun = {};
+            glyphRun.fontFace = &s_fontFace;
+            glyphRun.fontEmSize = EmSize;
+            glyphRun.glyphCount = run.glyphCount;
+            glyphRun.glyphIndices = m_glyphIndices.data() + run.firstGlyph;
+            glyphRun.glyphAdvances = m_glyphAdvances.data() + run.firstGlyph;
+
+            if (S_OK != (hr = recorder->DrawGlyphRun(MakePoint(origin.x + run.x, baselineY),
+                                                     DWRITE_MEASURING_MODE_NATURAL,
+                                                     &glyphRun,
+                                                     run.glyphCount,
+                                                     run.hasFormat ? &run.format : nullptr)))
+            {
+                return hr;
+            }
+        }
+
+        // Underlines, for the runs that have an underline or an overline
+        for (size_t index = first; index < end; index++)
+        {
+            const Run & run = m_runs[index];
+
+            if (!run.hasFormat ||
+                (run.format.underlineType == UnderlineType::None && !run.format.hasOverline))
+            {
+                continue;
+            }
+
+            DWRITE_UNDERLINE underline = {};
+            underline.width = run.width;
+            underline.thickness = EmSize / 16;
+            underline.offset = EmSize / 8;
+            underline.runHeight = EmSize * 0.9f;
+
+            recorder->DrawUnderline(MakePoint(origin.x + run.x, baselineY),
+                                    &underline,
+                                    &run.format);
+        }
+
+        // Strikethroughs
+        for (size_t index = first; index < end; index++)
+        {
+            const Run & run = m_runs[index];
+
+            if (!run.hasFormat || run.format.strikethroughCount == 0)
+            {
+                continue;
+            }
+
+            DWRITE_STRIKETHROUGH strikethrough = {};
+            strikethrough.width = run.width;
+            strikethrough.thickness = EmSize / 16;
+            strikethrough.offset = -EmSize * 0.3f;
+
+            if (S_OK != (hr = recorder->DrawStrikethrough(MakePoint(origin.x + run.x, baselineY),
+                                                          &strikethrough,
+                                                          &run.format)))
+            {
+                return hr;
+            }
+        }
+
+        top += m_lineMetrics[line].height;
+        first = end;
+    }
+
+    recorder->End();
+    return S_OK;
+}
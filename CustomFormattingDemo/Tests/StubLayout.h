@@ -0,0 +1,80 @@
+#pragma once
+#include "pch.h"
+#include "FontMetricsCache.h"
+#include "LayoutRecorder.h"
+
+// A synthetic laid-out paragraph, standing in for IDWriteTextLayout. Lines
+// hold glyph runs with formatting, and Draw feeds them to a LayoutRecorder
+// the way IDWriteTextLayout::Draw calls the IDWriteTextRenderer: for each
+// line, its glyph runs from left to right, then the underlines, then the
+// strikethroughs. Each glyph stands for one character.
+class StubLayout
+{
+public:
+    StubLayout();
+
+    // Start a new line; runs are added to the last line
+    void AddLine(float height, float baseline);
+
+    // A null format is a run without a drawing effect
+    void AddRun(UINT32 glyphCount, float advance, const FormatValues * format);
+
+    // A run of one space at the end of the line, which has no background
+    // or highlight
+    void AddTrailingSpace(float advance, const FormatValues * format);
+
+    // Lines of runsPerLine runs of glyphsPerRun glyphs and a trailing
+    // space, with a repeating mix of colors, backgrounds, highlights and
+    // every kind of decoration; neighboring runs often share a decoration,
+    // as after a color change
+    static StubLayout CreateParagraph(UINT32 lineCount,
+                                      UINT32 runsPerLine,
+                                      UINT32 glyphsPerRun);
+
+    HRESULT Draw(LayoutRecorder * recorder,
+                 DisplayList * displayList,
+                 RenderPoint origin,
+                 const RenderRect * clipRect = nullptr,
+                 const RenderMatrix & transform = RenderMatrix::Identity(),
+                 float dpi = 96);
+
+    const std::vector<DWRITE_LINE_METRICS> & GetLineMetrics() const { return m_lineMetrics; }
+
+    // Runs of text, without the trailing spaces
+    UINT32 GetRunCount() const { return m_textRunCount; }
+
+    float GetHeight() const;
+
+    static const float EmSize;
+
+private:
+    struct Run
+    {
+        UINT32       line;
+        float        x;
+        float        width;
+        UINT32       firstGlyph;
+        UINT32       glyphCount;
+        bool         hasFormat;
+        FormatValues format;
+    };
+
+    // Shared by all runs, with an ascent of 0.9 em, a descent of 0.25 em
+    // and a line gap of 0.1 em
+    class FontFace : public IDWriteFontFace
+    {
+    public:
+        virtual ULONG AddRef() override { return 1; }
+        virtual ULONG Release() override { return 1; }
+        virtual void GetMetrics(DWRITE_FONT_METRICS * fontFaceMetrics) override;
+    };
+
+    static FontFace         s_fontFace;
+    static FontMetricsCache s_fontMetrics;
+
+    std::vector<DWRITE_LINE_METRICS> m_lineMetrics;
+    std::vector<Run>                 m_runs;
+    std::vector<UINT16>              m_glyphIndices;
+    std::vector<FLOAT>               m_glyphAdvances;
+    UINT32                           m_textRunCount;
+};
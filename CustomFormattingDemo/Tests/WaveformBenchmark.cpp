@@ -0,0 +1,98 @@
+// Measures GenerateWaveform, which samples squiggly underlines four points
+// at a time, against the scalar loop it replaced: one std::fmod and one
+// sine per DIP. Squiggles are 10 to 5000 DIPs wide, with one sample per DIP
+// as the old loop took, and two as on a 192 DPI display.
+#include "pch.h"
+#include "Waveform.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+typedef std::chrono::steady_clock Clock;
+
+typedef void (*WaveformFunction)(float amplitude,
+                                 float period,
+                                 float phase,
+                                 UINT32 samplesPerDip,
+                                 UINT32 count,
+                                 RenderPoint * points);
+
+// The loop of SquigglyGeometryCache before GenerateWaveform, writing its
+// points to the buffer instead of a geometry sink
+static void GenerateWaveformScalar(float amplitude,
+                                   float period,
+                                   float phase,
+                                   UINT32 samplesPerDip,
+                                   UINT32 count,
+                                   RenderPoint * points)
+{
+    for (UINT32 t = 0; t < count; t++)
+    {
+        float x = (float) t / samplesPerDip;
+        float angle = 2 * 3.141592654f * std::fmod(phase + x, period) / period;
+        points[t] = MakePoint(x, amplitude * std::sin(angle));
+    }
+}
+
+// Both are called through these, so that neither is inlined into the loop
+// that measures it
+static WaveformFunction volatile s_kernel = GenerateWaveform;
+static WaveformFunction volatile s_loop = GenerateWaveformScalar;
+
+// Points per second for squiggles of the given width
+static double Measure(WaveformFunction volatile * function,
+                      UINT32 width,
+                      UINT32 samplesPerDip,
+                      double minSeconds)
+{
+    UINT32 count = GetWaveformPointCount(width, samplesPerDip);
+    std::vector<RenderPoint> points(count);
+
+    // Enough squiggles per timing for the clock not to matter
+    UINT32 squiggleCount = max(1u, 20000 / count);
+    UINT64 totalCount = 0;
+    double seconds = 0;
+    Clock::time_point start = Clock::now();
+
+    while (seconds < minSeconds)
+    {
+        WaveformFunction generate = *function;
+
+        for (UINT32 squiggle = 0; squiggle < squiggleCount; squiggle++)
+        {
+            // A thickness of 1 DIP, and a different phase each time
+            generate(1, 5, (squiggle % 50) * 0.1f, samplesPerDip, count, points.data());
+        }
+
+        totalCount += (UINT64) squiggleCount * count;
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    return totalCount / seconds;
+}
+
+int main(int argc, char ** argv)
+{
+    double minSeconds = argc > 1 ? std::atof(argv[1]) : 0.3;
+
+    std::printf("%-8s %12s %16s %16s %8s %14s\n",
+                "DIPs", "samples/DIP", "kernel points/s", "loop points/s", "speedup", "kernel us/line");
+
+    UINT32 widths[] = { 10, 50, 200, 1000, 5000 };
+
+    for (UINT32 samplesPerDip = 1; samplesPerDip <= 2; samplesPerDip++)
+    {
+        for (UINT32 width : widths)
+        {
+            double kernel = Measure(&s_kernel, width, samplesPerDip, minSeconds);
+            double loop = Measure(&s_loop, width, samplesPerDip, minSeconds);
+            UINT32 count = GetWaveformPointCount(width, samplesPerDip);
+
+            std::printf("%-8u %12u %16.3g %16.3g %7.2fx %14.3g\n",
+                        width, samplesPerDip, kernel, loop, kernel / loop, count / kernel * 1e6);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,81 @@
+// Checks GenerateWaveform against std::sin: the sample positions, the
+// samples left over after the groups of four, and the accuracy of the
+// vectorized sine over squiggles up to 5000 DIPs long.
+#include "pch.h"
+#include "Waveform.h"
+#include "Check.h"
+#include <cmath>
+
+// Largest error of the samples, relative to the amplitude
+static double GetMaxError(float amplitude,
+                          float period,
+                          float phase,
+                          UINT32 samplesPerDip,
+                          const std::vector<RenderPoint> & points)
+{
+    double maxError = 0;
+
+    for (UINT32 index = 0; index < points.size(); index++)
+    {
+        double x = (double) index / samplesPerDip;
+        double y = amplitude * std::sin(2 * 3.14159265358979 * (phase + x) / period);
+        maxError = std::fmax(maxError, std::fabs(points[index].y - y) / amplitude);
+    }
+
+    return maxError;
+}
+
+static void TestSamples()
+{
+    // Every remainder of the groups of four, at several densities
+    for (UINT32 samplesPerDip = 1; samplesPerDip <= 3; samplesPerDip++)
+    {
+        for (UINT32 width = 0; width <= 9; width++)
+        {
+            UINT32 count = GetWaveformPointCount(width, samplesPerDip);
+            std::vector<RenderPoint> points(count + 1, MakePoint(-1, -1));
+
+            GenerateWaveform(2, 10, 1.5f, samplesPerDip, count, points.data());
+
+            for (UINT32 index = 0; index < count; index++)
+            {
+                CHECK(points[index].x == index * (1.0f / samplesPerDip));
+            }
+
+            // The last point is the end of the line, and nothing is
+            // written past it
+            CHECK(std::fabs(points[count - 1].x - width) < 1e-5f);
+            CHECK(points[count].x == -1 && points[count].y == -1);
+
+            points.resize(count);
+            CHECK(GetMaxError(2, 10, 1.5f, samplesPerDip, points) < 1e-5);
+        }
+    }
+}
+
+static void TestAccuracy()
+{
+    // The angle grows with the width, and a float angle loses precision;
+    // at 5000 DIPs the error stays well below a pixel
+    float thicknesses[] = { 0.5f, 1, 2.5f };
+
+    for (float thickness : thicknesses)
+    {
+        float period = 5 * thickness;
+        UINT32 count = GetWaveformPointCount(5000, 2);
+        std::vector<RenderPoint> points(count);
+
+        GenerateWaveform(thickness, period, period / 3, 2, count, points.data());
+
+        double error = GetMaxError(thickness, period, period / 3, 2, points);
+        CHECK(error < 2e-3);
+    }
+}
+
+int main()
+{
+    TestSamples();
+    TestAccuracy();
+
+    return ReportChecks();
+}
@@ -0,0 +1,165 @@
+// Measures how DocumentLoader::Load scales with cores: a synthetic document
+// of formatted paragraphs is loaded on 1 to N threads, and the best wall
+// time of a few loads at each concurrency is reported with its speedup
+// over one thread and its efficiency per thread. Needs DirectWrite and the
+// Concurrency Runtime, so it only builds with Visual C++ on Windows.
+#include "pch.h"
+#include "DocumentLoader.h"
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+#pragma comment(lib, "dwrite.lib")
+#pragma comment(lib, "d2d1.lib")
+
+using namespace Microsoft::WRL;
+
+// Paragraphs of words, with a format range on about one word in four
+static std::vector<ParagraphSource> CreateParagraphs(size_t paragraphCount,
+                                                     BrushPalette * brushPalette)
+{
+    BrushIndex brushes[] =
+    {
+        brushPalette->Add(D2D1::ColorF(D2D1::ColorF::Black)),
+        brushPalette->Add(D2D1::ColorF(D2D1::ColorF::Red)),
+        brushPalette->Add(D2D1::ColorF(D2D1::ColorF::Blue)),
+        brushPalette->Add(D2D1::ColorF(D2D1::ColorF::Yellow, 0.5f)),
+        brushPalette->Add(D2D1::ColorF(D2D1::ColorF::Green))
+    };
+
+    const UINT32 brushCount = ARRAYSIZE(brushes);
+    const wchar_t * words[] = { L"lorem", L"ipsum", L"dolor", L"sit", L"amet",
+                                L"consectetur", L"adipiscing", L"elit", L"sed", L"do" };
+
+    std::mt19937 random(1);
+    std::vector<ParagraphSource> paragraphs(paragraphCount);
+
+    for (ParagraphSource & paragraph : paragraphs)
+    {
+        UINT32 wordCount = 40 + random() % 80;
+
+        for (UINT32 word = 0; word < wordCount; word++)
+        {
+            UINT32 start = (UINT32) paragraph.text.length();
+            paragraph.text += words[random() % ARRAYSIZE(words)];
+
+            if (random() % 4 == 0)
+            {
+                FormatRange range;
+                range.textRange.startPosition = start;
+                range.textRange.length = (UINT32) paragraph.text.length() - start;
+                range.fields = ForegroundField;
+                range.values.foregroundBrush = brushes[random() % brushCount];
+
+                switch (random() % 4)
+                {
+                case 0:
+                    range.fields |= UnderlineField;
+                    range.values.underlineType = UnderlineType::Squiggly;
+                    range.values.underlineBrush = brushes[1];
+                    break;
+
+                case 1:
+                    range.fields |= HighlightField;
+                    range.values.highlightBrush = brushes[3];
+                    break;
+
+                case 2:
+                    range.fields |= BackgroundField;
+                    range.values.backgroundBrush = brushes[random() % brushCount];
+                    break;
+                }
+
+                paragraph.formatting.push_back(range);
+            }
+
+            paragraph.text += L' ';
+        }
+    }
+
+    return paragraphs;
+}
+
+int main(int argc, char ** argv)
+{
+    size_t paragraphCount = argc > 1 ? (size_t) std::atoi(argv[1]) : 4000;
+    int repeatCount = 3;
+
+    ComPtr<IDWriteFactory> dwriteFactory;
+    ComPtr<IDWriteTextFormat> textFormat;
+    HRESULT hr;
+
+    if (S_OK != (hr = DWriteCreateFactory(DWRITE_FACTORY_TYPE_SHARED,
+                                          __uuidof(IDWriteFactory),
+                                          &dwriteFactory)) ||
+        S_OK != (hr = dwriteFactory->CreateTextFormat(L"Segoe UI", nullptr,
+                                                      DWRITE_FONT_WEIGHT_NORMAL,
+                                                      DWRITE_FONT_STYLE_NORMAL,
+                                                      DWRITE_FONT_STRETCH_NORMAL,
+                                                      16.0f, L"en-us", &textFormat)))
+    {
+        std::printf("DirectWrite failed: 0x%08x\n", (unsigned int) hr);
+        return 1;
+    }
+
+    BrushPalette brushPalette;
+    std::vector<ParagraphSource> paragraphs = CreateParagraphs(paragraphCount, &brushPalette);
+    DocumentLoader loader(dwriteFactory.Get(), textFormat.Get(), 800.0f);
+
+    // One load to warm up the font cache and the intern table
+    if (S_OK != (hr = loader.Load(paragraphs, brushPalette, 1)))
+    {
+        std::printf("Load failed: 0x%08x\n", (unsigned int) hr);
+        return 1;
+    }
+
+    unsigned int maxConcurrency = max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned int> concurrencies;
+
+    for (unsigned int concurrency = 1; concurrency < maxConcurrency; concurrency *= 2)
+    {
+        concurrencies.push_back(concurrency);
+    }
+
+    concurrencies.push_back(maxConcurrency);
+
+    std::printf("%u paragraphs, best of %d loads\n", (unsigned int) paragraphCount, repeatCount);
+    std::printf("%-8s %10s %14s %8s %10s\n",
+                "threads", "seconds", "paragraphs/s", "speedup", "efficiency");
+
+    double baseSeconds = 0;
+
+    for (unsigned int concurrency : concurrencies)
+    {
+        double seconds = 0;
+
+        for (int repeat = 0; repeat < repeatCount; repeat++)
+        {
+            if (S_OK != (hr = loader.Load(paragraphs, brushPalette, concurrency)))
+            {
+                std::printf("Load failed: 0x%08x\n", (unsigned int) hr);
+                return 1;
+            }
+
+            seconds = repeat == 0 ? loader.GetLoadSeconds() :
+                                    min(seconds, loader.GetLoadSeconds());
+        }
+
+        if (concurrency == 1)
+        {
+            baseSeconds = seconds;
+        }
+
+        double speedup = baseSeconds / seconds;
+
+        std::printf("%-8u %10.4f %14.4g %7.2fx %9.0f%%\n",
+                    concurrency,
+                    seconds,
+                    paragraphCount / seconds,
+                    speedup,
+                    100 * speedup / concurrency);
+    }
+
+    return 0;
+}
@@ -0,0 +1,375 @@
+// Measures LogDocument at a sustained append rate while frames are drawn at
+// 60 fps: an ingest thread appends colorized log lines in batches, laying
+// out, formatting and measuring each one with DirectWrite, and the main
+// thread draws the tail that fills a 1920 x 1080 screen once per frame with
+// CharacterFormatter, as RenderLog does. Frames are drawn on a WIC bitmap
+// render target, which rasterizes on the CPU, so the frame times are an
+// upper bound for the hardware render target of the app. Needs DirectWrite,
+// Direct2D and WIC, so it only builds with Visual C++ on Windows.
+//
+// Reports the append rate reached and the work time of the frames against
+// the 16.7 ms budget, for 10k lines per second and faster rates.
+#include "pch.h"
+#include "CharacterFormatter.h"
+#include "LogDocument.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#pragma comment(lib, "d2d1.lib")
+#pragma comment(lib, "dwrite.lib")
+#pragma comment(lib, "windowscodecs.lib")
+#pragma comment(lib, "ole32.lib")
+
+using namespace D2D1;
+using namespace Microsoft::WRL;
+
+typedef std::chrono::steady_clock Clock;
+
+const UINT32 ScreenWidth = 1920;
+const UINT32 ScreenHeight = 1080;
+const size_t MaxLineCount = 100000;
+const double FrameSeconds = 1.0 / 60;
+
+// Brushes of the log colors
+struct LogColors
+{
+    BrushIndex timestamp;
+    BrushIndex info;
+    BrushIndex warning;
+    BrushIndex error;
+    BrushIndex errorBackground;
+    BrushIndex highlight;
+};
+
+static LogColors AddColors(BrushPalette * brushPalette)
+{
+    LogColors colors;
+    colors.timestamp = brushPalette->Add(ColorF(ColorF::Gray));
+    colors.info = brushPalette->Add(ColorF(ColorF::SteelBlue));
+    colors.warning = brushPalette->Add(ColorF(ColorF::DarkOrange));
+    colors.error = brushPalette->Add(ColorF(ColorF::Red));
+    colors.errorBackground = brushPalette->Add(ColorF(ColorF::MistyRose));
+    colors.highlight = brushPalette->Add(ColorF(ColorF::Yellow, 0.4f));
+    return colors;
+}
+
+// A line of a service log: a gray timestamp, a colored level, and a
+// message; errors have a background and squiggles, and one line in
+// sixteen has a highlighted search match
+static ParagraphSource CreateLine(UINT64 number, const LogColors & colors)
+{
+    static const wchar_t * levels[] = { L"INFO", L"INFO", L"INFO", L"WARN", L"ERROR" };
+    static const wchar_t * messages[] =
+    {
+        L"request completed in 12 ms for /api/items?page=3",
+        L"cache miss for key user:4821:profile, loading from store",
+        L"connection pool at 87% of capacity, consider raising the limit",
+        L"retrying upload of chunk 17 of 64 after a timeout",
+        L"failed to parse the configuration value 'max_batch' as an integer"
+    };
+
+    UINT32 kind = (UINT32) (number * 7919 % ARRAYSIZE(levels));
+    wchar_t timestamp[32];
+    swprintf_s(timestamp, L"12:%02u:%02u.%03u ",
+               (UINT32) (number / 60000 % 60), (UINT32) (number / 1000 % 60),
+               (UINT32) (number % 1000));
+
+    ParagraphSource line;
+    line.text = timestamp;
+
+    FormatRange range;
+    range.textRange.startPosition = 0;
+    range.textRange.length = (UINT32) line.text.length();
+    range.fields = ForegroundField;
+    range.values.foregroundBrush = colors.timestamp;
+    line.formatting.push_back(range);
+
+    range = FormatRange();
+    range.textRange.startPosition = (UINT32) line.text.length();
+    line.text += levels[kind];
+    range.textRange.length = (UINT32) line.text.length() - range.textRange.startPosition;
+    range.fields = ForegroundField;
+    range.values.foregroundBrush = kind < 3 ? colors.info : kind == 3 ? colors.warning : colors.error;
+    line.formatting.push_back(range);
+
+    line.text += L' ';
+    UINT32 messageStart = (UINT32) line.text.length();
+    line.text += messages[kind];
+
+    if (kind == 4)
+    {
+        range = FormatRange();
+        range.textRange.startPosition = 0;
+        range.textRange.length = (UINT32) line.text.length();
+        range.fields = BackgroundField;
+        range.values.backgroundBrush = colors.errorBackground;
+        line.formatting.push_back(range);
+
+        range = FormatRange();
+        range.textRange.startPosition = messageStart;
+        range.textRange.length = (UINT32) line.text.length() - messageStart;
+        range.fields = UnderlineField;
+        range.values.underlineType = UnderlineType::Squiggly;
+        range.values.underlineBrush = colors.error;
+        line.formatting.push_back(range);
+    }
+
+    if (number % 16 == 0)
+    {
+        range = FormatRange();
+        range.textRange.startPosition = messageStart;
+        range.textRange.length = 7;
+        range.fields = HighlightField;
+        range.values.highlightBrush = colors.highlight;
+        line.formatting.push_back(range);
+    }
+
+    return line;
+}
+
+struct Result
+{
+    double appendRate;
+    double medianMilliseconds;
+    double p99Milliseconds;
+    double maxMilliseconds;
+    size_t frameCount;
+    size_t missedCount;
+};
+
+static HRESULT Measure(IDWriteFactory * dwriteFactory,
+                       IDWriteTextFormat * textFormat,
+                       ID2D1RenderTarget * renderTarget,
+                       CharacterFormatter * formatter,
+                       double targetRate,
+                       double seconds,
+                       Result * result)
+{
+    HRESULT hr;
+    BrushPalette brushPalette;
+    LogColors colors = AddColors(&brushPalette);
+    LogDocument log(dwriteFactory, textFormat, (FLOAT) ScreenWidth, MaxLineCount, brushPalette);
+
+    // Fill the log first, so that evicting is part of every append
+    std::vector<ParagraphSource> batch;
+
+    for (UINT64 number = 0; number < MaxLineCount; number++)
+    {
+        batch.push_back(CreateLine(number, colors));
+
+        if (batch.size() == 1000)
+        {
+            if (S_OK != (hr = log.Append(batch)))
+            {
+                return hr;
+            }
+
+            batch.clear();
+        }
+    }
+
+    BrushPalette logPalette = log.GetBrushPalette();
+
+    if (S_OK != (hr = logPalette.CreateBrushes(renderTarget)))
+    {
+        return hr;
+    }
+
+    ComPtr<ID2D1SolidColorBrush> blackBrush;
+
+    if (S_OK != (hr = renderTarget->CreateSolidColorBrush(ColorF(ColorF::Black), &blackBrush)))
+    {
+        return hr;
+    }
+
+    std::atomic<bool> isDone(false);
+    std::atomic<UINT64> appendedCount(0);
+    std::atomic<HRESULT> appendResult(S_OK);
+    Clock::time_point start = Clock::now();
+
+    // Appends whatever is due every millisecond, as a tailed file would
+    std::thread ingest([&]()
+    {
+        std::vector<ParagraphSource> lines;
+
+        while (!isDone && appendResult == S_OK)
+        {
+            double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            UINT64 due = (UINT64) (elapsed * targetRate);
+            UINT64 appended = appendedCount;
+
+            if (due > appended)
+            {
+                lines.clear();
+
+                for (UINT64 number = appended; number < due; number++)
+                {
+                    lines.push_back(CreateLine(MaxLineCount + number, colors));
+                }
+
+                appendResult = log.Append(lines);
+                appendedCount = due;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    std::vector<LogLine> tail;
+    std::vector<double> frameTimes;
+    D2D1_RECT_F clipRect = RectF(0, 0, (FLOAT) ScreenWidth, (FLOAT) ScreenHeight);
+
+    Clock::time_point nextFrame = Clock::now();
+    Clock::time_point end = nextFrame + std::chrono::duration_cast<Clock::duration>(
+                                            std::chrono::duration<double>(seconds));
+
+    while (Clock::now() < end && hr == S_OK)
+    {
+        std::this_thread::sleep_until(nextFrame);
+        nextFrame += std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double>(FrameSeconds));
+
+        Clock::time_point frameStart = Clock::now();
+
+        renderTarget->BeginDraw();
+        renderTarget->Clear(ColorF(ColorF::White));
+        log.GetTail((FLOAT) ScreenHeight, &tail);
+
+        FLOAT bottom = (FLOAT) ScreenHeight;
+
+        for (const LogLine & line : tail)
+        {
+            bottom -= line.height;
+
+            if (S_OK != (hr = formatter->Draw(renderTarget,
+                                              line.layout.Get(),
+                                              Point2F(0, bottom),
+                                              blackBrush.Get(),
+                                              &logPalette,
+                                              &clipRect)))
+            {
+                break;
+            }
+        }
+
+        HRESULT endResult = renderTarget->EndDraw();
+        hr = hr == S_OK ? endResult : hr;
+        tail.clear();
+
+        frameTimes.push_back(std::chrono::duration<double>(Clock::now() - frameStart).count());
+
+        // A late frame skips the vsyncs it missed instead of catching up
+        Clock::time_point now = Clock::now();
+
+        while (nextFrame < now)
+        {
+            nextFrame += std::chrono::duration_cast<Clock::duration>(
+                            std::chrono::duration<double>(FrameSeconds));
+        }
+    }
+
+    isDone = true;
+    ingest.join();
+
+    if (hr != S_OK)
+    {
+        return hr;
+    }
+
+    if (appendResult != S_OK)
+    {
+        return appendResult;
+    }
+
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    result->appendRate = appendedCount / elapsed;
+    result->frameCount = frameTimes.size();
+    result->missedCount = std::count_if(frameTimes.begin(), frameTimes.end(),
+                                        [](double time) { return time > FrameSeconds; });
+
+    std::sort(frameTimes.begin(), frameTimes.end());
+    result->medianMilliseconds = 1000 * frameTimes[frameTimes.size() / 2];
+    result->p99Milliseconds = 1000 * frameTimes[frameTimes.size() * 99 / 100];
+    result->maxMilliseconds = 1000 * frameTimes.back();
+    return S_OK;
+}
+
+int main(int argc, char ** argv)
+{
+    double seconds = argc > 1 ? std::atof(argv[1]) : 3;
+
+    ComPtr<IDWriteFactory> dwriteFactory;
+    ComPtr<IDWriteTextFormat> textFormat;
+    ComPtr<ID2D1Factory> d2dFactory;
+    ComPtr<IWICImagingFactory> wicFactory;
+    ComPtr<IWICBitmap> bitmap;
+    ComPtr<ID2D1RenderTarget> renderTarget;
+    HRESULT hr;
+
+    if (S_OK != (hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED)) ||
+        S_OK != (hr = DWriteCreateFactory(DWRITE_FACTORY_TYPE_SHARED,
+                                          __uuidof(IDWriteFactory),
+                                          &dwriteFactory)) ||
+        S_OK != (hr = dwriteFactory->CreateTextFormat(L"Consolas", nullptr,
+                                                      DWRITE_FONT_WEIGHT_NORMAL,
+                                                      DWRITE_FONT_STYLE_NORMAL,
+                                                      DWRITE_FONT_STRETCH_NORMAL,
+                                                      14.0f, L"en-us", &textFormat)) ||
+        S_OK != (hr = D2D1CreateFactory(D2D1_FACTORY_TYPE_MULTI_THREADED,
+                                        d2dFactory.GetAddressOf())) ||
+        S_OK != (hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr,
+                                       CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&wicFactory))) ||
+        S_OK != (hr = wicFactory->CreateBitmap(ScreenWidth, ScreenHeight,
+                                               GUID_WICPixelFormat32bppPBGRA,
+                                               WICBitmapCacheOnLoad, &bitmap)) ||
+        S_OK != (hr = d2dFactory->CreateWicBitmapRenderTarget(bitmap.Get(),
+                                                              RenderTargetProperties(),
+                                                              &renderTarget)))
+    {
+        std::printf("Setup failed: 0x%08x\n", (unsigned int) hr);
+        return 1;
+    }
+
+    ComPtr<CharacterFormatter> formatter = new CharacterFormatter();
+
+    double targetRates[] = { 10000, 30000 };
+    bool holds = true;
+
+    std::printf("%-10s %12s %8s %10s %10s %10s %8s\n",
+                "target/s", "appended/s", "frames", "p50 ms", "p99 ms", "max ms", "missed");
+
+    for (double targetRate : targetRates)
+    {
+        Result result;
+
+        if (S_OK != (hr = Measure(dwriteFactory.Get(), textFormat.Get(), renderTarget.Get(),
+                                  formatter.Get(), targetRate, seconds, &result)))
+        {
+            std::printf("Measure failed: 0x%08x\n", (unsigned int) hr);
+            return 1;
+        }
+
+        std::printf("%-10.0f %12.0f %8u %10.2f %10.2f %10.2f %8u\n",
+                    targetRate,
+                    result.appendRate,
+                    (unsigned int) result.frameCount,
+                    result.medianMilliseconds,
+                    result.p99Milliseconds,
+                    result.maxMilliseconds,
+                    (unsigned int) result.missedCount);
+
+        if (targetRate == 10000)
+        {
+            holds = result.appendRate >= 0.99 * targetRate &&
+                    result.p99Milliseconds < 1000 * FrameSeconds;
+        }
+    }
+
+    std::printf("\n10k lines/s at 60 fps: %s\n", holds ? "held" : "NOT held");
+    return 0;
+}
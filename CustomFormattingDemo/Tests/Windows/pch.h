@@ -0,0 +1,14 @@
+#pragma once
+
+// Stand-in for the precompiled header of the app, for the benchmarks that
+// need DirectWrite, Direct2D and the Concurrency Runtime. It includes the
+// same Windows headers, without the XAML app, so they build as desktop
+// console programs.
+#include <wrl.h>
+#include <wrl/client.h>
+#include <d2d1_2.h>
+#include <dwrite_2.h>
+#include <wincodec.h>
+#include <DirectXMath.h>
+#include <memory>
+#include <concrt.h>
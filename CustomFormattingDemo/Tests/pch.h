@@ -0,0 +1,170 @@
+#pragma once
+
+// Stand-in for the precompiled header of the app, for building the parts
+// of Content that do not need Direct2D on any platform: LayoutRecorder,
+// DisplayList, DecorationCoalescer, RenderSink, GlyphAdvances and
+// FontMetricsCache. It
+// declares the few Windows types they use, with the same layout as the
+// real ones, so the tests do not need the Windows SDK even on Windows.
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+typedef int8_t   INT8;
+typedef int16_t  INT16;
+typedef uint8_t  UINT8;
+typedef uint16_t UINT16;
+typedef int32_t  INT32;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+typedef int32_t  LONG;
+typedef uint32_t ULONG;
+typedef int32_t  BOOL;
+typedef float    FLOAT;
+typedef wchar_t  WCHAR;
+typedef int32_t  HRESULT;
+
+#define S_OK                     ((HRESULT) 0)
+#define S_FALSE                  ((HRESULT) 1)
+#define E_INVALIDARG             ((HRESULT) 0x80070057)
+#define E_NOT_SUFFICIENT_BUFFER  ((HRESULT) 0x8007007A)
+
+#define SUCCEEDED(hr) (((HRESULT) (hr)) >= 0)
+#define FAILED(hr)    (((HRESULT) (hr)) < 0)
+
+// The Windows headers define these as macros
+template<class T> inline T min(T a, T b) { return b < a ? b : a; }
+template<class T> inline T max(T a, T b) { return a < b ? b : a; }
+
+struct IUnknown
+{
+    virtual ULONG AddRef() = 0;
+    virtual ULONG Release() = 0;
+
+protected:
+    ~IUnknown() {}
+};
+
+struct DWRITE_FONT_METRICS
+{
+    UINT16 designUnitsPerEm;
+    UINT16 ascent;
+    UINT16 descent;
+    INT16  lineGap;
+    UINT16 capHeight;
+    UINT16 xHeight;
+    INT16  underlinePosition;
+    UINT16 underlineThickness;
+    INT16  strikethroughPosition;
+    UINT16 strikethroughThickness;
+};
+
+// Only FontMetricsCache calls the face
+struct IDWriteFontFace : IUnknown
+{
+    virtual void GetMetrics(DWRITE_FONT_METRICS * fontFaceMetrics) = 0;
+};
+
+namespace Microsoft
+{
+    namespace WRL
+    {
+        // The subset of ComPtr used by the portable code
+        template<class T>
+        class ComPtr
+        {
+        public:
+            ComPtr() : m_ptr(nullptr) {}
+            ComPtr(T * ptr) : m_ptr(ptr) { AddRef(); }
+            ComPtr(const ComPtr & other) : m_ptr(other.m_ptr) { AddRef(); }
+            ComPtr(ComPtr && other) : m_ptr(other.m_ptr) { other.m_ptr = nullptr; }
+            ~ComPtr() { Release(); }
+
+            ComPtr & operator=(ComPtr other)
+            {
+                T * ptr = m_ptr;
+                m_ptr = other.m_ptr;
+                other.m_ptr = ptr;
+                return *this;
+            }
+
+            T * Get() const { return m_ptr; }
+            T * operator->() const { return m_ptr; }
+
+        private:
+            void AddRef() { if (m_ptr != nullptr) m_ptr->AddRef(); }
+            void Release() { if (m_ptr != nullptr) m_ptr->Release(); }
+
+            T * m_ptr;
+        };
+    }
+}
+
+enum DWRITE_MEASURING_MODE
+{
+    DWRITE_MEASURING_MODE_NATURAL,
+    DWRITE_MEASURING_MODE_GDI_CLASSIC,
+    DWRITE_MEASURING_MODE_GDI_NATURAL
+};
+
+enum DWRITE_READING_DIRECTION
+{
+    DWRITE_READING_DIRECTION_LEFT_TO_RIGHT,
+    DWRITE_READING_DIRECTION_RIGHT_TO_LEFT
+};
+
+enum DWRITE_FLOW_DIRECTION
+{
+    DWRITE_FLOW_DIRECTION_TOP_TO_BOTTOM
+};
+
+struct DWRITE_GLYPH_OFFSET
+{
+    FLOAT advanceOffset;
+    FLOAT ascenderOffset;
+};
+
+struct DWRITE_GLYPH_RUN
+{
+    IDWriteFontFace *           fontFace;
+    FLOAT                       fontEmSize;
+    UINT32                      glyphCount;
+    const UINT16 *              glyphIndices;
+    const FLOAT *               glyphAdvances;
+    const DWRITE_GLYPH_OFFSET * glyphOffsets;
+    BOOL                        isSideways;
+    UINT32                      bidiLevel;
+};
+
+struct DWRITE_LINE_METRICS
+{
+    UINT32 length;
+    UINT32 trailingWhitespaceLength;
+    UINT32 newlineLength;
+    FLOAT  height;
+    FLOAT  baseline;
+    BOOL   isTrimmed;
+};
+
+struct DWRITE_UNDERLINE
+{
+    FLOAT                    width;
+    FLOAT                    thickness;
+    FLOAT                    offset;
+    FLOAT                    runHeight;
+    DWRITE_READING_DIRECTION readingDirection;
+    DWRITE_FLOW_DIRECTION    flowDirection;
+    const WCHAR *            localeName;
+    DWRITE_MEASURING_MODE    measuringMode;
+};
+
+struct DWRITE_STRIKETHROUGH
+{
+    FLOAT                    width;
+    FLOAT                    thickness;
+    FLOAT                    offset;
+    DWRITE_READING_DIRECTION readingDirection;
+    DWRITE_FLOW_DIRECTION    flowDirection;
+    const WCHAR *            localeName;
+    DWRITE_MEASURING_MODE    measuringMode;
+};